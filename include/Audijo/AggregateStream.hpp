@@ -0,0 +1,202 @@
+#pragma once
+#include "Audijo/pch.hpp"
+#include "Audijo/Audijo.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Fixed delay of a block of channels, processed in place. Realtime safe.
+	 */
+	class DelayLine
+	{
+	public:
+		DelayLine() = default;
+
+		/**
+		 * Constructor.
+		 * @param channels amount of channels
+		 * @param delay delay in frames
+		 * @param maxFrames maximum amount of frames per block
+		 */
+		DelayLine(int channels, int delay, int maxFrames);
+
+		/**
+		 * Delay a block.
+		 * @param channels channels, replaced by the delayed block
+		 * @param frames amount of frames, at most the maximum it was constructed with
+		 */
+		void Process(float** channels, int frames);
+
+		int Delay() const { return m_Delay; }
+
+	private:
+		int m_Channels = 0;
+		int m_Delay = 0;
+		std::vector<float> m_History; // Last frames of every channel, the delay of each one after the other
+		std::vector<float> m_Scratch; // History followed by the block
+	};
+
+	/**
+	 * A member of an aggregate stream.
+	 */
+	struct AggregateMember
+	{
+		int firstInput = 0;     // First input channel of the member in the aggregate
+		int inputs = 0;         // Amount of input channels
+		int firstOutput = 0;    // First output channel of the member in the aggregate
+		int outputs = 0;        // Amount of output channels
+		int inputLatency = 0;   // Latency of its input in frames of the aggregate, before alignment
+		int outputLatency = 0;  // Latency of its output in frames of the aggregate, before alignment
+		int inputDelay = 0;     // Frames its input is delayed by to line up with the other members
+		int outputDelay = 0;    // Frames its output is delayed by to line up with the other members
+		double ratio = 1;       // Current ratio of the aggregate rate to the rate of the member, 1 for the clock master
+		uint64_t underruns = 0; // Times a bridge to or from the member ran empty
+		uint64_t overruns = 0;  // Times a bridge to or from the member was full
+	};
+
+	/**
+	 * Aggregate stream information.
+	 */
+	struct AggregateInformation
+	{
+		StreamState state = Closed; // State of the aggregate
+		int bufferSize = 0;         // Buffer size of the clock master
+		double sampleRate = 0;      // Sample rate of the clock master
+		int inputChannels = 0;      // Input channels of all members
+		int outputChannels = 0;     // Output channels of all members
+		int inputLatency = 0;       // Latency all inputs are aligned to, in frames
+		int outputLatency = 0;      // Latency all outputs are aligned to, in frames
+		std::vector<AggregateMember> members;
+	};
+
+	/**
+	 * Several streams merged into a single callback, so devices that each have their own driver, or
+	 * their own backend, act as one device with all of their channels. The first member is the clock
+	 * master, its audio thread runs the callback. Every other member goes through a resampling bridge
+	 * in each direction that follows the drift between its clock and the one of the master. The
+	 * bridges add latency, so the channels of every member are delayed to line up with the slowest
+	 * one, in both directions. Channels are numbered in the order the members were added. Backends
+	 * that only allow a single stream per process, like ASIO, can only be a member once.
+	 */
+	class AggregateStream
+	{
+	public:
+		~AggregateStream() { Close(); }
+
+		/**
+		 * Add a member, only while closed. The callback of its stream gets replaced by the aggregate.
+		 * @param stream stream of the member, has to outlive the aggregate
+		 * @param parameters parameters the member is opened with, members without a sample rate take the one of the master
+		 * @param latency latency of the device itself in frames of the aggregate, like its converters, to align it by
+		 * @return AlreadyOpen if the aggregate is open
+		 */
+		Error Add(Stream<>& stream, const StreamParameters& parameters = StreamParameters{}, int latency = 0);
+
+		/**
+		 * Set the callback, only while closed.
+		 * @param callback callback with the signature <code>void(Buffer<float>&, Buffer<float>&, CallbackInfo)</code>,
+		 * called on the audio thread of the clock master with the channels of all members
+		 */
+		template<typename Lambda>
+		void Callback(Lambda callback) { m_Callback = std::move(callback); }
+
+		/**
+		 * Open all members, the clock master first.
+		 * @return
+		 * NoCallback - If the callback was not set<br>
+		 * NotPresent - If there are no members<br>
+		 * AlreadyOpen - If the aggregate is already open<br>
+		 * Any error of opening a member, the members that opened are closed again<br>
+		 * NoError - If all members opened
+		 */
+		Error Open();
+
+		/**
+		 * Start all members, the clock master last so the bridges are filling once it calls back.
+		 * @return
+		 * NotOpen - If the aggregate wasn't opened<br>
+		 * AlreadyRunning - If the aggregate is already running<br>
+		 * Any error of starting a member, the members that started are stopped again<br>
+		 * NoError - If all members started
+		 */
+		Error Start();
+
+		/**
+		 * Stop all members, the clock master first.
+		 * @return
+		 * NotOpen - If the aggregate wasn't opened<br>
+		 * NotRunning - If the aggregate isn't running<br>
+		 * NoError - If all members stopped
+		 */
+		Error Stop();
+
+		/**
+		 * Close all members, stops them first when running.
+		 * @return
+		 * NotOpen - If the aggregate wasn't opened<br>
+		 * NoError - If all members closed
+		 */
+		Error Close();
+
+		/**
+		 * Current state, safe to call from any thread.
+		 * @return state
+		 */
+		StreamState State() const { return m_State.load(std::memory_order_acquire); }
+
+		/**
+		 * Information about the aggregate and its members, with the current ratio and dropouts of every
+		 * bridge. Call from the control thread.
+		 * @return information
+		 */
+		AggregateInformation Information() const;
+
+	private:
+		struct Member
+		{
+			Member(Stream<>* stream, const StreamParameters& parameters, int latency)
+				: stream(stream), parameters(parameters), latency(latency)
+			{}
+
+			Stream<>* stream;
+			StreamParameters parameters;
+			int latency;
+
+			std::unique_ptr<DuplexBridge> input;  // Member input on the master clock, not for the master
+			std::unique_ptr<DuplexBridge> output; // Master output on the member clock, not for the master
+			DelayLine inputDelay;
+			DelayLine outputDelay;
+			AggregateMember information;
+		};
+
+		std::vector<Member> m_Members;
+		std::function<void(Buffer<float>&, Buffer<float>&, CallbackInfo)> m_Callback;
+		std::atomic<StreamState> m_State = Closed;
+		AggregateInformation m_Information;
+
+		std::vector<float> m_Memory;  // Channels of the members other than the master
+		std::vector<float*> m_Inputs;  // All input channels of the current period
+		std::vector<float*> m_Outputs; // All output channels of the current period
+
+		/**
+		 * Run a period of the clock master, on its audio thread.
+		 * @param input input of the master
+		 * @param output output of the master
+		 * @param info callback info of the master
+		 */
+		void Master(Buffer<float>& input, Buffer<float>& output, CallbackInfo info);
+
+		/**
+		 * Run a period of another member, on its audio thread.
+		 * @param member member
+		 * @param input input of the member
+		 * @param output output of the member
+		 */
+		void Follow(Member& member, Buffer<float>& input, Buffer<float>& output);
+
+		/**
+		 * Size the bridges, delays and channels for the opened members.
+		 */
+		void Prepare();
+	};
+}
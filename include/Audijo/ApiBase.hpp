@@ -1,9 +1,23 @@
 #pragma once
 #include "Audijo/pch.hpp"
 #include "Audijo/Callback.hpp"
+#include "Audijo/Recorder.hpp"
+#include "Audijo/Thread.hpp"
+#include "Audijo/MessageQueue.hpp"
+#include "Audijo/Clock.hpp"
+#include "Audijo/Resampler.hpp"
+#include "Audijo/Statistics.hpp"
+#include "Audijo/Trace.hpp"
+#include "Audijo/Log.hpp"
+#include "Audijo/Notification.hpp"
+#include "Audijo/DeviceRegistry.hpp"
+#include "Audijo/ThreadPool.hpp"
 
 namespace Audijo 
 {
+	class PullStreamBase;
+	template<typename T> class PullStream;
+
 	enum Api
 	{
 		Unspecified, 
@@ -12,7 +26,16 @@ namespace Audijo
 		Asio,
 #endif
 #ifdef AUDIJO_WASAPI
-		Wasapi
+		Wasapi,
+#endif
+#ifdef AUDIJO_PIPEWIRE
+		PipeWire,
+#endif
+#ifdef AUDIJO_SHAREDMEMORY
+		SharedMemory,
+#endif
+#ifdef AUDIJO_NULL
+		Null,
 #endif
 	};
 
@@ -63,7 +86,7 @@ namespace Audijo
 		int id;
 	};
 
-	template<Api api = Unspecified>
+	template<Api A = Unspecified>
 	struct DeviceInfo 
 	{
 		/**
@@ -100,6 +123,13 @@ namespace Audijo
 		 * From which api is this device
 		 */
 		Api api = Unspecified;
+
+		/**
+		 * Channels and sample rates are known, false while they're still being probed
+		 */
+		bool probed = true;
+
+		bool operator==(const DeviceInfo&) const = default;
 	};
 
 	template<typename ...Args>
@@ -107,6 +137,18 @@ namespace Audijo
 
 	enum SettingValues { Default = -2, NoDevice = -1 };
 
+	/**
+	 * Range of channels that is processed by a single call of a group callback.
+	 */
+	struct ChannelGroup
+	{
+		int input = 0;   // First input channel
+		int inputs = 0;  // Amount of input channels
+		int output = 0;  // First output channel
+		int outputs = 0; // Amount of output channels
+		int cpu = -1;    // Cpu the worker of this group gets pinned to, -1 to not pin. Ignored for the first group, it runs on the audio thread
+	};
+
 	struct StreamParameters
 	{
 		/** 
@@ -124,6 +166,12 @@ namespace Audijo
 		 */
 		int bufferSize = Default;
 
+		/**
+		 * Largest buffer size the stream can switch to while running, the buffers are allocated
+		 * for it when opening. Default for the buffer size.
+		 */
+		int maxBufferSize = Default;
+
 		/** 
 		 * Sample rate 
 		 */
@@ -133,11 +181,35 @@ namespace Audijo
 		 * Allow resampling when chosen samplerate is not available
 		 */
 		bool resampling = true;
+
+		/**
+		 * Real-time configuration of the audio thread
+		 */
+		ThreadParameters thread;
+
+		/**
+		 * When to reopen the stream after a driver reset or a lost device
+		 */
+		RestartParameters restart;
+
+		/**
+		 * Periods the callback runs ahead of the device on a worker thread of its own, 0 to run it on
+		 * the audio thread. Every period hands the input to the worker and plays the output the worker
+		 * finished that many periods before, so a callback can take up to that many periods as long as
+		 * it keeps up on average. Adds that many periods of latency.
+		 */
+		int pipeline = 0;
+
+		/**
+		 * What to do when the callback keeps taking longer than the period allows. Growing the
+		 * buffer size needs a largest buffer size to grow into.
+		 */
+		WatchdogParameters watchdog;
 	};
 
 	enum StreamState
 	{
-		Closed, Opened, Running
+		Closed, Opened, Starting, Running, Stopping
 	};
 
 	/**
@@ -149,6 +221,7 @@ namespace Audijo
 		int input = NoDevice;                // Input device
 		int output = NoDevice;               // output device
 		int bufferSize = 0;                  // Buffer size
+		int maxBufferSize = 0;               // Largest buffer size the buffers were allocated for
 		double sampleRate = 0;               // Sample rate
 		bool resampling = false;             // Eesampling enabled
 		int inputChannels = 0;               // Number of input channels
@@ -157,14 +230,27 @@ namespace Audijo
 		SampleFormat outFormat = None;       // Format used by the callback function for output device
 		SampleFormat deviceInFormat = None;  // Format used by the input device
 		SampleFormat deviceOutFormat = None; // Format used by the output device
+		ThreadParameters thread;             // Requested audio thread configuration
+		ThreadStatus threadStatus;           // Audio thread configuration that took effect, set once the audio thread started
+		double deviceSampleRate = 0;         // Sample rate of the device when it differs from the sample rate, 0 otherwise
+		double resamplingDelay = 0;          // Latency added by the resampling stage in seconds
+		double pipelineDelay = 0;            // Latency added by running the callback ahead on its own thread in seconds
+		StreamParameters parameters;         // Parameters the stream was opened with, used when restarting
 
 		StreamInformation& operator=(const StreamParameters& s)
 		{
+			parameters = s;
 			input = s.input;
 			output = s.output;
 			bufferSize = s.bufferSize;
+			maxBufferSize = s.maxBufferSize;
 			sampleRate = s.sampleRate;
 			resampling = s.resampling;
+			thread = s.thread;
+			threadStatus = ThreadStatus{};
+			deviceSampleRate = 0;
+			resamplingDelay = 0;
+			pipelineDelay = 0;
 			return *this;
 		}
 	};
@@ -191,15 +277,24 @@ namespace Audijo
 		Fail,           // General fail, either hardware or other. (Api specific fail)
 
 		InvalidDuplex,  // Combination of devices in duplex channel is invalid
+
+		InvalidChannelGroups, // Channel groups of a group callback overlap
 	};
 
 	class ApiBase
 	{
 	public:
-		virtual ~ApiBase() { FreeBuffers(); }
+		ApiBase();
+		virtual ~ApiBase() { StopExecutor(); StopNotifications(); FreeBuffers(); }
 		virtual const DeviceInfo<>& Device(int id) const = 0;
 		virtual int DeviceCount() const = 0;
-		virtual const StreamInformation& Information() const { return m_Information;  };
+		/**
+		 * Information about the stream, a snapshot taken on the calling control thread. The status
+		 * of the audio thread is published by the audio thread itself, see ApplyThreadConfiguration.
+		 * @return information
+		 */
+		virtual StreamInformation Information() const;
+		StreamState State() const { return m_State.load(std::memory_order_acquire); }
 
 		virtual Error Open(const StreamParameters& settings = StreamParameters{}) = 0;
 		virtual Error Start() = 0;
@@ -209,26 +304,463 @@ namespace Audijo
 		virtual Error SampleRate(double) = 0;
 		virtual Error BufferSize(std::size_t) { return Fail; /* Not supported */ };
 
-		void Callback(std::unique_ptr<CallbackWrapperBase>&& callback) { m_Callback = std::move(callback); }
+		void Callback(std::unique_ptr<CallbackWrapperBase>&& callback);
+		/**
+		 * Set the group callback, only while the stream is closed or stopped.
+		 * @param groups channel groups, no channel can be in more than one group
+		 * @param callback callback
+		 * @return AlreadyRunning if the stream is started, InvalidChannelGroups if groups overlap
+		 */
+		Error GroupCallback(const std::vector<ChannelGroup>& groups, std::unique_ptr<CallbackWrapperBase>&& callback);
 
 		template<typename T>
 		void UserData(T& data) { m_UserData = &data; };
 
+		uint64_t Position() const { return m_Position.load(std::memory_order_acquire); }
+		StreamClock Clock() const;
+		const DuplexBridge* Bridge() const { return m_Bridge.get(); }
+
+		/**
+		 * Timing of the periods so far, can be called from any thread.
+		 * @return statistics
+		 */
+		StreamStatistics Statistics() const;
+
+		/**
+		 * Start the statistics over, takes effect at the next period.
+		 */
+		void ResetStatistics();
+
+		/**
+		 * Enable the feed of dropouts, while enabled every dropout is queued for NextXrun.
+		 * @param enable enable
+		 */
+		void XrunFeed(bool enable) { m_XrunFeed.store(enable, std::memory_order_relaxed); }
+
+		/**
+		 * Take the oldest dropout from the feed, lock-free.
+		 * @param xrun dropout
+		 * @return false if the feed is empty
+		 */
+		bool NextXrun(Xrun& xrun) { return m_Xruns.Pop(xrun); }
+
+		/**
+		 * Set the listener for notifications, called on the notification thread of the stream.
+		 * @param listener listener, empty to remove it
+		 */
+		void Listener(std::function<void(const Notification&)> listener);
+
+		/**
+		 * Close the stream and open it again with the parameters it was opened with, and start
+		 * it again if it was running.
+		 * @return
+		 * NotOpen - If the stream wasn't opened<br>
+		 * Any error of Open or Start
+		 */
+		Error Restart();
+
+		/**
+		 * Held by Open, Start, Stop and Close of the stream object, and by a restart on the 
+		 * notification thread, so they never interleave.
+		 * @return mutex
+		 */
+		std::mutex& ControlMutex() { return m_ControlMutex; }
+
+		/**
+		 * Run a control call on the executor of the stream, a thread that runs the calls one after the
+		 * other in the order they were submitted, holding the control mutex. Started by the first call.
+		 * @param call control call
+		 * @return future with the result of the call
+		 */
+		std::future<Error> Execute(std::function<Error(ApiBase&)> call);
+
+		bool Schedule(const Event& event) { return m_Events.Push(event); }
+
+		template<typename T, typename Handler>
+		CommandQueue<T>& Commands(std::size_t capacity, Handler&& handler)
+		{
+			auto _queue = std::make_unique<CommandQueue<T>>(capacity, std::forward<Handler>(handler));
+			auto& _result = *_queue;
+			AddCommandQueue(std::move(_queue));
+			return _result;
+		}
+
+		template<typename T>
+		PullStream<T>& Pull(std::size_t periods)
+		{
+			auto _pull = std::make_shared<PullStream<T>>(periods);
+			auto _callback = [this, _stream = _pull.get()](Buffer<T>& input, Buffer<T>& output, CallbackInfo) {
+				auto [_lost, _missing] = _stream->Process(input, output);
+				if (_lost > 0)
+					ReportXrun(InputOverrun, _lost);
+				if (_missing > 0)
+					ReportXrun(OutputUnderrun, _missing);
+			};
+
+			Callback(std::make_unique<CallbackWrapper<decltype(_callback), void(Buffer<T>&, Buffer<T>&, CallbackInfo)>>(_callback));
+			auto& _result = *_pull;
+			m_Pull = _pull.get();
+			m_PullStreams.push_back(std::move(_pull));
+			return _result;
+		}
+
+		Error Record(const std::string& path, const std::vector<int>& channels = {});
+		Error StopRecording();
+		RecordingInformation Recording() const;
+
 	protected:
 		static inline double m_SampleRates[]{ 48000, 44100, 88200, 96000, 176400, 192000, 352800, 384000, 8000, 11025, 16000, 22050 };
 		
 		std::unique_ptr<CallbackWrapperBase> m_Callback;
 		void* m_UserData = nullptr;
 
+		// State of the stream, safe to read from any thread. The state in the stream
+		// information is only filled in by Information().
+		std::atomic<StreamState> m_State = Closed;
+
+		constexpr static std::size_t MaxEvents = 1024; // Events that can be waiting at once
+
+		std::atomic<uint64_t> m_Position = 0;        // Frame clock, frames processed by the stream
+		MessageQueue<Event> m_Events{ MaxEvents };   // Events scheduled by the control threads
+		std::vector<Event> m_PendingEvents;          // Events taken from the queue, due in a later period
+		std::vector<Event> m_DueEvents;              // Events delivered in the current period
+
+		constexpr static double ClockBandwidth = 1.; // Bandwidth of the delay-locked loop in Hz
+
+		DelayLockedLoop m_Loop{ ClockBandwidth };     // Filters the period timestamps, audio thread only
+		int m_LoopFrames = 0;                         // Period size the loop runs at, 0 to reset the loop
+		std::atomic<bool> m_ResetClock = false;       // Set when starting, the audio thread resets the loop
+		std::atomic<uint32_t> m_ClockSequence = 0;    // Odd while the audio thread writes the clock
+		std::atomic<uint64_t> m_ClockPosition = 0;    // Published clock, see Clock()
+		std::atomic<double> m_ClockTime = 0;
+		std::atomic<double> m_ClockRate = 0;
+
+		std::vector<std::unique_ptr<CommandQueueBase>> m_CommandQueues;
+		std::unique_ptr<std::vector<CommandQueueBase*>> m_CommandList; // Published list of the command queues
+		std::atomic<std::vector<CommandQueueBase*>*> m_Commands = nullptr;  // List the audio thread drains
+
+		// Resampling bridge from the input to the output device, when a duplex stream
+		// uses two devices that each run on their own clock.
+		std::unique_ptr<DuplexBridge> m_Bridge;
+
+		// Resampling stage between the device and the callback, when the device
+		// doesn't run at the sample rate of the stream.
+		std::unique_ptr<RateConverter> m_Converter;
+
+		PeriodTimer m_Timer; // Timing of the stages of every period
+
+		constexpr static std::size_t MaxXruns = 256; // Dropouts the feed holds, more are dropped
+		std::atomic<uint64_t> m_XrunCount[XrunTypes]{};
+		std::atomic<uint64_t> m_XrunPosition[XrunTypes]{};
+		std::atomic<bool> m_XrunFeed = false;
+		MessageQueue<Xrun> m_Xruns{ MaxXruns };
+
+		// Watchdog state, owned by the thread running the callback
+		int m_OverBudget = 0;   // Periods in a row the callback went over budget
+		int m_WithinBudget = 0; // Periods in a row within budget while the overload flag is set
+		int m_Bypass = 0;       // Periods left that the callback is bypassed
+		bool m_Overload = false;
+		std::atomic<bool> m_ResetWatchdog = false; // Set when starting, the callback thread resets the state
+		std::atomic<uint64_t> m_OverBudgetCount = 0;
+		std::atomic<uint64_t> m_OverloadCount = 0;
+		std::atomic<uint64_t> m_BypassCount = 0;
+		std::atomic<uint64_t> m_BypassedCount = 0;
+		std::atomic<uint64_t> m_GrowthCount = 0;
+
+		/**
+		 * Check the time the callback took against the budget of the watchdog, and act on the policy
+		 * when it went over budget too many periods in a row. Realtime safe.
+		 * @param duration time the callback took in seconds
+		 * @param frames amount of frames in the period
+		 * @param sampleRate sample rate of the period
+		 */
+		void Watchdog(double duration, int frames, double sampleRate);
+
+		/**
+		 * Count a dropout and add it to the feed, realtime safe and callable from any backend thread.
+		 * @param type kind of dropout
+		 * @param frames amount of frames lost, 0 if unknown
+		 */
+		void ReportXrun(XrunType type, int frames = 0);
+
+		constexpr static std::size_t MaxNotifications = 64; // Notifications waiting for the notification thread
+
+		MessageQueue<Notification> m_Notifications{ MaxNotifications };
+		std::function<void(const Notification&)> m_Listener; // Guarded by m_NotifierMutex
+		std::thread m_Notifier;                              // Delivers notifications and applies the restart policy
+		std::mutex m_NotifierMutex;
+		std::mutex m_ControlMutex;                          // See ControlMutex()
+		std::condition_variable m_NotifierWake;
+		bool m_NotifierRunning = false;
+
+		// The device picks the buffer size on its own, like a PipeWire graph. Its BufferSizeChanged
+		// notifications are followed whatever the restart policy, so the notifier always runs.
+		bool m_FollowsDevicePeriod = false;
+
+		std::unique_ptr<ThreadPool> m_Executor; // Runs the asynchronous control calls, see Execute
+		std::mutex m_ExecutorMutex;
+
+		/**
+		 * Post a notification, realtime safe and callable from any backend or driver thread.
+		 * @param type type
+		 * @param value depends on the type
+		 */
+		void Notify(NotificationType type, double value = 0);
+
+		/**
+		 * Start the notification thread, if it isn't running yet.
+		 */
+		void StartNotifications();
+
+		/**
+		 * Stop the notification thread. Backends call this first thing in their destructor, a 
+		 * restart calls into the backend.
+		 */
+		void StopNotifications();
+
+		/**
+		 * Run the control calls that are still waiting and stop the executor. Backends call this
+		 * first thing in their destructor, before StopNotifications.
+		 */
+		void StopExecutor();
+
+		/**
+		 * Prepare the executor thread, called before every control call on it. For backends that
+		 * need per thread setup before they can be controlled from a thread.
+		 */
+		virtual void ControlThread() {}
+
+		/**
+		 * Deliver a notification to the listener and restart the stream if the policy says so,
+		 * on the notification thread.
+		 * @param notification notification
+		 */
+		void Dispatch(const Notification& notification);
+
+		/**
+		 * Open the stream, and start it.
+		 * @param parameters parameters
+		 * @param start start after opening
+		 * @return any error of Open or Start, the stream is closed when there is one
+		 */
+		Error Reopen(const StreamParameters& parameters, bool start);
+
+		/**
+		 * Call the listener, on the notification thread.
+		 * @param notification notification
+		 */
+		void Deliver(const Notification& notification);
+
+		std::vector<ChannelGroup> m_Groups;     // Channel groups of the group callback
+		std::unique_ptr<WorkerGroup> m_Workers; // Workers for all groups but the first
+
 		StreamInformation m_Information;
 
-		void AllocateBuffers();
+		int m_MaxFrames = 0; // Amount of frames the callback buffers were allocated for
+
+		// Buffer size and sample rate of the periods. Control threads publish them through a seqlock, the
+		// audio thread takes them over at the start of a period, so changing them never reallocates.
+		std::atomic<uint32_t> m_PeriodSequence = 0; // Odd while a control thread writes
+		std::atomic<int> m_NextBufferSize = 0;
+		std::atomic<double> m_NextSampleRate = 0;
+		uint32_t m_PeriodApplied = 0; // Sequence the audio thread took over
+		int m_BufferSize = 0;         // Buffer size of the current period, audio thread only
+		double m_SampleRate = 0;      // Sample rate of the current period, audio thread only
+
+		/**
+		 * Change the buffer size and sample rate, the audio thread switches at its next period. The
+		 * buffer size can't be larger than the buffers were allocated for. Also updates the stream
+		 * information, call from a control thread.
+		 * @param bufferSize buffer size
+		 * @param sampleRate sample rate
+		 */
+		void PublishPeriod(int bufferSize, double sampleRate);
+
+		/**
+		 * Take over the buffer size and sample rate a control thread published, realtime safe. Process 
+		 * calls this, backends that size their periods with the buffer size call it before that.
+		 * @return true if either changed
+		 */
+		bool UpdatePeriod();
+
+		// Incremented when entering and leaving Process, so it's odd while the audio thread is inside a period.
+		std::atomic<uint64_t> m_ProcessEpoch = 0;
+
+		// Set once the audio thread was configured, backends reset it when starting.
+		std::atomic<bool> m_ThreadConfigured = false;
+		ThreadPolicy m_ThreadPolicy = NormalPolicy; // Policy the audio thread was configured with, audio thread only
+
+		// Status of the audio thread configuration, one byte per setting. Written by the audio thread,
+		// which never touches the stream information, reset when starting.
+		std::atomic<uint32_t> m_ThreadStatus = 0;
+
+		/**
+		 * A period handed to the pipeline worker, in the callback format.
+		 */
+		struct PipelineSlot
+		{
+			std::vector<char*> inputs;
+			std::vector<char*> outputs;
+			uint64_t period = 0; // Period of the audio thread it was handed over in
+			int frames = 0;
+			double sampleRate = 0;
+			uint64_t position = 0;
+			StreamClock clock;
+			std::vector<Event> events;
+		};
+
+		std::unique_ptr<Pipeline> m_Pipeline;        // Runs the callback ahead of the audio thread, if the stream asked for it
+		std::vector<PipelineSlot> m_PipelineSlots;
+		char* m_PipelineMemory = nullptr;             // Channels of all slots, each padded to whole cache lines
+		uint64_t m_PipelinePeriod = 0;                // Periods handed over, audio thread only
+		uint64_t m_PipelineStart = 0;                 // First period since the stream started, audio thread only
+		std::atomic<bool> m_ResetPipeline = false;    // Set when starting, outputs from before are never played
+
+		std::vector<std::shared_ptr<PullStreamBase>> m_PullStreams; // Every pull stream, they live as long as the stream
+		PullStreamBase* m_Pull = nullptr;                            // Pull stream the callback feeds, if any
+
+		std::unique_ptr<Recorder> m_Recording;    // Current or last recording
+		std::atomic<Recorder*> m_Recorder = nullptr; // Recorder the audio thread writes to
+		std::vector<int> m_RecordChannels;
+
+		/**
+		 * Set the state of the stream, regardless of the current state.
+		 * @param state new state
+		 */
+		void State(StreamState state);
+
+		/**
+		 * Atomically move the stream from one state to another.
+		 * @param from state the stream has to be in
+		 * @param to new state
+		 * @return true if the stream was in the from state
+		 */
+		bool Transition(StreamState from, StreamState to);
+
+		/**
+		 * Let the pull stream follow a new state of the stream.
+		 * @param state new state
+		 */
+		void FollowState(StreamState state);
+
+		/**
+		 * Stop feeding the pull stream, when the callback gets replaced.
+		 */
+		void DetachPull();
+
+		/**
+		 * Move the stream from Opened to Starting, so no other Start, Stop or Close can interfere.
+		 * @return
+		 * NotOpen - If the stream wasn't opened<br>
+		 * AlreadyRunning - If the stream is running, starting or stopping<br>
+		 * NoError - If the stream is now starting
+		 */
+		Error BeginStart();
+
+		/**
+		 * Move the stream from Running to Stopping, the audio thread leaves its loop once it sees this.
+		 * @return
+		 * NotOpen - If the stream wasn't opened<br>
+		 * NotRunning - If the stream isn't running<br>
+		 * NoError - If the stream is now stopping
+		 */
+		Error BeginStop();
+
+		void AddCommandQueue(std::unique_ptr<CommandQueueBase>&& queue);
+
+		/**
+		 * Collect the events that are due in the period starting at the given position, realtime safe.
+		 * @param position frame position of the period
+		 * @param frames amount of frames in the period
+		 * @return events in order of their frame, with their offsets set
+		 */
+		std::span<const Event> CollectEvents(uint64_t position, int frames);
+
+		/**
+		 * Allocate the callback buffers, and the resampling stage when the device has its own sample rate.
+		 * Publishes the buffer size and sample rate of the stream information to the audio thread.
+		 * @param frames maximum amount of frames in a device period, 0 for the largest buffer size
+		 */
+		void AllocateBuffers(int frames = 0);
 		void FreeBuffers();
 
+		/**
+		 * Process a single period of non-interleaved device buffers. Converts the input to the format of
+		 * the callback, calls the callback and converts the output back to the device format. When the
+		 * device format equals the callback format the device buffers are given to the callback directly.
+		 * When the device runs at another rate, the device period goes through the resampling stage and
+		 * the callback runs as many periods of the buffer size as that makes available.
+		 * @param deviceInputs input channels in the device input format
+		 * @param deviceOutputs output channels in the device output format
+		 * @param frames amount of frames in this period, at most the amount the buffers were allocated for
+		 * @param time host time of the first frame in seconds if the backend knows it, negative to use the time of the call
+		 */
+		void Process(char** deviceInputs, char** deviceOutputs, int frames, double time = -1);
+
+		/**
+		 * Run the callback for a single period at the sample rate of the stream.
+		 * @param deviceInputs input channels
+		 * @param deviceOutputs output channels
+		 * @param frames amount of frames in this period
+		 * @param time host time of the first frame in seconds
+		 * @param deviceInFormat format of the input channels, may be byte swapped
+		 * @param deviceOutFormat format of the output channels, may be byte swapped
+		 */
+		void Period(char** deviceInputs, char** deviceOutputs, int frames, double time, SampleFormat deviceInFormat, SampleFormat deviceOutFormat);
+
+		/**
+		 * Call the callback, with all channel groups.
+		 * @param inputs input channels in the callback format
+		 * @param outputs output channels in the callback format
+		 * @param frames amount of frames
+		 * @param sampleRate sample rate of the period
+		 * @param position frame position of the period
+		 * @param clock clock of the period
+		 * @param events events due in the period
+		 */
+		void RunCallback(char** inputs, char** outputs, int frames, double sampleRate, uint64_t position, const StreamClock& clock, std::span<const Event> events);
+
+		/**
+		 * Hand a period to the pipeline worker and take the output it finished for an earlier period,
+		 * on the audio thread. Plays silence while the pipeline fills up or when the worker fell behind.
+		 * Same parameters as RunCallback.
+		 */
+		void RunPipelined(char** inputs, char** outputs, int frames, double sampleRate, uint64_t position, const StreamClock& clock, std::span<const Event> events);
+
+		/**
+		 * Allocate the slots of the pipeline and start its worker, when the stream asked for it.
+		 * @param frames maximum amount of frames in a period
+		 */
+		void AllocatePipeline(int frames);
+
+		/**
+		 * Feed the timestamp of a period to the delay-locked loop and publish the new clock.
+		 * @param position frame position of the period
+		 * @param frames amount of frames in the period
+		 * @param time measured host time of the first frame
+		 * @return filtered time and estimated rate
+		 */
+		StreamClock UpdateClock(uint64_t position, int frames, double time);
+
+		/**
+		 * Apply the thread parameters of the stream to the calling thread and publish which ones took
+		 * effect, Information reports them. Backends owning their audio thread call this before
+		 * their loop, for driver owned threads Process calls it at the first period.
+		 * @param fallback policy used when the parameters ask for the default policy
+		 */
+		void ApplyThreadConfiguration(ThreadPolicy fallback = NormalPolicy);
+
+		/**
+		 * Wait until the audio thread left the period it is in, if any. Anything it could reach 
+		 * through an atomic pointer that was cleared before this call is no longer in use after it.
+		 */
+		void Quiesce();
+
 		void ConvertBuffer(char* outBuffer, char* inBuffer, size_t bufferSize, SampleFormat outFormat, SampleFormat inFormat);
 		void ByteSwapBuffer(char* buffer, unsigned int bufferSize, SampleFormat format);
 
 		char** m_InputBuffers = nullptr;
 		char** m_OutputBuffers = nullptr;
+		char* m_BufferMemory = nullptr; // All channels of both buffers, each padded to whole cache lines
 	};
 }
\ No newline at end of file
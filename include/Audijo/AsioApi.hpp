@@ -20,7 +20,8 @@ namespace Audijo
 		ChannelInfo& Channel(int index, bool input) const;
 
 		/**
-		 * Get list of channel information
+		 * Get list of channel information, loads the driver the first time unless it's the opened one.
+		 * Only call it from the thread that controls the stream.
 		 * @return vector of ChannelInfo
 		 */
 		std::vector<ChannelInfo>& Channels() const;
@@ -34,15 +35,18 @@ namespace Audijo
 
 	class AsioApi : public ApiBase
 	{
-		enum State { Loaded, Initialized, Prepared, Running, Reset };
+		enum DriverState { Loaded, Initialized, Prepared, Running };
 	public:
+		using DeviceSnapshot = std::shared_ptr<const DeviceRegistry<DeviceInfo<Asio>>::Snapshot>;
+
 		AsioApi(bool loadDevices = true);
 		~AsioApi();
 		
 		const std::vector<DeviceInfo<Asio>>& Devices(bool reload = false);
-		const DeviceInfo<>& Device(int id) const override { for (auto& i : m_Devices) if (i.id == id) return i; };
-		int DeviceCount() const override { return m_Devices.size(); };
-		const DeviceInfo<Asio>& ApiDevice(int id) const { for (auto& i : m_Devices) if (i.id == id) return i; };
+		const DeviceInfo<>& Device(int id) const override { return ApiDevice(id); };
+		int DeviceCount() const override { return m_Devices->devices.size(); };
+		const DeviceInfo<Asio>& ApiDevice(int id) const { auto _device = m_Devices->Find(id); return _device ? *_device : m_NoDevice; };
+		DeviceSnapshot Snapshot() const { return m_Registry.Read(); }
 
 		Error Open(const StreamParameters& settings = StreamParameters{}) override;
 		Error Start() override;
@@ -55,9 +59,19 @@ namespace Audijo
 		Error OpenControlPanel();
 
 	protected:
-		std::vector<DeviceInfo<Asio>> m_Devices;
+		DeviceRegistry<DeviceInfo<Asio>> m_Registry; // Drivers by name
+		DeviceSnapshot m_Devices = m_Registry.Read(); // Devices as of the last reload
+		DeviceInfo<Asio> m_NoDevice{ { NoDevice, "", 0, 0, {}, false, Asio } };
+
+		std::vector<char*> m_DeviceInputs[2];  // Device input buffers for both double buffer halves
+		std::vector<char*> m_DeviceOutputs[2]; // Device output buffers for both double buffer halves
+		int m_DeviceFrames = 0;                // Frames in the ASIO buffers, only changes while the driver is stopped
+
+		double m_TimeOffset = 0;         // Host time minus driver time, see BufferSwitchTimeInfo
+		bool m_TimeOffsetValid = false;  // Offset gets measured at the first buffer switch
 
-		DeviceInfo<Asio>* DeviceById(int id);
+		const DeviceInfo<Asio>* DeviceById(int id) const;
+		void CollectDeviceBuffers();
 
 		static void SampleRateDidChange(ASIOSampleRate);
 		static long AsioMessage(long, long, void*, double*);
@@ -66,7 +80,7 @@ namespace Audijo
 		static ASIOCallbacks m_Callbacks;
 		static ASIOBufferInfo* m_BufferInfos;
 		static AsioApi* m_AsioApi;
-		static State m_State;
+		static DriverState m_DriverState;
 
 		friend class DeviceInfo<Asio>;
 	};
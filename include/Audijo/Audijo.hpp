@@ -3,6 +3,11 @@
 #include "Audijo/ApiBase.hpp"
 #include "Audijo/AsioApi.hpp"
 #include "Audijo/WasapiApi.hpp"
+#include "Audijo/PipeWireApi.hpp"
+#include "Audijo/SharedMemoryApi.hpp"
+#include "Audijo/NullApi.hpp"
+#include "Audijo/DiskStreamer.hpp"
+#include "Audijo/PullStream.hpp"
 
 namespace Audijo
 {
@@ -10,7 +15,7 @@ namespace Audijo
 	 * Main stream object, with unspecified Api, so it can be dynamically set. To access api specific functions
 	 * you need to cast to an api specific Stream object.
 	 */
-	template<Api api = Unspecified>
+	template<Audijo::Api A = Unspecified>
 	class Stream
 	{
 	public:
@@ -18,7 +23,7 @@ namespace Audijo
 		 * Constructor
 		 * @param api Api
 		 */
-		Stream(Api api, bool loadDevices = true)
+		Stream(Audijo::Api api, bool loadDevices = true)
 		{
 			Api(api, loadDevices);
 		}
@@ -46,7 +51,14 @@ namespace Audijo
 		 * Get stream information. This call only returns useful information after the stream has been opened.
 		 * @return stream information
 		 */
-		const StreamInformation& Information() const { return m_Api->Information(); }
+		StreamInformation Information() const { return m_Api->Information(); }
+
+		/**
+		 * Get the current state of the stream, unlike the state in the stream information
+		 * this is safe to call from any thread, at any time.
+		 * @return state
+		 */
+		StreamState State() const { return !m_Api ? Closed : m_Api->State(); }
 
 		/**
 		 * Set the callback. A valid callback signare is:
@@ -76,6 +88,38 @@ namespace Audijo
 			if (m_Api) m_Api->Callback(std::make_unique<CallbackWrapper<Lambda, typename LambdaSignature<Lambda>::type>>(callback));
 		};
 
+		/**
+		 * Set a callback that processes groups of channels in parallel. Each period the callback is called
+		 * once for every group, with buffers containing only the channels of that group and the index of 
+		 * the group in <code>CallbackInfo::group</code>. The first group is processed on the audio thread, 
+		 * every other group on its own worker thread. Uses the same signatures as <code>Callback</code>.
+		 * Output channels that are in no group are silent. Can't be set while the stream is running.
+		 * @param groups channel groups, no channel can be in more than one group
+		 * @param callback
+		 * @return AlreadyRunning if the stream is running, InvalidChannelGroups if groups overlap
+		 */
+		template<typename ...Args> requires ValidCallback<void, Args...>
+		Error GroupCallback(const std::vector<ChannelGroup>& groups, void(*callback)(Args...))
+		{
+			return Control([&]() { return m_Api->GroupCallback(groups, std::make_unique<CallbackWrapper<void(*)(Args...), void(Args...)>>(callback)); });
+		};
+
+		/**
+		 * Set a callback that processes groups of channels in parallel. Each period the callback is called
+		 * once for every group, with buffers containing only the channels of that group and the index of 
+		 * the group in <code>CallbackInfo::group</code>. The first group is processed on the audio thread, 
+		 * every other group on its own worker thread. Uses the same signatures as <code>Callback</code>.
+		 * Output channels that are in no group are silent. Can't be set while the stream is running.
+		 * @param groups channel groups, no channel can be in more than one group
+		 * @param callback
+		 * @return AlreadyRunning if the stream is running, InvalidChannelGroups if groups overlap
+		 */
+		template<typename Lambda> requires LambdaConstraint<Lambda>
+		Error GroupCallback(const std::vector<ChannelGroup>& groups, Lambda callback)
+		{
+			return Control([&]() { return m_Api->GroupCallback(groups, std::make_unique<CallbackWrapper<Lambda, typename LambdaSignature<Lambda>::type>>(callback)); });
+		};
+
 		/**
 		 * Open the stream. The StreamSettings are optional, when they are left out a default device
 		 * with a default buffer size and sample rate will be opened.
@@ -92,7 +136,7 @@ namespace Audijo
 		 * InvalidBufferSize - If the buffer size is not supported<br>
 		 * NoError - If stream started successfully
 		 */
-		Error Open(const StreamParameters& settings = StreamParameters{}) { return !m_Api ? NoApi : m_Api->Open(settings); };
+		Error Open(const StreamParameters& settings = StreamParameters{}) { return Control([&]() { return m_Api->Open(settings); }); };
 
 		/**
 		 * Starts the flow of audio through the opened stream. Does nothing
@@ -104,7 +148,7 @@ namespace Audijo
 		 * Fail - If device failed to start<br>
 		 * NoError - If stream started successfully
 		 */
-		Error Start() { return !m_Api ? NoApi : m_Api->Start(); };
+		Error Start() { return Control([&]() { return m_Api->Start(); }); };
 
 		/**
 		 * Stop the flow of audio through the stream. Does nothing if the
@@ -116,7 +160,7 @@ namespace Audijo
 		 * Fail - If device failed to stop<br>
 		 * NoError - If stream stopped successfully
 		 */
-		Error Stop() { return !m_Api ? NoApi : m_Api->Stop(); };
+		Error Stop() { return Control([&]() { return m_Api->Stop(); }); };
 
 		/**
 		 * Close the stream. Also stops the stream if it hasn't been stopped yet.
@@ -127,7 +171,34 @@ namespace Audijo
 		 * Fail - If device failed to close<br>
 		 * NoError - If stream stopped successfully
 		 */
-		Error Close() { return !m_Api ? NoApi : m_Api->Close(); };
+		Error Close() { return Control([&]() { return m_Api->Close(); }); };
+
+		/**
+		 * Open the stream without blocking. Asynchronous calls run on an executor thread of the stream,
+		 * one after the other in the order they were made, so a start right after an open waits for it.
+		 * Every stream has its own executor, several streams open in parallel.
+		 * @param settings <code>StreamSettings</code>
+		 * @return future with the result of <code>Open</code>
+		 */
+		std::future<Error> OpenAsync(const StreamParameters& settings = StreamParameters{}) { return Async([settings](ApiBase& api) { return api.Open(settings); }); }
+
+		/**
+		 * Start the stream without blocking, see <code>OpenAsync</code>.
+		 * @return future with the result of <code>Start</code>
+		 */
+		std::future<Error> StartAsync() { return Async([](ApiBase& api) { return api.Start(); }); }
+
+		/**
+		 * Stop the stream without blocking, see <code>OpenAsync</code>.
+		 * @return future with the result of <code>Stop</code>
+		 */
+		std::future<Error> StopAsync() { return Async([](ApiBase& api) { return api.Stop(); }); }
+
+		/**
+		 * Close the stream without blocking, see <code>OpenAsync</code>.
+		 * @return future with the result of <code>Close</code>
+		 */
+		std::future<Error> CloseAsync() { return Async([](ApiBase& api) { return api.Close(); }); }
 
 		/**
 		 * Set the userdata
@@ -137,41 +208,188 @@ namespace Audijo
 		void UserData(T& data) { if (m_Api) m_Api->UserData(data); };
 
 		/**
-		 * Set the sample rate of the stream.
+		 * Current position of the stream's frame clock, the frame the next period starts at.
+		 * @return frame position
+		 */
+		uint64_t Position() const { return !m_Api ? 0 : m_Api->Position(); }
+
+		/**
+		 * Relation between the frame clock and the host clock as of the last period, can be used
+		 * to schedule events at a host time. Lock-free, can be called from any thread.
+		 * @return stream clock
+		 */
+		StreamClock Clock() const { return !m_Api ? StreamClock{} : m_Api->Clock(); }
+
+		/**
+		 * Resampling bridge between the input and output device, only present while a duplex stream
+		 * runs on two devices with their own clocks. Shows the drift ratio and any under- or overruns.
+		 * @return bridge, or nullptr
+		 */
+		const DuplexBridge* Bridge() const { return !m_Api ? nullptr : m_Api->Bridge(); }
+
+		/**
+		 * Timing of every stage of the periods so far, with the load as a percentage of the period
+		 * duration, and the dropouts of every kind. Lock-free, can be called from any thread. The
+		 * timing is empty when Audijo was built without AUDIJO_STATISTICS.
+		 * @return statistics
+		 */
+		StreamStatistics Statistics() const { return !m_Api ? StreamStatistics{} : m_Api->Statistics(); }
+
+		/**
+		 * Start the statistics over, takes effect at the next period.
+		 */
+		void ResetStatistics() { if (m_Api) m_Api->ResetStatistics(); }
+
+		/**
+		 * Enable the feed of dropouts, so a control thread can react to every single one.
+		 * Dropouts before enabling aren't in the feed.
+		 * @param enable enable
+		 */
+		void XrunFeed(bool enable) { if (m_Api) m_Api->XrunFeed(enable); }
+
+		/**
+		 * Take the oldest dropout from the feed. Lock-free, can be called from any thread.
+		 * @param xrun dropout
+		 * @return false if the feed is empty
+		 */
+		bool NextXrun(Xrun& xrun) { return m_Api && m_Api->NextXrun(xrun); }
+
+		/**
+		 * Set the listener for notifications like a lost device or a driver reset. The audio and
+		 * driver threads post them lock-free, the listener is called on a separate notification 
+		 * thread of the stream, after which the restart policy in <code>StreamParameters::restart</code> 
+		 * is applied on that same thread. The outcome of a restart is notified as well.
+		 * @param listener listener, empty to remove it
+		 */
+		void Listener(std::function<void(const Notification&)> listener) { if (m_Api) m_Api->Listener(std::move(listener)); }
+
+		/**
+		 * Close the stream and open it again with the parameters it was opened with, and start it
+		 * again if it was running. Devices opened as <code>Default</code> become the current default
+		 * device. Can be called from the listener.
+		 * @return
+		 * NotOpen - If the stream wasn't opened<br>
+		 * NoApi - If no Api was specified<br>
+		 * Any error of Open or Start, the stream is closed when there is one
+		 */
+		Error Restart() { return Control([&]() { return m_Api->Restart(); }); }
+
+		/**
+		 * Schedule an event, it's delivered in <code>CallbackInfo::events</code> of the period that contains
+		 * its frame, with its offset in that period. Lock-free, can be called from any thread.
+		 * @param event event
+		 * @return false if too many events are waiting
+		 */
+		bool Schedule(const Event& event) { return m_Api && m_Api->Schedule(event); }
+
+		/**
+		 * Schedule an event with a payload, see <code>Event::Make</code>.
+		 * @param frame frame on the stream's frame clock
+		 * @param type user defined type of the payload
+		 * @param value payload
+		 * @return false if too many events are waiting
+		 */
+		template<typename T>
+		bool Schedule(uint64_t frame, uint32_t type, const T& value) { return Schedule(Event::Make(frame, type, value)); }
+
+		/**
+		 * Attach a command queue to the stream. Control threads send messages through the returned
+		 * queue, the handler is called with <code>T&</code> for every message on the audio thread at
+		 * the start of each period, before the callback. Handled messages are destroyed by the next
+		 * <code>Send</code> or <code>Collect</code> on the queue, never on the audio thread, so a
+		 * message can carry ownership of something the callback replaced. The queue lives as long 
+		 * as the stream.
+		 * @param capacity maximum amount of messages waiting for the audio thread
+		 * @param handler handler
+		 * @return command queue
+		 */
+		template<typename T, typename Handler>
+		CommandQueue<T>& Commands(std::size_t capacity, Handler&& handler) { return m_Api->template Commands<T>(capacity, std::forward<Handler>(handler)); }
+
+		/**
+		 * Use the stream in pull mode, the consumer reads the input and writes the output itself instead
+		 * of getting called back. Replaces the callback, set it before opening the stream. Every period
+		 * goes through a lock-free ring between the audio thread and the consumer, a read waits for input
+		 * and a write for room without spinning, <code>co_await</code> them to wait in a coroutine instead.
+		 * The pull stream lives as long as the stream, it stops getting periods when the callback is replaced.
+		 * @tparam T sample type of the callback buffers
+		 * @param periods amount of periods the rings hold, the latency the consumer can add
+		 * @return pull stream
+		 */
+		template<typename T = float>
+		PullStream<T>& Pull(std::size_t periods = 4) { return m_Api->template Pull<T>(periods); }
+
+		/**
+		 * Record channels of the stream to a 32 bit float WAV file, RF64 once it grows past 4GB. The audio
+		 * thread only copies each period into a preallocated ring, a background thread writes it to disk.
+		 * When the disk can't keep up periods are dropped and counted, the audio thread never blocks.
+		 * A recording that is still running is stopped first.
+		 * @param path file to record to
+		 * @param channels channels to record, input channels are numbered first followed by the output 
+		 * channels. When empty all channels are recorded.
+		 * @return
+		 * NotOpen - If the stream wasn't opened<br>
+		 * NoApi - If no Api was specified<br>
+		 * Fail - If a channel doesn't exist or the file couldn't be created<br>
+		 * NoError - If recording started successfully
+		 */
+		Error Record(const std::string& path, const std::vector<int>& channels = {}) { return !m_Api ? NoApi : m_Api->Record(path, channels); };
+
+		/**
+		 * Stop recording and finish the file. Also happens when the stream is closed.
+		 * @return
+		 * NoApi - If no Api was specified<br>
+		 * NotRunning - If there's no recording running<br>
+		 * NoError - If recording stopped successfully
+		 */
+		Error StopRecording() { return !m_Api ? NoApi : m_Api->StopRecording(); };
+
+		/**
+		 * Get information about the current or last recording, like the amount of dropped periods.
+		 * @return recording information
+		 */
+		RecordingInformation Recording() const { return !m_Api ? RecordingInformation{} : m_Api->Recording(); };
+
+		/**
+		 * Set the sample rate of the stream. A running stream switches at the start of its next period,
+		 * without allocating or stopping, when the backend supports it.
 		 * @param srate sample rate
 		 * @return
 		 * NotOpen - If no device is open.
 		 * NoApi - If no Api was specified<br>
 		 * InvalidSampleRate - If the sample rate is not supported
+		 * AlreadyRunning - If the stream can't change its sample rate while running
 		 * Fail - If changing the sample rate at this time is not supported, or general fail.
 		 * NoError - If sample rate successfully changed
 		 */
-		Error SetSampleRate(double srate) { return !m_Api ? NoApi : m_Api->SampleRate(srate); };
+		Error SetSampleRate(double srate) { return Control([&]() { return m_Api->SampleRate(srate); }); };
 		
 		/**
-		 * Set the sample rate of the stream.
-		 * @param srate sample rate
+		 * Set the buffer size of the stream. A running stream switches at the start of its next period,
+		 * without allocating or stopping, as long as the size fits <code>StreamParameters::maxBufferSize</code>.
+		 * @param size buffer size
 		 * @return
 		 * NotOpen - If no device is open.
 		 * NoApi - If no Api was specified<br>
-		 * InvalidBufferSize - If the buffer size is not supported
+		 * InvalidBufferSize - If the buffer size is not supported, or larger than the maximum while running
+		 * AlreadyRunning - If the stream can't change its buffer size while running
 		 * Fail - If changing the buffer size at this time is not supported, or general fail.
-		 * NoError - If sample rate successfully changed
+		 * NoError - If buffer size successfully changed
 		 */
-		Error SetBufferSize(std::size_t size) { return !m_Api ? NoApi : m_Api->BufferSize(size); };
+		Error SetBufferSize(std::size_t size) { return Control([&]() { return m_Api->BufferSize(size); }); };
 
 		/**
 		 * Get this Stream object as a specific api, to expose api specific functions.
 		 * @return this as a stream object for a specific api
 		 */
-		template<Api api>
-		Stream<api>& Get() { return *(Stream<api>*)this; }
+		template<Audijo::Api Type>
+		Stream<Type>& Get() { return *(Stream<Type>*)this; }
 
 		/**
 		 * Set the api.
 		 * @param api api
 		 */
-		virtual void Api(Api api, bool loadDevices = true)
+		virtual void Api(Audijo::Api api, bool loadDevices = true)
 		{
 			m_Type = api;
 			switch (api)
@@ -182,7 +400,16 @@ namespace Audijo
 #ifdef AUDIJO_WASAPI
 			case Wasapi: m_Api = std::make_unique<WasapiApi>(loadDevices); break;
 #endif
-			default: throw std::exception("Incompatible api");
+#ifdef AUDIJO_PIPEWIRE
+			case PipeWire: m_Api = std::make_unique<PipeWireApi>(loadDevices); break;
+#endif
+#ifdef AUDIJO_SHAREDMEMORY
+			case SharedMemory: m_Api = std::make_unique<SharedMemoryApi>(loadDevices); break;
+#endif
+#ifdef AUDIJO_NULL
+			case Null: m_Api = std::make_unique<NullApi>(loadDevices); break;
+#endif
+			default: throw std::invalid_argument("Incompatible api");
 			}
 		}
 
@@ -195,6 +422,38 @@ namespace Audijo
 	protected:
 		std::unique_ptr<ApiBase> m_Api = nullptr;
 		Audijo::Api m_Type = Unspecified;
+
+		/**
+		 * Run a control call on the api, never at the same time as a restart by the restart policy.
+		 * @param call control call
+		 * @return NoApi if no Api was specified, otherwise the result of the call
+		 */
+		template<typename Call>
+		Error Control(Call call)
+		{
+			if (!m_Api)
+				return NoApi;
+
+			std::lock_guard _lock{ m_Api->ControlMutex() };
+			return call();
+		}
+
+		/**
+		 * Run a control call on the executor of the api.
+		 * @param call control call
+		 * @return future with NoApi if no Api was specified, otherwise with the result of the call
+		 */
+		std::future<Error> Async(std::function<Error(ApiBase&)> call)
+		{
+			if (!m_Api)
+			{
+				std::promise<Error> _result;
+				_result.set_value(NoApi);
+				return _result.get_future();
+			}
+
+			return m_Api->Execute(std::move(call));
+		}
 	};
 
 #ifdef AUDIJO_WASAPI
@@ -206,7 +465,7 @@ namespace Audijo
 	class Stream<Wasapi> : public Stream<>
 	{
 		// Delete methods
-		void Api(Audijo::Api api, bool loadDevices = true) override {};
+		void Api(Audijo::Api, bool = true) override {};
 		using Stream<>::Get;
 
 	public:
@@ -215,11 +474,20 @@ namespace Audijo
 		{}
 
 		/**
-		 * Search for all available devices. When called more than once, the list will be updated.
+		 * Search for all available devices. A device keeps its id across reloads, for as long as the
+		 * stream exists. The list stays valid until the next reload, use Snapshot on other threads.
+		 * @param reload search again, otherwise returns the devices of the last search
 		 * @return all available devices given the chosen api.
 		 */
 		const std::vector<DeviceInfo<Wasapi>>& Devices(bool reload = false) const { return ((WasapiApi*)m_Api.get())->Devices(reload); }
 
+		/**
+		 * Get the devices as they are right now, the snapshot stays the same while it's held. Safe to
+		 * call from any thread, also while another thread reloads the devices.
+		 * @return snapshot of the devices
+		 */
+		WasapiApi::DeviceSnapshot Snapshot() const { return ((WasapiApi*)m_Api.get())->Snapshot(); }
+
 		/**
 		 * Returns device with the given id.
 		 * @param id device id
@@ -240,7 +508,7 @@ namespace Audijo
 	class Stream<Asio> : public Stream<>
 	{
 		// Delete the api method
-		void Api(Audijo::Api api, bool loadDevices = true) override {};
+		void Api(Audijo::Api, bool = true) override {};
 	
 	public:
 		Stream(bool loadDevices = true)
@@ -256,11 +524,20 @@ namespace Audijo
 		Error OpenControlPanel() { return ((AsioApi*)m_Api.get())->OpenControlPanel(); }
 
 		/**
-		 * Search for all available devices. When called more than once, the list will be updated.
+		 * Search for all available devices. A device keeps its id across reloads, for as long as the
+		 * stream exists. The list stays valid until the next reload, use Snapshot on other threads.
+		 * @param reload search again, otherwise returns the devices of the last search
 		 * @return all available devices given the chosen api.
 		 */
 		const std::vector<DeviceInfo<Asio>>& Devices(bool reload = false) const { return ((AsioApi*)m_Api.get())->Devices(reload); }
 
+		/**
+		 * Get the devices as they are right now, the snapshot stays the same while it's held. Safe to
+		 * call from any thread, also while another thread reloads the devices.
+		 * @return snapshot of the devices
+		 */
+		AsioApi::DeviceSnapshot Snapshot() const { return ((AsioApi*)m_Api.get())->Snapshot(); }
+
 		/**
 		 * Returns device with the given id.
 		 * @param id device id
@@ -272,7 +549,208 @@ namespace Audijo
 	};
 #endif
 
+#ifdef AUDIJO_PIPEWIRE
+	/**
+	 * PipeWire specific Stream object, for when api is decided at compiletime,
+	 * exposes api specific functions directly.
+	 */
+	template<>
+	class Stream<PipeWire> : public Stream<>
+	{
+		// Delete the api method
+		void Api(Audijo::Api, bool = true) override {};
+
+	public:
+		Stream(bool loadDevices = true)
+			: Stream<>(PipeWire, loadDevices)
+		{}
+
+		/**
+		 * Search for all available devices. A device keeps its id across reloads, for as long as the
+		 * stream exists. The list stays valid until the next reload, use Snapshot on other threads.
+		 * @param reload search again, otherwise returns the devices of the last search
+		 * @return all available devices given the chosen api.
+		 */
+		const std::vector<DeviceInfo<PipeWire>>& Devices(bool reload = false) const { return ((PipeWireApi*)m_Api.get())->Devices(reload); }
+
+		/**
+		 * Get the devices as they are right now, the snapshot stays the same while it's held. Safe to
+		 * call from any thread, also while another thread reloads the devices.
+		 * @return snapshot of the devices
+		 */
+		PipeWireApi::DeviceSnapshot Snapshot() const { return ((PipeWireApi*)m_Api.get())->Snapshot(); }
+
+		/**
+		 * Returns device with the given id.
+		 * @param id device id
+		 * @return device with id
+		 */
+		const DeviceInfo<PipeWire>& Device(int id) const { return ((PipeWireApi*)m_Api.get())->ApiDevice(id); }
+
+		virtual Audijo::Api Api() const override { return PipeWire; };
+	};
+#endif
+
+#ifdef AUDIJO_SHAREDMEMORY
+	/**
+	 * Shared memory specific Stream object, for when api is decided at compiletime,
+	 * exposes api specific functions directly.
+	 */
+	template<>
+	class Stream<SharedMemory> : public Stream<>
+	{
+		// Delete the api method
+		void Api(Audijo::Api, bool = true) override {};
+
+	public:
+		Stream(bool loadDevices = true)
+			: Stream<>(SharedMemory, loadDevices)
+		{}
+
+		/**
+		 * Search for all available segments. A segment keeps its id across reloads, for as long as the
+		 * stream exists. The list stays valid until the next reload, use Snapshot on other threads.
+		 * @param reload search again, otherwise returns the segments of the last search
+		 * @return all available segments.
+		 */
+		const std::vector<DeviceInfo<SharedMemory>>& Devices(bool reload = false) const { return ((SharedMemoryApi*)m_Api.get())->Devices(reload); }
+
+		/**
+		 * Get the devices as they are right now, the snapshot stays the same while it's held. Safe to
+		 * call from any thread, also while another thread reloads the devices.
+		 * @return snapshot of the devices
+		 */
+		SharedMemoryApi::DeviceSnapshot Snapshot() const { return ((SharedMemoryApi*)m_Api.get())->Snapshot(); }
+
+		/**
+		 * Returns segment with the given id.
+		 * @param id device id
+		 * @return segment with id
+		 */
+		const DeviceInfo<SharedMemory>& Device(int id) const { return ((SharedMemoryApi*)m_Api.get())->ApiDevice(id); }
+
+		/**
+		 * Create a new segment, it will show up as a device in all processes. One process can
+		 * open it as output, another as input.
+		 * @param name segment name
+		 * @param channels amount of channels
+		 * @param bufferSize frames per period
+		 * @param sampleRate sample rate
+		 * @param periods amount of periods in the ring
+		 * @param format sample format of the audio in the segment
+		 * @return
+		 * AlreadyOpen - If a segment with this name already exists<br>
+		 * NoMemory - If the segment could not be allocated<br>
+		 * NoError - On success
+		 */
+		Error Create(const std::string& name, int channels, int bufferSize, double sampleRate, int periods = 4, SampleFormat format = Float32)
+		{
+			return ((SharedMemoryApi*)m_Api.get())->Create(name, channels, bufferSize, sampleRate, periods, format);
+		}
+
+		/**
+		 * Remove a segment. Processes that have it opened keep using it until they close.
+		 * @param name segment name
+		 * @return
+		 * NotPresent - If there's no segment with this name<br>
+		 * NoError - On success
+		 */
+		Error Remove(const std::string& name) { return ((SharedMemoryApi*)m_Api.get())->Remove(name); }
+
+		virtual Audijo::Api Api() const override { return SharedMemory; };
+	};
+#endif
+
 	Stream(Api)->Stream<Unspecified>;
 	Stream()->Stream<Unspecified>;
+
+#ifdef AUDIJO_NULL
+	/**
+	 * Null specific Stream object, for when api is decided at compiletime,
+	 * exposes api specific functions directly.
+	 */
+	template<>
+	class Stream<Null> : public Stream<>
+	{
+		// Delete the api method
+		void Api(Audijo::Api, bool = true) override {};
+
+	public:
+		Stream(bool loadDevices = true)
+			: Stream<>(Null, loadDevices)
+		{}
+
+		/**
+		 * Get the devices, a duplex device, a separate input and output device and the plugged in ones.
+		 * The list stays valid until the next reload, use Snapshot on other threads.
+		 * @param reload pick up devices that were plugged in or unplugged since the last reload
+		 * @return all available devices given the chosen api.
+		 */
+		const std::vector<DeviceInfo<Null>>& Devices(bool reload = false) const { return ((NullApi*)m_Api.get())->Devices(reload); }
+
+		/**
+		 * Get the devices as they are right now, the snapshot stays the same while it's held. Safe to
+		 * call from any thread, also while devices get plugged and unplugged.
+		 * @return snapshot of the devices
+		 */
+		NullApi::DeviceSnapshot Snapshot() const { return ((NullApi*)m_Api.get())->Snapshot(); }
+
+		/**
+		 * Plug in a device, or change the channels of a plugged in device with the same name. A
+		 * device that gets plugged in again gets back its old id. With a probe delay the device is
+		 * listed right away, its channels fill in once the probe finishes.
+		 * @param name device name
+		 * @param inputs amount of input channels
+		 * @param outputs amount of output channels
+		 * @return device id, NoDevice if the name is taken by one of the built-in devices
+		 */
+		int Plug(const std::string& name, int inputs, int outputs) { return ((NullApi*)m_Api.get())->Plug(name, inputs, outputs); }
+
+		/**
+		 * Let probing the capabilities of plugged in devices take time, like a driver would.
+		 * @param seconds time a single probe takes
+		 */
+		void ProbeDelay(double seconds) { ((NullApi*)m_Api.get())->ProbeDelay(seconds); }
+
+		/**
+		 * Wait for the devices that are still being probed.
+		 * @return future that's ready once all devices plugged in so far are probed
+		 */
+		std::shared_future<void> Probed() const { return ((NullApi*)m_Api.get())->Probed(); }
+
+		/**
+		 * Unplug a device. A running stream that uses it stops processing and notifies DeviceLost.
+		 * @param id device id
+		 * @return NotPresent if the device doesn't exist
+		 */
+		Error Unplug(int id) { return Control([&]() { return ((NullApi*)m_Api.get())->Unplug(id); }); }
+
+		/**
+		 * Let the clock of a built-in device run fast or slow, applies from the next start.
+		 * @param id device id
+		 * @param ppm deviation from the sample rate in parts per million
+		 * @return NotPresent if the device doesn't exist
+		 */
+		Error ClockSkew(int id, double ppm) { return ((NullApi*)m_Api.get())->ClockSkew(id, ppm); }
+
+		/**
+		 * Act as if the driver posted a notification, to try out the listener and the restart policy.
+		 * After DeviceLost or StreamFailed the audio stops like it would with a failing device.
+		 * @param type type
+		 * @param value value of the notification
+		 * @return NotRunning if the stream isn't running
+		 */
+		Error Simulate(NotificationType type, double value = 0) { return ((NullApi*)m_Api.get())->Simulate(type, value); }
+
+		/**
+		 * Returns device with the given id.
+		 * @param id device id
+		 * @return device with id
+		 */
+		const DeviceInfo<Null>& Device(int id) const { return ((NullApi*)m_Api.get())->ApiDevice(id); }
+
+		virtual Audijo::Api Api() const override { return Null; };
+	};
+#endif
 }
 
@@ -4,6 +4,47 @@
 
 namespace Audijo
 {
+	/**
+	 * Event scheduled on the stream's frame clock, delivered to the callback in the period that
+	 * contains its frame. Carries a small trivially copyable payload, like a parameter change or note.
+	 */
+	struct Event
+	{
+		constexpr static std::size_t MaxSize = 32;
+
+		uint64_t frame = 0; // Frame on the stream's frame clock
+		int offset = 0;     // Offset of the frame inside the current period, set when delivered
+		uint32_t type = 0;  // User defined type of the payload
+		alignas(8) unsigned char data[MaxSize]{};
+
+		/**
+		 * Create an event.
+		 * @param frame frame on the stream's frame clock
+		 * @param type user defined type of the payload
+		 * @param value payload
+		 * @return event
+		 */
+		template<typename T> requires (std::is_trivially_copyable_v<T> && sizeof(T) <= MaxSize && alignof(T) <= 8)
+		static Event Make(uint64_t frame, uint32_t type, const T& value)
+		{
+			Event _event{ frame, 0, type };
+			std::memcpy(_event.data, &value, sizeof(T));
+			return _event;
+		}
+
+		/**
+		 * Get the payload.
+		 * @return payload
+		 */
+		template<typename T> requires (std::is_trivially_copyable_v<T> && sizeof(T) <= MaxSize && alignof(T) <= 8)
+		T As() const
+		{
+			T _value;
+			std::memcpy(&_value, data, sizeof(T));
+			return _value;
+		}
+	};
+
 	/**
 	 * Information given inside of the callback.
 	 */
@@ -28,6 +69,39 @@ namespace Audijo
 		 * Sample rate
 		 */
 		double sampleRate;
+
+		/**
+		 * Channel group this call processes, always 0 for a normal callback.
+		 */
+		int group = 0;
+
+		/**
+		 * Position of the first frame of this period on the stream's frame clock.
+		 */
+		uint64_t position = 0;
+
+		/**
+		 * Host time of the first frame of this period in seconds, see HostTime. Filtered
+		 * by a delay-locked loop, so it follows the device clock without the jitter.
+		 */
+		double time = 0;
+
+		/**
+		 * Estimated actual sample rate of the device, measured against the host clock.
+		 */
+		double rate = 0;
+
+		/**
+		 * Events due in this period, in order of their frame. Events that arrived
+		 * too late for their frame are delivered at offset 0.
+		 */
+		std::span<const Event> events;
+
+		/**
+		 * Set by the watchdog when the callback went over its budget several periods
+		 * in a row, switch to a cheaper path until it clears. Only with FlagOverload.
+		 */
+		bool overload = false;
 	};
 
 	// Get elements from template packs.
@@ -74,13 +148,20 @@ namespace Audijo
 		|| std::is_same_v<Format, Buffer<float>&>
 		|| std::is_same_v<Format, Buffer<double>&>;
 
-	// Valid callback signature
-	template<typename Ret, typename InFormat, typename OutFormat, typename CI,  typename ...UserData>
-	concept ValidCallback = std::is_same_v<Ret, void>      // Return must be void
+	// Valid callback signature, as a trait so the argument pack can be expanded into it
+	template<typename Ret, typename ...Args>
+	struct ValidCallbackSignature : std::false_type {};
+	template<typename Ret, typename InFormat, typename OutFormat, typename CI, typename ...UserData>
+	struct ValidCallbackSignature<Ret, InFormat, OutFormat, CI, UserData...> : std::bool_constant<
+		std::is_same_v<Ret, void>                          // Return must be void
 		&& ValidFormat<InFormat> && ValidFormat<OutFormat> // First 2 must be valid formats
 		&& std::is_same_v<CI, CallbackInfo>
 		&& sizeof...(UserData) <= 1 && ((std::is_reference_v<UserData> && ...) 
-			|| (std::is_pointer_v<UserData> && ...));      // userdata is optional, must be reference or pointer
+			|| (std::is_pointer_v<UserData> && ...))>      // userdata is optional, must be reference or pointer
+	{};
+
+	template<typename Ret, typename ...Args>
+	concept ValidCallback = ValidCallbackSignature<Ret, Args...>::value;
 
 	// Signature check for lambdas
 	template<typename T>
@@ -156,12 +237,12 @@ namespace Audijo
 			InType _in;
 			OutType _out;
 			if constexpr (std::is_class_v<InType>)
-				_in = InType{ reinterpret_cast<InType::Type**>(in), info.inputChannels, info.bufferSize };
+				_in = InType{ reinterpret_cast<typename InType::Type**>(in), info.inputChannels, info.bufferSize };
 			else
 				_in = reinterpret_cast<InType>(in);
 
 			if constexpr (std::is_class_v<OutType>)
-				_out = OutType{ reinterpret_cast<OutType::Type**>(out), info.outputChannels, info.bufferSize };
+				_out = OutType{ reinterpret_cast<typename OutType::Type**>(out), info.outputChannels, info.bufferSize };
 			else
 				_out = reinterpret_cast<OutType>(out);
 
@@ -0,0 +1,110 @@
+#pragma once
+#include "Audijo/pch.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Current time of the host clock, the clock all stream timestamps are on.
+	 * @return seconds on std::chrono::steady_clock
+	 */
+	inline double HostTime()
+	{
+		return std::chrono::duration<double>{ std::chrono::steady_clock::now().time_since_epoch() }.count();
+	}
+
+	/**
+	 * Relation between the frame clock of a stream and the host clock, as of the last period.
+	 */
+	struct StreamClock
+	{
+		uint64_t position = 0; // Frame position of the first frame of the last period
+		double time = 0;       // Host time of that frame in seconds, see HostTime
+		double rate = 0;       // Estimated actual sample rate of the device, 0 if the stream never ran
+
+		/**
+		 * Estimate the host time of a frame.
+		 * @param frame frame position
+		 * @return host time in seconds
+		 */
+		double Time(uint64_t frame) const { return time + ((double)frame - (double)position) / rate; }
+
+		/**
+		 * Estimate the frame that plays at a host time.
+		 * @param t host time in seconds
+		 * @return frame position, 0 for times before the start of the frame clock
+		 */
+		uint64_t Frame(double t) const { return (uint64_t)std::max(std::round(position + (t - time) * rate), 0.); }
+	};
+
+	/**
+	 * Delay-locked loop filtering the jittery timestamps of periods into a smooth estimate of
+	 * their time and of the actual period duration of the device.
+	 */
+	class DelayLockedLoop
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param bandwidth bandwidth of the loop in Hz, lower is smoother but slower to follow
+		 */
+		DelayLockedLoop(double bandwidth = 1.)
+			: m_Bandwidth(bandwidth)
+		{}
+
+		/**
+		 * Restart the loop.
+		 * @param time measured time of the current period
+		 * @param period nominal duration of a period
+		 */
+		void Reset(double time, double period)
+		{
+			double _omega = 2 * std::numbers::pi * m_Bandwidth * period;
+			m_B = std::numbers::sqrt2 * _omega;
+			m_C = _omega * _omega;
+			m_Period = period;
+			m_Time = time;
+			m_Next = time + period;
+		}
+
+		/**
+		 * Update the loop at the start of a period, the periods have to be of the same length.
+		 * @param time measured time of the current period
+		 * @return false if periods went missing, the loop has to be reset
+		 */
+		bool Update(double time)
+		{
+			double _error = time - m_Next;
+			if (_error > m_Period)
+				return false;
+
+			// Periods catching up after a stall are early, only follow them as fast as the
+			// loop allows so the filtered time never moves back
+			_error = std::max(_error, -m_Period);
+
+			m_Time = m_Next;
+			m_Next += m_B * _error + m_Period;
+			m_Period += m_C * _error;
+			return true;
+		}
+
+		/**
+		 * Filtered time of the current period.
+		 * @return time
+		 */
+		double Time() const { return m_Time; }
+
+		/**
+		 * Filtered duration of a period.
+		 * @return duration
+		 */
+		double Period() const { return m_Period; }
+
+	private:
+		double m_Bandwidth;
+		double m_B = 0;
+		double m_C = 0;
+		double m_Period = 0;
+		double m_Time = 0;
+		double m_Next = 0;
+	};
+}
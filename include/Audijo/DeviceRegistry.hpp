@@ -0,0 +1,355 @@
+#pragma once
+#include "Audijo/pch.hpp"
+#include "Audijo/ThreadPool.hpp"
+
+namespace Audijo
+{
+	/**
+	 * A device that was added, removed or changed by an update of a DeviceRegistry.
+	 */
+	struct DeviceChange
+	{
+		enum Type { Added, Removed, Changed } type;
+		int id;          // Device id
+		std::string key; // Key of the device
+	};
+
+	/**
+	 * Devices of a backend, indexed by id, by a key the backend gets from the system (an endpoint id,
+	 * node name or segment name) and by name. A key keeps the same id for as long as the registry
+	 * exists, also when the device gets unplugged and plugged back in. Every update publishes a new
+	 * immutable snapshot, readers on any thread take the current one and keep a consistent list of
+	 * devices for as long as they hold it, while a hot-plug thread updates. Readers only lock to copy
+	 * the pointer, they never wait for an update to build its snapshot.
+	 * @tparam Info device information, DeviceInfo of the backend
+	 */
+	template<typename Info>
+	class DeviceRegistry
+	{
+	public:
+		/**
+		 * Devices at one point in time, never changes once published.
+		 */
+		struct Snapshot
+		{
+			std::vector<Info> devices;    // Sorted by id
+			std::vector<std::string> keys; // Key of every device
+			uint64_t version = 0;          // Increments with every update that changed a device
+
+			/**
+			 * Find a device by id.
+			 * @param id device id
+			 * @return device, or nullptr if there's no device with this id
+			 */
+			const Info* Find(int id) const { auto _it = m_Ids.find(id); return _it == m_Ids.end() ? nullptr : &devices[_it->second]; }
+
+			/**
+			 * Find a device by key.
+			 * @param key key of the device
+			 * @return device, or nullptr if there's no device with this key
+			 */
+			const Info* FindKey(const std::string& key) const { auto _it = m_Keys.find(key); return _it == m_Keys.end() ? nullptr : &devices[_it->second]; }
+
+			/**
+			 * Find a device by name, names don't have to be unique.
+			 * @param name name of the device
+			 * @return device with the lowest id and this name, or nullptr if there's none
+			 */
+			const Info* FindName(const std::string& name) const { auto _it = m_Names.find(name); return _it == m_Names.end() ? nullptr : &devices[_it->second]; }
+
+		private:
+			std::unordered_map<int, std::size_t> m_Ids;          // Index of every id
+			std::unordered_map<std::string, std::size_t> m_Keys;  // Index of every key
+			std::unordered_map<std::string, std::size_t> m_Names; // Index of the first device with every name
+
+			friend class DeviceRegistry;
+		};
+
+		DeviceRegistry()
+			: m_Current(std::make_shared<const Snapshot>())
+		{}
+
+		DeviceRegistry(const DeviceRegistry&) = delete;
+		DeviceRegistry& operator=(const DeviceRegistry&) = delete;
+
+		/**
+		 * Current devices, safe to call from any thread.
+		 * @return snapshot that stays valid for as long as it's held
+		 */
+		std::shared_ptr<const Snapshot> Read() const { std::lock_guard _lock{ m_CurrentMutex }; return m_Current; }
+
+		/**
+		 * Replace all devices with a complete enumeration, devices that are missing from it are
+		 * removed. Only publishes a new snapshot when something changed.
+		 * @param devices key and information of every device, the registry assigns the ids
+		 * @return the changes
+		 */
+		std::vector<DeviceChange> Update(std::vector<std::pair<std::string, Info>> devices)
+		{
+			std::lock_guard _lock{ m_Mutex };
+			auto _current = Read();
+			auto _next = std::make_shared<Snapshot>();
+			std::vector<DeviceChange> _changes;
+			for (auto& [_key, _info] : devices)
+			{
+				// Only the first device with a key counts
+				if (_next->m_Keys.contains(_key))
+					continue;
+
+				_info.id = Id(_key);
+				if (auto _old = _current->FindKey(_key); !_old)
+					_changes.push_back({ DeviceChange::Added, _info.id, _key });
+				else if (!(*_old == _info))
+					_changes.push_back({ DeviceChange::Changed, _info.id, _key });
+
+				_next->m_Keys.emplace(_key, _next->devices.size());
+				_next->devices.push_back(std::move(_info));
+				_next->keys.push_back(std::move(_key));
+			}
+
+			for (std::size_t i = 0; i < _current->devices.size(); i++)
+				if (!_next->m_Keys.contains(_current->keys[i]))
+					_changes.push_back({ DeviceChange::Removed, _current->devices[i].id, _current->keys[i] });
+
+			if (!_changes.empty())
+				Publish(*_current, std::move(_next));
+			return _changes;
+		}
+
+		/**
+		 * Add a device, or change it if a device with this key exists.
+		 * @param key key of the device
+		 * @param info information of the device, the registry assigns the id
+		 * @return the id of the device
+		 */
+		int Set(const std::string& key, Info info)
+		{
+			std::lock_guard _lock{ m_Mutex };
+			auto _current = Read();
+			int _id = info.id = Id(key);
+			auto _old = _current->FindKey(key);
+			if (_old && *_old == info)
+				return _id;
+
+			auto _next = std::make_shared<Snapshot>();
+			_next->devices = _current->devices;
+			_next->keys = _current->keys;
+			if (_old)
+				_next->devices[_current->m_Keys.at(key)] = std::move(info);
+			else
+			{
+				_next->devices.push_back(std::move(info));
+				_next->keys.push_back(key);
+			}
+
+			Publish(*_current, std::move(_next));
+			return _id;
+		}
+
+		/**
+		 * Change a device in place.
+		 * @param key key of the device
+		 * @param change changes the information of the device, the id can't change
+		 * @return false if there's no device with this key
+		 */
+		template<typename Change>
+		bool Modify(const std::string& key, Change change)
+		{
+			std::lock_guard _lock{ m_Mutex };
+			auto _current = Read();
+			auto _it = _current->m_Keys.find(key);
+			if (_it == _current->m_Keys.end())
+				return false;
+
+			Info _info = _current->devices[_it->second];
+			change(_info);
+			_info.id = _current->devices[_it->second].id;
+			if (_info == _current->devices[_it->second])
+				return true;
+
+			auto _next = std::make_shared<Snapshot>();
+			_next->devices = _current->devices;
+			_next->keys = _current->keys;
+			_next->devices[_it->second] = std::move(_info);
+			Publish(*_current, std::move(_next));
+			return true;
+		}
+
+		/**
+		 * Remove a device, its id is kept in case the device comes back.
+		 * @param id device id
+		 * @return false if there's no device with this id
+		 */
+		bool Remove(int id)
+		{
+			std::lock_guard _lock{ m_Mutex };
+			auto _current = Read();
+			auto _it = _current->m_Ids.find(id);
+			if (_it == _current->m_Ids.end())
+				return false;
+
+			auto _next = std::make_shared<Snapshot>();
+			_next->devices = _current->devices;
+			_next->keys = _current->keys;
+			_next->devices.erase(_next->devices.begin() + _it->second);
+			_next->keys.erase(_next->keys.begin() + _it->second);
+			Publish(*_current, std::move(_next));
+			return true;
+		}
+
+	private:
+		std::shared_ptr<const Snapshot> m_Current;
+		mutable std::mutex m_CurrentMutex; // Only held to copy or swap m_Current
+		std::mutex m_Mutex;                // Serializes writers
+
+		std::unordered_map<std::string, int> m_Ids; // Id of every key that was ever seen
+		int m_NextId = 0;
+
+		/**
+		 * Id of a key, assigns the next id to a new key.
+		 * @param key key
+		 * @return id
+		 */
+		int Id(const std::string& key)
+		{
+			auto [_it, _added] = m_Ids.try_emplace(key, m_NextId);
+			if (_added)
+				m_NextId++;
+			return _it->second;
+		}
+
+		/**
+		 * Sort and index a new snapshot and make it the current one.
+		 * @param current current snapshot
+		 * @param next new snapshot, with devices and keys filled in
+		 */
+		void Publish(const Snapshot& current, std::shared_ptr<Snapshot> next)
+		{
+			std::vector<std::size_t> _order(next->devices.size());
+			std::iota(_order.begin(), _order.end(), 0);
+			std::sort(_order.begin(), _order.end(), [&](auto a, auto b) { return next->devices[a].id < next->devices[b].id; });
+
+			auto _sorted = std::make_shared<Snapshot>();
+			_sorted->version = current.version + 1;
+			_sorted->devices.reserve(_order.size());
+			_sorted->keys.reserve(_order.size());
+			for (auto i : _order)
+			{
+				auto& _info = next->devices[i];
+				_sorted->m_Ids.emplace(_info.id, _sorted->devices.size());
+				_sorted->m_Keys.emplace(next->keys[i], _sorted->devices.size());
+				_sorted->m_Names.try_emplace(_info.name, _sorted->devices.size());
+				_sorted->devices.push_back(std::move(_info));
+				_sorted->keys.push_back(std::move(next->keys[i]));
+			}
+
+			// The old snapshot is released outside of the lock, readers might still hold it anyway
+			std::shared_ptr<const Snapshot> _old = std::move(_sorted);
+			{
+				std::lock_guard _lock{ m_CurrentMutex };
+				m_Current.swap(_old);
+			}
+		}
+	};
+
+	/**
+	 * Probes the capabilities of devices on a thread pool, so enumerating only has to list them.
+	 * A device is listed with probed set to false, its channels and sample rates fill in once its
+	 * probe finishes. The pool is only started by the first probe.
+	 * @tparam Info device information, DeviceInfo of the backend
+	 */
+	template<typename Info>
+	class DeviceProber
+	{
+	public:
+		/**
+		 * Fills in the channels and sample rates of a copy of the device.
+		 * @return false if the device couldn't be probed, it gets removed
+		 */
+		using Probe = std::function<bool(Info&)>;
+
+		/**
+		 * Constructor.
+		 * @param registry registry the probed devices are updated in, has to outlive the prober
+		 * @param threads amount of devices that are probed at the same time
+		 */
+		DeviceProber(DeviceRegistry<Info>& registry, int threads = 4)
+			: m_Registry(registry), m_ThreadCount(threads)
+		{
+			m_Done.set_value();
+			m_Finished = m_Done.get_future().share();
+		}
+
+		~DeviceProber()
+		{
+			// Probes that didn't start yet are skipped
+			m_Stopping = true;
+			m_Threads.reset();
+		}
+
+		/**
+		 * Probe a device in the background.
+		 * @param key key of the device
+		 * @param probe fills in the capabilities, runs on a pool thread
+		 */
+		void Submit(const std::string& key, Probe probe)
+		{
+			{
+				std::lock_guard _lock{ m_Mutex };
+				if (!m_Threads)
+					m_Threads = std::make_unique<ThreadPool>(m_ThreadCount);
+
+				if (m_Pending++ == 0)
+				{
+					m_Done = std::promise<void>{};
+					m_Finished = m_Done.get_future().share();
+				}
+			}
+
+			m_Threads->Submit([this, key, probe = std::move(probe)]() { Run(key, probe); });
+		}
+
+		/**
+		 * Wait for the probes.
+		 * @return future that's ready once every probe that was submitted so far has finished
+		 */
+		std::shared_future<void> Finished() const
+		{
+			std::lock_guard _lock{ m_Mutex };
+			return m_Finished;
+		}
+
+	private:
+		DeviceRegistry<Info>& m_Registry;
+		std::unique_ptr<ThreadPool> m_Threads;
+		int m_ThreadCount;
+		std::atomic<bool> m_Stopping = false;
+
+		mutable std::mutex m_Mutex;
+		int m_Pending = 0;
+		std::promise<void> m_Done;
+		std::shared_future<void> m_Finished;
+
+		void Run(const std::string& key, const Probe& probe)
+		{
+			auto _devices = m_Registry.Read();
+			if (auto _device = _devices->FindKey(key); _device && !m_Stopping)
+			{
+				Info _probed = *_device;
+				if (!probe(_probed))
+					m_Registry.Remove(_device->id);
+				else
+					m_Registry.Modify(key, [&](Info& info) {
+						info.inputChannels = _probed.inputChannels;
+						info.outputChannels = _probed.outputChannels;
+						info.sampleRates = std::move(_probed.sampleRates);
+						info.probed = true;
+					});
+			}
+
+			std::lock_guard _lock{ m_Mutex };
+			if (--m_Pending == 0)
+				m_Done.set_value();
+		}
+	};
+}
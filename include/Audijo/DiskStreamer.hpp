@@ -0,0 +1,263 @@
+#pragma once
+#include "Audijo/pch.hpp"
+#include "Audijo/Buffer.hpp"
+#include "Audijo/ThreadPool.hpp"
+#include "Audijo/Log.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Statistics of a streaming track.
+	 */
+	struct TrackStatistics
+	{
+		uint64_t underruns = 0;      // Reads that could not be served completely from the prefetch ring
+		uint64_t underrunFrames = 0; // Frames that were replaced by silence because of underruns
+		uint64_t cacheHits = 0;      // Blocks that were found in the block cache
+		uint64_t cacheMisses = 0;    // Blocks that had to be read from disk
+	};
+
+	/**
+	 * Least recently used cache of file blocks, shared by all tracks of a streamer.
+	 * Only used by the I/O threads.
+	 */
+	class BlockCache
+	{
+	public:
+		using Block = std::shared_ptr<const std::vector<char>>;
+
+		/**
+		 * Constructor.
+		 * @param capacity maximum amount of blocks in the cache
+		 */
+		BlockCache(std::size_t capacity);
+
+		/**
+		 * Find a block, and mark it as most recently used.
+		 * @param file file id
+		 * @param offset byte offset of the block in the file
+		 * @return block, or nullptr if not in the cache
+		 */
+		Block Find(uint64_t file, uint64_t offset);
+
+		/**
+		 * Insert a block, evicting the least recently used block if the cache is full.
+		 * @param file file id
+		 * @param offset byte offset of the block in the file
+		 * @param block block
+		 */
+		void Insert(uint64_t file, uint64_t offset, Block block);
+
+	private:
+		struct Key
+		{
+			uint64_t file;
+			uint64_t offset;
+
+			bool operator==(const Key&) const = default;
+		};
+
+		struct KeyHash
+		{
+			std::size_t operator()(const Key& key) const { return std::hash<uint64_t>{}(key.file * 0x9E3779B97F4A7C15ull ^ key.offset); }
+		};
+
+		std::size_t m_Capacity;
+		std::list<std::pair<Key, Block>> m_Blocks; // Most recently used first
+		std::unordered_map<Key, std::list<std::pair<Key, Block>>::iterator, KeyHash> m_Index;
+		std::mutex m_Mutex;
+	};
+
+	/**
+	 * A single audio file streamed from disk. The I/O threads of the streamer decode the file ahead
+	 * of the read position into a lock-free prefetch ring, the audio thread reads from this ring.
+	 */
+	class StreamingTrack
+	{
+	public:
+		~StreamingTrack();
+
+		/**
+		 * Amount of channels in the file.
+		 * @return channel count
+		 */
+		int Channels() const { return m_Channels; }
+
+		/**
+		 * Length of the file.
+		 * @return frame count
+		 */
+		uint64_t Frames() const { return m_Frames; }
+
+		/**
+		 * Sample rate of the file.
+		 * @return sample rate
+		 */
+		double SampleRate() const { return m_SampleRate; }
+
+		/**
+		 * Current read position.
+		 * @return frame position
+		 */
+		uint64_t Position() const { return m_ReadPosition.load(std::memory_order_relaxed); }
+
+		/**
+		 * Read the next frames into the buffer, realtime safe. The channels of the file are written
+		 * to the channels of the buffer starting at the given channel. Frames that haven't been
+		 * prefetched yet are silent and counted as underrun, as are frames past the end of the file.
+		 * @param buffer buffer to write to
+		 * @param channel first channel of the buffer to write to
+		 * @return amount of frames read from the file
+		 */
+		template<typename T>
+		int Read(Buffer<T>& buffer, int channel = 0);
+
+		/**
+		 * Seek to a frame. Takes effect at the next Read, when the frame was already prefetched
+		 * the read position just moves, otherwise the prefetch restarts at the frame and only
+		 * the blocks that aren't in the cache are read from disk.
+		 * @param frame frame position
+		 */
+		void Seek(uint64_t frame);
+
+		/**
+		 * Get the statistics of this track.
+		 * @return statistics
+		 */
+		TrackStatistics Statistics() const;
+
+	private:
+		constexpr static int BlockFrames = 16384;          // Frames in a single cached block
+		constexpr static uint64_t RestartFlag = 1ull << 63; // Marks a pending restart of the prefetch
+
+		StreamingTrack(uint64_t file, int prefetchFrames);
+
+		bool Open(const std::string& path);
+		bool NeedsFill() const;
+		void Fill(BlockCache& cache);
+		void HandleSeek();
+
+		// File information
+		std::FILE* m_File = nullptr;
+		uint64_t m_FileId;
+		uint64_t m_DataOffset = 0;
+		uint64_t m_Frames = 0;
+		double m_SampleRate = 0;
+		int m_Channels = 0;
+		int m_Bits = 0;
+		bool m_Floating = false;
+		int m_FrameBytes = 0;
+
+		// Prefetch ring, holds the interleaved frames [read position, write position)
+		std::vector<float> m_Ring;
+		uint64_t m_Capacity;
+		alignas(64) std::atomic<uint64_t> m_ReadPosition = 0;  // Owned by the audio thread
+		alignas(64) std::atomic<uint64_t> m_WritePosition = 0; // Owned by the I/O thread
+		std::atomic<uint64_t> m_Restart = 0;                   // Position the prefetch has to restart at
+
+		// Seek requests from the control thread
+		std::atomic<uint64_t> m_SeekTarget = 0;
+		std::atomic<uint32_t> m_SeekRequest = 0;
+		uint32_t m_SeekHandled = 0;
+
+		std::atomic<bool> m_Scheduled = false; // A fill is queued or running on the I/O threads
+
+		std::atomic<uint64_t> m_Underruns = 0;
+		std::atomic<uint64_t> m_UnderrunFrames = 0;
+		std::atomic<uint64_t> m_CacheHits = 0;
+		std::atomic<uint64_t> m_CacheMisses = 0;
+
+		friend class DiskStreamer;
+	};
+
+	/**
+	 * Streams many long files from disk at once, to be read from the callback. A pool of I/O threads
+	 * keeps the prefetch rings of all tracks filled, reading blocks through a shared block cache.
+	 */
+	class DiskStreamer
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param ioThreads amount of I/O threads
+		 * @param cacheBlocks amount of blocks the block cache holds
+		 * @param prefetchFrames amount of frames prefetched per track
+		 */
+		DiskStreamer(int ioThreads = 4, std::size_t cacheBlocks = 512, int prefetchFrames = 1 << 16);
+		~DiskStreamer();
+
+		/**
+		 * Add a track, starts prefetching from the start of the file right away.
+		 * Supports 16, 24 and 32 bit PCM and 32 and 64 bit float WAV and RF64 files.
+		 * @param path file path
+		 * @return track, or nullptr if the file couldn't be opened
+		 */
+		StreamingTrack* Add(const std::string& path);
+
+		/**
+		 * Remove a track, the callback must not read from the track anymore.
+		 * @param track track
+		 */
+		void Remove(StreamingTrack* track);
+
+		/**
+		 * Amount of tracks.
+		 * @return track count
+		 */
+		std::size_t Tracks() const;
+
+	private:
+		int m_PrefetchFrames;
+		std::vector<std::unique_ptr<StreamingTrack>> m_Tracks;
+		std::unordered_map<std::string, uint64_t> m_Files; // Path to file id, so tracks of the same file share cached blocks
+		mutable std::mutex m_Mutex;
+		BlockCache m_Cache;
+		ThreadPool m_Pool;
+
+		std::thread m_Dispatcher;
+		std::atomic<bool> m_Running = true;
+
+		void Dispatch();
+	};
+
+	template<typename T>
+	int StreamingTrack::Read(Buffer<T>& buffer, int channel)
+	{
+		HandleSeek();
+
+		int _frames = buffer.Frames();
+		int _channels = std::clamp(buffer.Channels() - channel, 0, m_Channels);
+		uint64_t _position = m_ReadPosition.load(std::memory_order_relaxed);
+
+		// Nothing is available while the prefetch restarts
+		int _available = m_Restart.load(std::memory_order_acquire) ? 0
+			: m_WritePosition.load(std::memory_order_acquire) - _position;
+		int _read = std::min(_frames, _available);
+
+		T** _data = buffer.data();
+		for (int i = 0; i < _read; i++)
+		{
+			const float* _frame = &m_Ring[((_position + i) % m_Capacity) * m_Channels];
+			for (int j = 0; j < _channels; j++)
+				if constexpr (std::is_floating_point_v<T>)
+					_data[channel + j][i] = (T)_frame[j];
+				else
+					_data[channel + j][i] = (T)(std::clamp(_frame[j], -1.f, 1.f) * std::numeric_limits<T>::max());
+		}
+
+		// Silence for the rest, only an underrun if we're not at the end of the file
+		for (int i = _read; i < _frames; i++)
+			for (int j = 0; j < _channels; j++)
+				_data[channel + j][i] = 0;
+
+		int _missing = std::min<uint64_t>(_frames - _read, m_Frames - std::min(m_Frames, _position + _read));
+		if (_missing > 0)
+		{
+			m_Underruns.fetch_add(1, std::memory_order_relaxed);
+			m_UnderrunFrames.fetch_add(_missing, std::memory_order_relaxed);
+		}
+
+		m_ReadPosition.store(_position + _read, std::memory_order_release);
+		return _read;
+	}
+}
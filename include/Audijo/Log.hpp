@@ -0,0 +1,131 @@
+#pragma once
+#include "Audijo/pch.hpp"
+#include "Audijo/MessageQueue.hpp"
+
+namespace Audijo
+{
+	enum LogLevel
+	{
+		LogDebug, LogInfo, LogWarning, LogError, LogNone
+	};
+
+// Records below this level compile away, LogNone removes all logging
+#ifndef AUDIJO_LOG_LEVEL
+#define AUDIJO_LOG_LEVEL ::Audijo::LogInfo
+#endif
+
+	/**
+	 * Argument of a log record, strings have to be static.
+	 */
+	struct LogArgument
+	{
+		enum Type { Integer, Unsigned, Floating, String } type;
+		union
+		{
+			int64_t integer;
+			uint64_t natural;
+			double floating;
+			const char* string;
+		};
+
+		LogArgument() : type(Integer), integer(0) {}
+
+		template<std::signed_integral T>
+		LogArgument(T value) : type(Integer), integer(value) {}
+
+		template<std::unsigned_integral T>
+		LogArgument(T value) : type(Unsigned), natural(value) {}
+
+		template<std::floating_point T>
+		LogArgument(T value) : type(Floating), floating(value) {}
+
+		LogArgument(const char* value) : type(String), string(value) {}
+	};
+
+	/**
+	 * Fixed size log record, a format and its arguments, formatted later on the logging thread.
+	 */
+	struct LogRecord
+	{
+		constexpr static int MaxArguments = 4;
+
+		LogLevel level;
+		const char* format; // Static string, "{}" is replaced by the next argument, "{x}" by it in hexadecimal
+		int count;
+		LogArgument arguments[MaxArguments];
+	};
+
+	/**
+	 * Logging for every thread. Realtime threads push fixed size records into a lock-free queue, a
+	 * background thread formats them and hands them to the sink. Other threads write to the sink directly.
+	 */
+	class Logger
+	{
+	public:
+		constexpr static std::size_t Capacity = 1024; // Records waiting to be formatted, more are dropped
+
+		/**
+		 * Start the logging thread, if it isn't running yet. Called when a stream is created.
+		 */
+		static void Start();
+
+		/**
+		 * Set where formatted messages go, by default to std::cout.
+		 * @param sink called with the level and the message, from the logging thread or the thread that logged
+		 */
+		static void Sink(std::function<void(LogLevel, const std::string&)> sink);
+
+		/**
+		 * Log a record, realtime safe. If the queue is full the record is dropped and counted.
+		 * @param level level
+		 * @param format static format, see LogRecord
+		 * @param args arguments, integers, floating points or static strings
+		 */
+		template<typename ...Args>
+		static void Log(LogLevel level, const char* format, Args... args)
+		{
+			static_assert(sizeof...(Args) <= LogRecord::MaxArguments, "Too many log arguments");
+			LogRecord _record{ level, format, sizeof...(Args), { LogArgument{ args }... } };
+			Push(_record);
+		}
+
+		/**
+		 * Write a message to the sink right away, not realtime safe.
+		 * @param level level
+		 * @param message message
+		 */
+		static void Write(LogLevel level, const std::string& message);
+
+		/**
+		 * Format and write every record that's waiting, not realtime safe.
+		 */
+		static void Flush();
+
+		/**
+		 * Format a record.
+		 * @param record record
+		 * @return message
+		 */
+		static std::string Format(const LogRecord& record);
+
+	private:
+		static void Push(const LogRecord& record);
+	};
+}
+
+/**
+ * Realtime safe logging, see Logger::Log. Compiles away below AUDIJO_LOG_LEVEL.
+ */
+#define RTLOG(level, format, ...) do { if constexpr ((level) >= (AUDIJO_LOG_LEVEL)) \
+	::Audijo::Logger::Log(level, format __VA_OPT__(,) __VA_ARGS__); } while (0)
+
+/**
+ * Logging for control threads, formats with operator<<. Not realtime safe. LOGL is an error,
+ * LOGW a warning and LOGI information.
+ */
+#define LOGAT(level, x) do { if constexpr ((level) >= (AUDIJO_LOG_LEVEL)) { \
+	std::ostringstream _log; _log << x; ::Audijo::Logger::Write(level, _log.str()); } } while (0)
+#define LOGL(x) LOGAT(::Audijo::LogError, x)
+#define LOGW(x) LOGAT(::Audijo::LogWarning, x)
+#define LOGI(x) LOGAT(::Audijo::LogInfo, x)
+#define LOG(x) LOGL(x)
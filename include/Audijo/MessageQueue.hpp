@@ -0,0 +1,217 @@
+#pragma once
+#include "Audijo/pch.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Bounded lock-free queue for any amount of producers and consumers. Neither side ever blocks
+	 * or allocates, a push fails when the queue is full, so it's safe to use on the audio thread.
+	 * @tparam T message type
+	 */
+	template<typename T>
+	class MessageQueue
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param capacity maximum amount of messages, rounded up to a power of 2
+		 */
+		MessageQueue(std::size_t capacity)
+		{
+			std::size_t _size = 2;
+			while (_size < capacity)
+				_size <<= 1;
+
+			m_Mask = _size - 1;
+			m_Cells = std::make_unique<Cell[]>(_size);
+			for (std::size_t i = 0; i < _size; i++)
+				m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		~MessageQueue()
+		{
+			while (Consume([](T&) {}));
+		}
+
+		MessageQueue(const MessageQueue&) = delete;
+		MessageQueue& operator=(const MessageQueue&) = delete;
+
+		/**
+		 * Add a message.
+		 * @param message message
+		 * @return false if the queue is full
+		 */
+		template<typename Type>
+		bool Push(Type&& message)
+		{
+			std::size_t _position = m_Enqueue.load(std::memory_order_relaxed);
+			Cell* _cell;
+			while (true)
+			{
+				_cell = &m_Cells[_position & m_Mask];
+				std::size_t _sequence = _cell->sequence.load(std::memory_order_acquire);
+				std::intptr_t _difference = (std::intptr_t)_sequence - (std::intptr_t)_position;
+
+				// Cell is free, try to claim it
+				if (_difference == 0)
+				{
+					if (m_Enqueue.compare_exchange_weak(_position, _position + 1, std::memory_order_relaxed))
+						break;
+				}
+
+				// Cell still holds a message from a lap ago
+				else if (_difference < 0)
+					return false;
+
+				// Another producer claimed it
+				else
+					_position = m_Enqueue.load(std::memory_order_relaxed);
+			}
+
+			new (_cell->storage) T(std::forward<Type>(message));
+			_cell->sequence.store(_position + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Take the oldest message.
+		 * @param message receives the message
+		 * @return false if the queue is empty
+		 */
+		bool Pop(T& message)
+		{
+			return Consume([&](T& m) { message = std::move(m); });
+		}
+
+		/**
+		 * Take the oldest message and hand it to a function, without moving it out of the queue.
+		 * @param fn function taking <code>T&</code>
+		 * @return false if the queue is empty
+		 */
+		template<typename Fn>
+		bool Consume(Fn&& fn)
+		{
+			std::size_t _position = m_Dequeue.load(std::memory_order_relaxed);
+			Cell* _cell;
+			while (true)
+			{
+				_cell = &m_Cells[_position & m_Mask];
+				std::size_t _sequence = _cell->sequence.load(std::memory_order_acquire);
+				std::intptr_t _difference = (std::intptr_t)_sequence - (std::intptr_t)(_position + 1);
+
+				// Cell has a message, try to claim it
+				if (_difference == 0)
+				{
+					if (m_Dequeue.compare_exchange_weak(_position, _position + 1, std::memory_order_relaxed))
+						break;
+				}
+
+				// Cell wasn't written yet
+				else if (_difference < 0)
+					return false;
+
+				// Another consumer claimed it
+				else
+					_position = m_Dequeue.load(std::memory_order_relaxed);
+			}
+
+			T* _message = std::launder(reinterpret_cast<T*>(_cell->storage));
+			fn(*_message);
+			_message->~T();
+
+			// Free the cell for the producers of the next lap
+			_cell->sequence.store(_position + m_Mask + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Maximum amount of messages.
+		 * @return capacity
+		 */
+		std::size_t Capacity() const { return m_Mask + 1; }
+
+	private:
+		struct Cell
+		{
+			std::atomic<std::size_t> sequence;
+			alignas(T) unsigned char storage[sizeof(T)];
+		};
+
+		std::unique_ptr<Cell[]> m_Cells;
+		std::size_t m_Mask;
+		alignas(64) std::atomic<std::size_t> m_Enqueue = 0;
+		alignas(64) std::atomic<std::size_t> m_Dequeue = 0;
+	};
+
+	/**
+	 * Type erased command queue, so the stream can drain all of them.
+	 */
+	struct CommandQueueBase
+	{
+		virtual ~CommandQueueBase() = default;
+		virtual void Drain() = 0;
+	};
+
+	/**
+	 * Typed messages from control threads to the audio thread. The handler gets every message on the
+	 * audio thread at the start of each period. Handled messages go back through a return queue and are
+	 * destroyed by the next Send or Collect, so anything they own is never freed on the audio thread.
+	 * @tparam T message type
+	 */
+	template<typename T>
+	class CommandQueue : public CommandQueueBase
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param capacity maximum amount of messages waiting for the audio thread
+		 * @param handler handler, called with <code>T&</code> on the audio thread
+		 */
+		template<typename Handler>
+		CommandQueue(std::size_t capacity, Handler&& handler)
+			: m_Commands(capacity), m_Returns(2 * capacity), m_Handler(std::forward<Handler>(handler))
+		{}
+
+		/**
+		 * Send a message to the audio thread, collects the returned messages first.
+		 * Lock-free, can be called from any amount of threads.
+		 * @param message message
+		 * @return false if the queue is full
+		 */
+		template<typename Type>
+		bool Send(Type&& message)
+		{
+			Collect();
+			return m_Commands.Push(std::forward<Type>(message));
+		}
+
+		/**
+		 * Destroy the messages the audio thread has handled.
+		 */
+		void Collect()
+		{
+			while (m_Returns.Consume([](T&) {}));
+		}
+
+		/**
+		 * Handle the waiting messages, called by the stream on the audio thread. At most a queue 
+		 * full per period, so producers that keep sending can't stall the audio thread.
+		 */
+		void Drain() override
+		{
+			for (std::size_t i = 0; i < m_Commands.Capacity() && m_Commands.Consume([this](T& message) {
+				m_Handler(message);
+
+				// Hand it back to be destroyed off the audio thread, if nobody
+				// collected for a while there's no choice but to destroy it here.
+				if constexpr (!std::is_trivially_destructible_v<T>)
+					m_Returns.Push(std::move(message));
+				}); i++);
+		}
+
+	private:
+		MessageQueue<T> m_Commands;
+		MessageQueue<T> m_Returns;
+		std::function<void(T&)> m_Handler;
+	};
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "Audijo/pch.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Things that happen to a stream outside of the callback.
+	 */
+	enum NotificationType
+	{
+		DeviceLost,        // The device was removed or invalidated, the audio stopped
+		StreamFailed,      // The backend hit an error it can't continue from, value is its error code
+		ResetRequested,    // The driver asks for the stream to be reopened
+		SampleRateChanged, // The device switched sample rate, value is the new sample rate
+		BufferSizeChanged, // The driver asks for another buffer size, value is the new buffer size
+		FormatChanged,     // The device renegotiated its sample format
+		LatencyChanged,    // The latencies of the device changed
+		Restarted,         // The restart policy reopened the stream, value is the amount of attempts it took
+		RestartFailed,     // The restart policy gave up, value is the Error of the last attempt
+		Overloaded,        // The watchdog acted on a callback that kept going over its budget, value is the buffer size it asks for
+	};
+
+	/**
+	 * A single notification.
+	 */
+	struct Notification
+	{
+		NotificationType type;
+		double value = 0;      // Depends on the type
+		uint64_t position = 0; // Frame position of the stream when it was posted
+		double time = 0;       // Host time when it was posted, see HostTime
+	};
+
+	/**
+	 * When a stream gets reopened without the application asking for it.
+	 */
+	enum RestartPolicy
+	{
+		NoRestart,      // Only notify, the listener decides
+		RestartOnReset, // Reopen when the driver resets or changes the sample rate, buffer size or format
+		RestartAlways,  // Also reopen when the device is lost or the stream failed
+	};
+
+	struct RestartParameters
+	{
+		RestartPolicy policy = RestartOnReset;
+		int attempts = 5;    // Attempts before giving up
+		double delay = 0.5;  // Seconds between two attempts
+	};
+}
@@ -0,0 +1,138 @@
+#ifdef AUDIJO_NULL
+#pragma once
+#include "Audijo/pch.hpp"
+#include "Audijo/ApiBase.hpp"
+
+namespace Audijo
+{
+	template<>
+	struct DeviceInfo<Null> : public DeviceInfo<>
+	{
+	private:
+		DeviceInfo(DeviceInfo<>&& d)
+			: DeviceInfo<>{ std::forward<DeviceInfo<>>(d) }
+		{}
+
+		friend class NullApi;
+	};
+
+	/**
+	 * Device-less backend, runs the callback in real-time on its own thread with silent input
+	 * and discarded output. Supports any buffer size and sample rate, for testing and offline use. Both
+	 * can change while running, up to the maximum buffer size, from the next period on.
+	 * Device 0 is a duplex device, devices 1 and 2 are an input and an output device that each
+	 * run on their own clock, so a duplex stream across them goes through the resampling bridge.
+	 * Devices can be plugged and unplugged from any thread, to try out hot-plug handling.
+	 */
+	class NullApi : public ApiBase
+	{
+	public:
+		constexpr static int Channels = 32;
+		enum DeviceId { DuplexDevice, InputDevice, OutputDevice, DeviceAmount };
+
+		using DeviceSnapshot = std::shared_ptr<const DeviceRegistry<DeviceInfo<Null>>::Snapshot>;
+
+		NullApi(bool loadDevices = true);
+		~NullApi();
+
+		const std::vector<DeviceInfo<Null>>& Devices(bool reload = false);
+		const DeviceInfo<>& Device(int id) const override { return ApiDevice(id); };
+		int DeviceCount() const override { return m_Devices->devices.size(); };
+		const DeviceInfo<Null>& ApiDevice(int id) const { auto _device = m_Devices->Find(id); return _device ? *_device : m_NoDevice; };
+		DeviceSnapshot Snapshot() const { return m_Registry.Read(); }
+
+		Error Open(const StreamParameters& settings = StreamParameters{}) override;
+		Error Start() override;
+		Error Stop() override;
+		Error Close() override;
+
+		Error SampleRate(double) override;
+		Error BufferSize(std::size_t) override;
+
+		/**
+		 * Let the clock of a built-in device run fast or slow, applies from the next start.
+		 * @param id device id
+		 * @param ppm deviation from the sample rate in parts per million
+		 * @return NotPresent if the device doesn't exist
+		 */
+		Error ClockSkew(int id, double ppm);
+
+		/**
+		 * Act as if the driver posted a notification, to try out recovery. The audio thread posts it
+		 * at its next period, after DeviceLost or StreamFailed it stops processing like a failing 
+		 * device would.
+		 * @param type type
+		 * @param value value of the notification
+		 * @return NotRunning if the stream isn't running
+		 */
+		Error Simulate(NotificationType type, double value = 0);
+
+		/**
+		 * Plug in a device, or change the channels of a plugged in device with the same name. A
+		 * device that gets plugged in again gets back its old id. With a probe delay the device is
+		 * listed right away, its channels fill in once the probe finishes.
+		 * @param name device name
+		 * @param inputs amount of input channels
+		 * @param outputs amount of output channels
+		 * @return device id, NoDevice if the name is taken by one of the built-in devices
+		 */
+		int Plug(const std::string& name, int inputs, int outputs);
+
+		/**
+		 * Let probing the capabilities of plugged in devices take time, like a driver would.
+		 * @param seconds time a single probe takes
+		 */
+		void ProbeDelay(double seconds) { m_ProbeDelay = seconds; }
+
+		/**
+		 * Wait for the devices that are still being probed.
+		 * @return future that's ready once all devices plugged in so far are probed
+		 */
+		std::shared_future<void> Probed() const { return m_Prober.Finished(); }
+
+		/**
+		 * Unplug a device. A running stream that uses it stops processing and notifies DeviceLost.
+		 * @param id device id
+		 * @return NotPresent if the device doesn't exist
+		 */
+		Error Unplug(int id);
+
+	private:
+		DeviceRegistry<DeviceInfo<Null>> m_Registry;
+		DeviceSnapshot m_Devices = m_Registry.Read(); // Devices as of the last reload
+		DeviceInfo<Null> m_NoDevice{ { NoDevice, "", 0, 0, {}, false, Null } };
+		DeviceProber<DeviceInfo<Null>> m_Prober{ m_Registry };
+		std::atomic<double> m_ProbeDelay = 0;
+
+		std::vector<char> m_DeviceMemory;
+		std::vector<char*> m_DeviceInputs;
+		std::vector<char*> m_DeviceOutputs;
+
+		std::atomic<double> m_Skew[DeviceAmount]{}; // Clock deviation of every device in parts per million, read every period
+
+		std::atomic<int> m_Simulated = -1; // Notification the audio thread posts at its next period, -1 for none
+		std::atomic<double> m_SimulatedValue = 0;
+
+		std::thread m_AudioThread;
+		Signal m_Wake;
+
+		std::thread m_CaptureThread; // Runs the input device, only when it's on a different clock than the output
+		Signal m_CaptureWake;
+		std::vector<float> m_CaptureMemory;
+		std::vector<const float*> m_CaptureInputs;
+
+		void AllocateDeviceBuffers();
+		void Run();
+		void Capture();
+
+		/**
+		 * Duration of a period on the clock of a device.
+		 * @param id device id
+		 * @param frames frames in the period
+		 * @param sampleRate sample rate
+		 * @return period duration
+		 */
+		std::chrono::steady_clock::duration Period(int id, int frames, double sampleRate) const;
+	};
+}
+#endif
@@ -0,0 +1,131 @@
+#ifdef AUDIJO_PIPEWIRE
+#pragma once
+#include "Audijo/pch.hpp"
+#include "Audijo/ApiBase.hpp"
+
+namespace Audijo
+{
+	template<>
+	struct DeviceInfo<PipeWire> : public DeviceInfo<>
+	{
+		/**
+		 * Name of the PipeWire node, used as the target when connecting a stream
+		 */
+		std::string nodeName;
+
+		/**
+		 * Global id of the PipeWire node
+		 */
+		uint32_t node = 0;
+
+		bool operator==(const DeviceInfo&) const = default;
+
+	private:
+		DeviceInfo(DeviceInfo<>&& d)
+			: DeviceInfo<>{ std::forward<DeviceInfo<>>(d) }
+		{}
+
+		friend class PipeWireApi;
+	};
+
+	class PipeWireApi : public ApiBase
+	{
+	public:
+		using DeviceSnapshot = std::shared_ptr<const DeviceRegistry<DeviceInfo<PipeWire>>::Snapshot>;
+
+		PipeWireApi(bool loadDevices = true);
+		~PipeWireApi();
+
+		const std::vector<DeviceInfo<PipeWire>>& Devices(bool reload = false);
+		const DeviceInfo<>& Device(int id) const override { return ApiDevice(id); };
+		int DeviceCount() const override { return m_Devices->devices.size(); };
+		StreamInformation Information() const override;
+		const DeviceInfo<PipeWire>& ApiDevice(int id) const { auto _device = m_Devices->Find(id); return _device ? *_device : m_NoDevice; };
+		DeviceSnapshot Snapshot() const { return m_Registry.Read(); }
+
+		Error Open(const StreamParameters& settings = StreamParameters{}) override;
+		Error Start() override;
+		Error Stop() override;
+		Error Close() override;
+
+		Error SampleRate(double) override;
+		Error BufferSize(std::size_t) override;
+
+	protected:
+		// Largest quantum the graph can run at, the callback buffers are allocated for
+		// this size so quantum changes never have to reallocate on the realtime thread.
+		constexpr static int MaxQuantum = 8192;
+
+		DeviceRegistry<DeviceInfo<PipeWire>> m_Registry; // Nodes by node name
+		DeviceSnapshot m_Devices = m_Registry.Read();   // Devices as of the last reload
+		DeviceInfo<PipeWire> m_NoDevice{ { NoDevice, "", 0, 0, {}, false, PipeWire } };
+
+		pw_thread_loop* m_Loop = nullptr;  // Loop running the PipeWire main loop on its own thread
+		pw_context* m_Context = nullptr;
+		pw_core* m_Core = nullptr;         // Connection to the PipeWire daemon
+		pw_stream* m_CaptureStream = nullptr;
+		pw_stream* m_PlaybackStream = nullptr;
+		spa_hook m_CaptureListener{};
+		spa_hook m_PlaybackListener{};
+
+		std::vector<char*> m_DeviceInputs;  // Planar input buffers of the current period
+		std::vector<char*> m_DeviceOutputs; // Planar output buffers of the current period
+
+		// In a duplex stream the capture stream stores its period here,
+		// the playback stream then processes it together with the output.
+		std::vector<std::vector<char>> m_CaptureBuffers;
+		std::atomic<int> m_CapturedFrames = 0;
+
+		std::atomic<spa_io_position*> m_PlaybackPosition = nullptr; // Position of the graph the playback stream runs in, if known
+		std::atomic<int> m_Quantum = 0; // Quantum the graph last ran at, written by the data thread
+
+		// Formats the streams negotiated, written by the loop thread. The stream information keeps the
+		// format that was offered, the data thread skips its cycles while the two don't agree.
+		std::atomic<SampleFormat> m_DeviceInFormat = None;
+		std::atomic<SampleFormat> m_DeviceOutFormat = None;
+
+		/**
+		 * Size of the current cycle of the playback stream, realtime safe.
+		 * @param buffer dequeued buffer
+		 * @param capacity frames that fit in the buffer
+		 * @return amount of frames
+		 */
+		int PlaybackFrames(pw_buffer* buffer, int capacity) const;
+
+		/**
+		 * Follow the quantum of the graph, on the data thread. The stream information belongs to
+		 * the control threads, a change is posted so the notification thread publishes it.
+		 * @param frames size of the current cycle
+		 */
+		void QuantumChanged(int frames);
+
+		const DeviceInfo<PipeWire>* DeviceById(int id) const;
+		pw_stream* CreateStream(bool input, const DeviceInfo<PipeWire>& device);
+		void FormatChanged(bool input, const spa_pod* param);
+
+		/**
+		 * Whether the streams run at the formats that were offered, realtime safe.
+		 * @return true when the callback can run on the stream buffers
+		 */
+		bool Negotiated() const;
+
+		/**
+		 * Host time at which the graph started the current cycle, the monotonic clock
+		 * PipeWire stamps cycles with is the clock steady_clock uses.
+		 * @param stream stream that is being processed
+		 * @return time in seconds, negative if unknown
+		 */
+		static double CycleTime(pw_stream* stream);
+
+		static void StreamStateChanged(void* data, pw_stream_state old, pw_stream_state state, const char* error);
+		static void CaptureParamChanged(void* data, uint32_t id, const spa_pod* param);
+		static void PlaybackParamChanged(void* data, uint32_t id, const spa_pod* param);
+		static void PlaybackIoChanged(void* data, uint32_t id, void* area, uint32_t size);
+		static void CaptureProcess(void* data);
+		static void PlaybackProcess(void* data);
+
+		static const pw_stream_events m_CaptureEvents;
+		static const pw_stream_events m_PlaybackEvents;
+	};
+}
+#endif
@@ -0,0 +1,457 @@
+#pragma once
+#include "Audijo/pch.hpp"
+#include "Audijo/ApiBase.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Lock-free ring of non-interleaved frames, between a single producer and a single consumer thread.
+	 * @tparam T sample type
+	 */
+	template<typename T>
+	class FrameRing
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param channels amount of channels
+		 * @param capacity amount of frames the ring holds
+		 */
+		FrameRing(int channels, std::size_t capacity)
+			: m_Channels(channels), m_Capacity(capacity), m_Samples(channels * capacity)
+		{}
+
+		int Channels() const { return m_Channels; }
+		std::size_t Capacity() const { return m_Capacity; }
+
+		/**
+		 * Frames the consumer can read.
+		 * @return amount of frames
+		 */
+		std::size_t Readable() const { return m_Written.load(std::memory_order_acquire) - m_Read.load(std::memory_order_relaxed); }
+
+		/**
+		 * Frames the producer can write.
+		 * @return amount of frames
+		 */
+		std::size_t Writable() const { return m_Capacity - (m_Written.load(std::memory_order_relaxed) - m_Read.load(std::memory_order_acquire)); }
+
+		/**
+		 * Write frames, producer only.
+		 * @param channels channels to write, channels of the ring beyond these are written as silence
+		 * @param count amount of channels
+		 * @param frames amount of frames
+		 * @return amount of frames written, less than asked when the ring is full
+		 */
+		std::size_t Write(T* const* channels, int count, std::size_t frames)
+		{
+			frames = std::min(frames, Writable());
+			uint64_t _position = m_Written.load(std::memory_order_relaxed);
+			for (int i = 0; i < m_Channels; i++)
+				Segments(_position, frames, [&](std::size_t index, std::size_t offset, std::size_t size) {
+					T* _ring = m_Samples.data() + i * m_Capacity + index;
+					if (i < count)
+						std::copy_n(channels[i] + offset, size, _ring);
+					else
+						std::fill_n(_ring, size, T{});
+				});
+
+			m_Written.store(_position + frames, std::memory_order_release);
+			return frames;
+		}
+
+		/**
+		 * Read frames, consumer only.
+		 * @param channels channels to read into, channels beyond those of the ring are filled with silence
+		 * @param count amount of channels
+		 * @param frames amount of frames
+		 * @return amount of frames read, less than asked when the ring doesn't have them
+		 */
+		std::size_t Read(T** channels, int count, std::size_t frames)
+		{
+			frames = std::min(frames, Readable());
+			uint64_t _position = m_Read.load(std::memory_order_relaxed);
+			for (int i = 0; i < count; i++)
+				Segments(_position, frames, [&](std::size_t index, std::size_t offset, std::size_t size) {
+					if (i < m_Channels)
+						std::copy_n(m_Samples.data() + i * m_Capacity + index, size, channels[i] + offset);
+					else
+						std::fill_n(channels[i] + offset, size, T{});
+				});
+
+			m_Read.store(_position + frames, std::memory_order_release);
+			return frames;
+		}
+
+	private:
+		int m_Channels;
+		std::size_t m_Capacity;
+		std::vector<T> m_Samples; // Channels one after the other
+		alignas(64) std::atomic<uint64_t> m_Written = 0;
+		alignas(64) std::atomic<uint64_t> m_Read = 0;
+
+		/**
+		 * Split a range of frames where it wraps around the end of the ring.
+		 * @param position position of the first frame
+		 * @param frames amount of frames
+		 * @param copy called with the index in the ring, the offset in the range and the size of every part
+		 */
+		template<typename Copy>
+		void Segments(uint64_t position, std::size_t frames, Copy copy)
+		{
+			std::size_t _index = position % m_Capacity;
+			std::size_t _first = std::min(frames, m_Capacity - _index);
+			if (_first > 0)
+				copy(_index, 0, _first);
+			if (_first < frames)
+				copy(0, _first, frames - _first);
+		}
+	};
+
+	/**
+	 * Waiting and waking of a pull stream, independent of the sample type. The audio thread only makes
+	 * a system call to wake a waiting consumer, a consumer that's waiting sleeps on a futex (WaitOnAddress
+	 * on Windows) until the next period.
+	 */
+	class PullStreamBase
+	{
+	public:
+		enum Direction { Input, Output, Directions };
+
+		virtual ~PullStreamBase() = default;
+
+		/**
+		 * Allocate the rings for a newly opened stream, called by the stream on a control thread.
+		 * @param inputs amount of input channels
+		 * @param outputs amount of output channels
+		 * @param frames maximum amount of frames in a period
+		 */
+		virtual void Allocate(int inputs, int outputs, int frames) = 0;
+
+		/**
+		 * Release the rings of a closed stream, wakes everything waiting on them.
+		 */
+		virtual void Close() = 0;
+
+		/**
+		 * Follow the state of the stream, waits can only last while it runs. Wakes everything
+		 * waiting when it stops.
+		 * @param running stream is starting or running
+		 */
+		void Running(bool running);
+
+	protected:
+		std::atomic<bool> m_Running = false;
+
+		/**
+		 * Wait until a condition holds, or until the stream changes state. The condition is checked
+		 * after every period.
+		 * @param condition condition
+		 */
+		template<typename Condition>
+		void Wait(Condition condition)
+		{
+			while (true)
+			{
+				uint32_t _sequence = m_Sequence.load(std::memory_order_acquire);
+				m_Waiting.store(true, std::memory_order_relaxed);
+
+				// Pairs with the fence in Wake, either we see the period or the audio thread sees us waiting
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (condition())
+					return;
+
+				m_Sequence.wait(_sequence, std::memory_order_acquire);
+			}
+		}
+
+		/**
+		 * Wake whoever is waiting, realtime safe. Called by the audio thread after every period,
+		 * only makes a system call when someone waits.
+		 */
+		void Wake()
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_Waiting.load(std::memory_order_relaxed) && m_Waiting.exchange(false, std::memory_order_relaxed))
+				Interrupt();
+		}
+
+		/**
+		 * Wake everything that waits, regardless of whether it has to.
+		 */
+		void Interrupt();
+
+		/**
+		 * Suspend a coroutine until a read or write of an amount of frames can complete. It gets
+		 * resumed on the waker thread of the stream, started by the first suspended coroutine.
+		 * @param direction Input for a read, Output for a write
+		 * @param frames amount of frames
+		 * @param handle coroutine
+		 */
+		void Suspend(Direction direction, std::size_t frames, std::coroutine_handle<> handle);
+
+		/**
+		 * Check whether a read or write can complete without waiting, because there are enough
+		 * frames or because it can't ever complete.
+		 * @param direction Input for a read, Output for a write
+		 * @param frames amount of frames
+		 * @return true if it wouldn't wait
+		 */
+		virtual bool Ready(Direction direction, std::size_t frames) const = 0;
+
+		/**
+		 * Stop the waker thread, coroutines that are still suspended are never resumed. The
+		 * derived class calls this first thing in its destructor, the waker calls Ready.
+		 */
+		void StopWaker();
+
+	private:
+		std::atomic<uint32_t> m_Sequence = 0; // Incremented to wake, waits are on its address
+		std::atomic<bool> m_Waiting = false;  // Someone waits, or is about to
+
+		std::atomic<void*> m_Suspended[Directions]{};          // Address of the suspended coroutine of each direction
+		std::atomic<std::size_t> m_SuspendedFrames[Directions]{}; // Frames it waits for
+
+		std::thread m_Waker;
+		std::mutex m_WakerMutex;
+		std::atomic<bool> m_WakerRunning = false;
+
+		void Waker();
+	};
+
+	/**
+	 * Pull mode of a stream, for consumers that read and write the audio themselves instead of
+	 * getting called back. The stream runs its own callback that moves every period through a
+	 * lock-free ring for the input and one for the output, each holding a configurable amount of
+	 * periods. Reads and writes are for a single consumer thread each, they block until the ring
+	 * has the frames or the room, or can be awaited in a coroutine. The input ring overflowing and
+	 * the output ring running out are reported as dropouts of the stream.
+	 * @tparam T sample type
+	 */
+	template<typename T = float>
+	class PullStream : public PullStreamBase
+	{
+	public:
+		/**
+		 * Awaitable read or write, resumes on the waker thread of the stream once it can complete.
+		 * Awaiting gives the same result as the blocking call. The buffer has to stay valid until
+		 * the coroutine resumes.
+		 */
+		class Operation
+		{
+		public:
+			Operation(PullStream& stream, Buffer<T>& buffer, Direction direction)
+				: m_Stream(stream), m_Buffer(buffer), m_Direction(direction)
+			{}
+
+			bool await_ready() const { return m_Stream.Ready(m_Direction, m_Buffer.Frames()); }
+			void await_suspend(std::coroutine_handle<> handle) { m_Stream.Suspend(m_Direction, m_Buffer.Frames(), handle); }
+			Error await_resume() { return m_Direction == Input ? m_Stream.Read(m_Buffer) : m_Stream.Write(m_Buffer); }
+
+		private:
+			PullStream& m_Stream;
+			Buffer<T>& m_Buffer;
+			Direction m_Direction;
+		};
+
+		/**
+		 * Constructor.
+		 * @param periods amount of periods each ring holds
+		 */
+		PullStream(std::size_t periods)
+			: m_Periods(std::max<std::size_t>(periods, 1))
+		{}
+
+		~PullStream() { StopWaker(); }
+
+		/**
+		 * Read input, blocks until the input ring has all frames. What's left in the ring can still
+		 * be read after the stream stopped.
+		 * @param buffer buffer to fill, all of its frames are read. Channels beyond those of the stream
+		 * are filled with silence.
+		 * @return
+		 * NotOpen - If the stream wasn't opened, or was closed while waiting<br>
+		 * NotRunning - If the stream isn't running, or stopped while waiting, and the ring doesn't have the frames<br>
+		 * InvalidBufferSize - If the buffer has more frames than the ring holds<br>
+		 * NoError - If the buffer was filled
+		 */
+		Error Read(Buffer<T>& buffer) { return Read(buffer.data(), buffer.Channels(), buffer.Frames()); }
+
+		/**
+		 * Read input, see Read(Buffer<T>&).
+		 * @param channels channels to read into
+		 * @param count amount of channels
+		 * @param frames amount of frames
+		 * @return see Read(Buffer<T>&)
+		 */
+		Error Read(T** channels, int count, int frames)
+		{
+			return Transfer(Input, frames, [&](Rings& rings) { rings.input.Read(channels, count, frames); });
+		}
+
+		/**
+		 * Write output, blocks until the output ring has room for all frames. Writing before the stream
+		 * starts fills the ring up front, so the first periods don't run out.
+		 * @param buffer buffer to write, all of its frames are written. Channels of the stream beyond those
+		 * of the buffer get silence.
+		 * @return
+		 * NotOpen - If the stream wasn't opened, or was closed while waiting<br>
+		 * NotRunning - If the stream isn't running, or stopped while waiting, and the ring has no room<br>
+		 * InvalidBufferSize - If the buffer has more frames than the ring holds<br>
+		 * NoError - If the buffer was written
+		 */
+		Error Write(Buffer<T>& buffer) { return Write(buffer.data(), buffer.Channels(), buffer.Frames()); }
+
+		/**
+		 * Write output, see Write(Buffer<T>&).
+		 * @param channels channels to write
+		 * @param count amount of channels
+		 * @param frames amount of frames
+		 * @return see Write(Buffer<T>&)
+		 */
+		Error Write(T* const* channels, int count, int frames)
+		{
+			return Transfer(Output, frames, [&](Rings& rings) { rings.output.Write(channels, count, frames); });
+		}
+
+		/**
+		 * Read input in a coroutine, <code>Error e = co_await pull.ReadAsync(buffer);</code>.
+		 * @param buffer buffer to fill
+		 * @return awaitable, see Read(Buffer<T>&) for its result
+		 */
+		Operation ReadAsync(Buffer<T>& buffer) { return Operation{ *this, buffer, Input }; }
+
+		/**
+		 * Write output in a coroutine, <code>Error e = co_await pull.WriteAsync(buffer);</code>.
+		 * @param buffer buffer to write
+		 * @return awaitable, see Write(Buffer<T>&) for its result
+		 */
+		Operation WriteAsync(Buffer<T>& buffer) { return Operation{ *this, buffer, Output }; }
+
+		/**
+		 * Frames that can be read without waiting.
+		 * @return amount of frames
+		 */
+		std::size_t Readable() const { auto _rings = Current(); return _rings ? _rings->input.Readable() : 0; }
+
+		/**
+		 * Frames that can be written without waiting.
+		 * @return amount of frames
+		 */
+		std::size_t Writable() const { auto _rings = Current(); return _rings ? _rings->output.Writable() : 0; }
+
+		void Allocate(int inputs, int outputs, int frames) override
+		{
+			auto _rings = std::make_shared<Rings>(inputs, outputs, m_Periods * frames);
+			m_Active.store(_rings.get(), std::memory_order_release);
+			Replace(std::move(_rings));
+		}
+
+		void Close() override
+		{
+			m_Active.store(nullptr, std::memory_order_release);
+			m_Running = false;
+			Replace(nullptr);
+		}
+
+		/**
+		 * Move a period through the rings, called by the stream on the audio thread.
+		 * @param input input of the period
+		 * @param output output of the period, what the output ring doesn't have is silence
+		 * @return frames of input that didn't fit in the ring and frames of output it didn't have
+		 */
+		std::pair<int, int> Process(Buffer<T>& input, Buffer<T>& output)
+		{
+			auto _rings = m_Active.load(std::memory_order_acquire);
+			int _frames = std::max(input.Frames(), output.Frames());
+			std::size_t _written = 0, _read = 0;
+			if (_rings)
+			{
+				_written = _rings->input.Write(input.data(), input.Channels(), input.Frames());
+				_read = _rings->output.Read(output.data(), output.Channels(), output.Frames());
+			}
+
+			for (int i = 0; i < output.Channels(); i++)
+				std::fill(output.data()[i] + _read, output.data()[i] + output.Frames(), T{});
+
+			Wake();
+			return { input.Channels() > 0 ? _frames - (int)_written : 0, output.Channels() > 0 ? _frames - (int)_read : 0 };
+		}
+
+	protected:
+		bool Ready(Direction direction, std::size_t frames) const override
+		{
+			auto _rings = Current();
+			return !_rings || !Waitable(*_rings) || frames > _rings->input.Capacity()
+				|| (direction == Input ? _rings->input.Readable() : _rings->output.Writable()) >= frames;
+		}
+
+	private:
+		/**
+		 * The rings of a single open, a consumer keeps them for as long as it waits on them.
+		 */
+		struct Rings
+		{
+			Rings(int inputs, int outputs, std::size_t capacity)
+				: input(inputs, capacity), output(outputs, capacity)
+			{}
+
+			FrameRing<T> input;
+			FrameRing<T> output;
+			std::atomic<bool> closed = false;
+		};
+
+		std::size_t m_Periods;
+		std::shared_ptr<Rings> m_Rings;       // Rings of the current open
+		mutable std::mutex m_RingsMutex;      // Only held to copy or replace m_Rings
+		std::atomic<Rings*> m_Active = nullptr; // Rings the audio thread uses
+
+		std::shared_ptr<Rings> Current() const { std::lock_guard _lock{ m_RingsMutex }; return m_Rings; }
+
+		bool Waitable(const Rings& rings) const { return m_Running.load() && !rings.closed.load(); }
+
+		/**
+		 * Make other rings the current ones, whoever waits on the old ones gives up.
+		 * @param rings new rings
+		 */
+		void Replace(std::shared_ptr<Rings> rings)
+		{
+			{
+				std::lock_guard _lock{ m_RingsMutex };
+				m_Rings.swap(rings);
+			}
+
+			if (rings)
+				rings->closed = true;
+			Interrupt();
+		}
+
+		/**
+		 * Wait until a ring can transfer all frames, and transfer them.
+		 * @param direction Input for a read, Output for a write
+		 * @param frames amount of frames
+		 * @param copy does the transfer
+		 * @return see Read and Write
+		 */
+		template<typename Copy>
+		Error Transfer(Direction direction, int frames, Copy copy)
+		{
+			auto _rings = Current();
+			if (!_rings)
+				return NotOpen;
+
+			auto& _ring = direction == Input ? _rings->input : _rings->output;
+			std::size_t _frames = std::max(frames, 0);
+			if (_frames > _ring.Capacity())
+				return InvalidBufferSize;
+
+			auto _available = [&]() { return direction == Input ? _ring.Readable() : _ring.Writable(); };
+			Wait([&]() { return _available() >= _frames || !Waitable(*_rings); });
+			if (_available() < _frames)
+				return _rings->closed ? NotOpen : NotRunning;
+
+			copy(*_rings);
+			return NoError;
+		}
+	};
+}
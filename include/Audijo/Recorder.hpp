@@ -0,0 +1,113 @@
+#pragma once
+#include "Audijo/pch.hpp"
+#include "Audijo/Log.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Information about the current or last recording.
+	 */
+	struct RecordingInformation
+	{
+		bool active = false;          // Recording is running
+		std::string path;             // File that is recorded to
+		int channels = 0;             // Amount of recorded channels
+		uint64_t frames = 0;          // Frames written to the file
+		uint64_t droppedBlocks = 0;   // Periods that were lost because the writer fell behind
+	};
+
+	/**
+	 * Records periods to a 32 bit float WAV file, switching to RF64 when it grows beyond 4GB. The audio thread
+	 * only copies periods into a preallocated lock-free ring of blocks, a background thread drains the ring
+	 * and writes to disk in large chunks. When the ring is full the period is dropped and counted, the audio
+	 * thread never waits for the disk.
+	 */
+	class Recorder
+	{
+	public:
+		/**
+		 * A single period in the ring, channels are stored one after the other.
+		 */
+		struct Block
+		{
+			float* samples;
+			int stride;
+			int frames;
+
+			float* Channel(int index) { return samples + index * stride; }
+		};
+
+		/**
+		 * Constructor.
+		 * @param path file to record to
+		 * @param channels amount of channels
+		 * @param maxFrames maximum amount of frames in a period
+		 * @param sampleRate sample rate
+		 */
+		Recorder(const std::string& path, int channels, int maxFrames, double sampleRate);
+		~Recorder();
+
+		/**
+		 * Create the file and start the writer thread.
+		 * @return true on success
+		 */
+		bool Start();
+
+		/**
+		 * Stop the writer thread after it wrote everything that is left in the ring, and finish the file.
+		 */
+		void Stop();
+
+		/**
+		 * Get the next free block, realtime safe. Call Commit() once filled.
+		 * @return free block, or nullptr if the ring is full, in which case the period is counted as dropped.
+		 */
+		Block* Acquire();
+
+		/**
+		 * Hand the acquired block to the writer thread, realtime safe.
+		 * @param frames amount of frames written to the block
+		 */
+		void Commit(int frames);
+
+		/**
+		 * Get information about this recording.
+		 * @return recording information
+		 */
+		RecordingInformation Information() const;
+
+	private:
+		constexpr static std::size_t ChunkSize = 1 << 20;  // Bytes written to disk at once
+		constexpr static std::size_t ChunkAlignment = 4096; // Alignment of the chunk and of every write, matches disk sectors
+		constexpr static std::size_t HeaderSize = 4096;     // RIFF + JUNK/ds64 + fmt + padding + data chunk headers, the data starts aligned
+
+		std::string m_Path;
+		int m_Channels;
+		int m_MaxFrames;
+		double m_SampleRate;
+
+		std::vector<float> m_Samples;      // Sample storage for all blocks
+		std::vector<Block> m_Blocks;       // Ring of blocks
+		alignas(64) std::atomic<std::size_t> m_Write = 0; // Blocks committed by the audio thread
+		alignas(64) std::atomic<std::size_t> m_Read = 0;  // Blocks written by the writer thread
+		std::atomic<uint64_t> m_Dropped = 0;
+		std::atomic<uint64_t> m_Frames = 0;
+		std::atomic<bool> m_Running = false;
+
+		std::FILE* m_File = nullptr;
+		char* m_Chunk = nullptr;  // Interleaved samples waiting to be written
+		std::size_t m_ChunkFill = 0;
+		uint64_t m_DataBytes = 0;
+		std::thread m_Writer;
+
+		void Write();
+
+		/**
+		 * Write the chunk to the file, in whole blocks of the chunk alignment. What's left of a block
+		 * moves to the front of the chunk, so every write starts and ends on an aligned file offset.
+		 * @param all also write the last partial block, when finishing the file
+		 */
+		void Flush(bool all = false);
+		void WriteHeader();
+	};
+}
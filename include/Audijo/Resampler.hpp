@@ -0,0 +1,324 @@
+#pragma once
+#include "Audijo/pch.hpp"
+#include "Audijo/Clock.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Streaming resampler for planar float audio.
+	 */
+	class ResamplerBase
+	{
+	public:
+		virtual ~ResamplerBase() = default;
+
+		/**
+		 * Maximum amount of frames a call with the given amount of input frames can produce.
+		 * @param frames amount of input frames
+		 * @return maximum amount of output frames
+		 */
+		virtual int MaxOutput(int frames) const = 0;
+
+		/**
+		 * Resample a block, realtime safe.
+		 * @param input input channels
+		 * @param frames amount of input frames, at most maxFrames
+		 * @param output output channels
+		 * @param capacity amount of frames that fit in the output, at least MaxOutput(frames)
+		 * @return amount of output frames
+		 */
+		virtual int Process(const float* const* input, int frames, float** output, int capacity) = 0;
+
+		/**
+		 * Group delay of the filter.
+		 * @return delay in input frames
+		 */
+		virtual double Delay() const = 0;
+
+		/**
+		 * Forget the input seen so far.
+		 */
+		virtual void Reset() = 0;
+	};
+
+	/**
+	 * Windowed-sinc resampler for planar float audio with a ratio that can change every call, for
+	 * following the drift between two device clocks. The filter is a table of fractional phases,
+	 * the samples in between two phases are interpolated linearly.
+	 */
+	class AsyncResampler : public ResamplerBase
+	{
+	public:
+		constexpr static int Taps = 32;    // Length of the filter in input samples
+		constexpr static int Phases = 256; // Amount of fractional positions in the filter table
+
+		/**
+		 * Constructor.
+		 * @param channels amount of channels
+		 * @param maxFrames maximum amount of input frames per call
+		 * @param nominal nominal ratio of output to input rate, sets the cutoff of the filter
+		 */
+		AsyncResampler(int channels, int maxFrames, double nominal = 1);
+
+		/**
+		 * Set the ratio of output to input rate, applies from the next call.
+		 * @param ratio ratio
+		 */
+		void Ratio(double ratio) { m_Step = 1. / ratio; }
+
+		/**
+		 * Get the ratio of output to input rate.
+		 * @return ratio
+		 */
+		double Ratio() const { return 1. / m_Step; }
+
+		int MaxOutput(int frames) const override { return (int)std::ceil((frames + 1) / m_Step) + 1; }
+		int Process(const float* const* input, int frames, float** output, int capacity) override;
+		double Delay() const override { return Taps / 2; }
+		void Reset() override;
+
+	private:
+		int m_Channels;
+		int m_MaxFrames;
+		std::vector<float> m_Table;   // Filter taps for every phase, Phases + 1 rows of Taps
+		std::vector<float> m_History; // Unconsumed input of every channel, Taps + maxFrames per channel
+		int m_Count = 0;              // Amount of samples in the history
+		double m_Position = 0;        // Position of the next output in the history
+		double m_Step = 1;            // Input samples per output sample
+	};
+
+	/**
+	 * Polyphase windowed-sinc resampler for a fixed ratio of two integer rates, with a phase for every
+	 * output position so nothing is interpolated. Tables are shared between all resamplers of a ratio.
+	 */
+	class PolyphaseResampler : public ResamplerBase
+	{
+	public:
+		constexpr static int Taps = 64;        // Length of the filter in input samples
+		constexpr static int MaxPhases = 1024; // Largest reduced output rate, beyond that the table gets too large
+
+		/**
+		 * Check whether a conversion can be done with exact phases.
+		 * @param inRate input rate
+		 * @param outRate output rate
+		 * @return true if both rates are integers and their reduced ratio has at most MaxPhases phases
+		 */
+		static bool Supports(double inRate, double outRate);
+
+		/**
+		 * Constructor.
+		 * @param channels amount of channels
+		 * @param maxFrames maximum amount of input frames per call
+		 * @param inRate input rate, see Supports
+		 * @param outRate output rate, see Supports
+		 */
+		PolyphaseResampler(int channels, int maxFrames, double inRate, double outRate);
+
+		int MaxOutput(int frames) const override { return (int)(((int64_t)frames + 1) * m_Phases / m_Step) + 2; }
+		int Process(const float* const* input, int frames, float** output, int capacity) override;
+		double Delay() const override { return Taps / 2; }
+		void Reset() override;
+
+	private:
+		int m_Channels;
+		int m_MaxFrames;
+		int m_Phases;                                // Reduced output rate, the amount of phases
+		int m_Step;                                  // Reduced input rate, phases to advance per output
+		std::shared_ptr<const std::vector<float>> m_Table; // Filter taps for every phase, Phases rows of Taps
+		std::vector<float> m_History;                // Unconsumed input of every channel, Taps + maxFrames per channel
+		int m_Count = 0;                             // Amount of samples in the history
+		int m_Index = 0;                             // Position of the next output in the history
+		int m_Phase = 0;                             // Phase of the next output
+	};
+
+	/**
+	 * Resampling stage between a device and the callback when they run at different rates. Device
+	 * periods are resampled into a queue the callback periods take from, and the other way around
+	 * for the output. Uses exact polyphase tables when the rates allow it. Realtime safe, except for
+	 * the constructor.
+	 */
+	class RateConverter
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param inputs amount of input channels
+		 * @param outputs amount of output channels
+		 * @param deviceRate rate of the device
+		 * @param streamRate rate of the callback
+		 * @param period amount of frames in a callback period
+		 * @param maxFrames maximum amount of frames in a device period
+		 */
+		RateConverter(int inputs, int outputs, double deviceRate, double streamRate, int period, int maxFrames);
+
+		/**
+		 * Device rate buffers, the device input gets written here before Write, the
+		 * device output can be taken from here after Read.
+		 */
+		float** DeviceInputs() { return m_DeviceInputs.data(); }
+		float** DeviceOutputs() { return m_DeviceOutputs.data(); }
+
+		/**
+		 * Callback rate buffers of a single period, filled by BeginPeriod and taken by EndPeriod.
+		 */
+		float** Inputs() { return m_Inputs.data(); }
+		float** Outputs() { return m_Outputs.data(); }
+
+		/**
+		 * Resample the device input into the input queue.
+		 * @param frames amount of frames in the device period
+		 */
+		void Write(int frames);
+
+		/**
+		 * Check whether another callback period has to run for the current device period.
+		 * @param frames amount of frames in the device period
+		 * @return true if a period has to run
+		 */
+		bool Pending(int frames) const;
+
+		/**
+		 * Take a period of input from the input queue, anything missing is silence.
+		 */
+		void BeginPeriod();
+
+		/**
+		 * Resample the output of a period into the output queue.
+		 */
+		void EndPeriod();
+
+		/**
+		 * Take the device output from the output queue, anything missing is silence.
+		 * @param frames amount of frames in the device period
+		 */
+		void Read(int frames);
+
+		/**
+		 * Amount of device rate frames in the output queue.
+		 * @return frames
+		 */
+		int Queued() const { return m_OutputCount; }
+
+		/**
+		 * Latency added from device input to device output, both filters and the input queue.
+		 * @return delay in seconds
+		 */
+		double Delay() const;
+
+	private:
+		int m_InputChannels;
+		int m_OutputChannels;
+		double m_DeviceRate;
+		double m_StreamRate;
+		int m_Period;
+
+		std::unique_ptr<ResamplerBase> m_InputResampler;  // Device rate to callback rate
+		std::unique_ptr<ResamplerBase> m_OutputResampler; // Callback rate to device rate
+
+		std::vector<float> m_Memory;
+		std::vector<float*> m_DeviceInputs;
+		std::vector<float*> m_DeviceOutputs;
+		std::vector<float*> m_Inputs;
+		std::vector<float*> m_Outputs;
+		std::vector<float*> m_InputQueue;  // Callback rate input waiting for a period, per channel
+		std::vector<float*> m_OutputQueue; // Device rate output waiting for a device period, per channel
+		std::vector<float*> m_Tails;       // Write positions into one of the queues
+		int m_InputCapacity = 0;
+		int m_OutputCapacity = 0;
+		int m_InputCount = 0;
+		int m_OutputCount = 0;
+	};
+
+	/**
+	 * Bridge between a producer and a consumer running on different clocks, like the capture and
+	 * render devices of a duplex stream. The producer side resamples into a ring, a control loop on
+	 * the fill level of the ring adjusts the ratio so the ring stays at a fixed small latency. The
+	 * fill level counts what the consumer used since its last read, so the phase between both block
+	 * clocks doesn't show up as drift. Single producer and single consumer, both sides are realtime safe.
+	 */
+	class DuplexBridge
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param channels amount of channels
+		 * @param latency amount of frames the ring is held at, at least the largest read
+		 * @param maxFrames maximum amount of frames per write, larger writes are split up
+		 * @param rate sample rate of the consumer
+		 * @param nominal nominal ratio of consumer to producer rate
+		 */
+		DuplexBridge(int channels, int latency, int maxFrames, double rate, double nominal = 1);
+
+		/**
+		 * Write a block on the producer clock.
+		 * @param input input channels
+		 * @param frames amount of frames
+		 * @param time host time of the write, negative to use the current time
+		 */
+		void Write(const float* const* input, int frames, double time = -1);
+
+		/**
+		 * Read a block on the consumer clock, anything missing is filled with silence.
+		 * @param output output channels
+		 * @param frames amount of frames
+		 * @param time host time of the read, negative to use the current time
+		 * @return false if the ring ran empty
+		 */
+		bool Read(float** output, int frames, double time = -1);
+
+		/**
+		 * Amount of frames waiting to be read.
+		 * @return frames
+		 */
+		int Available() const { return (int)(m_Write.load(std::memory_order_acquire) - m_Read.load(std::memory_order_acquire)); }
+
+		/**
+		 * Current ratio of consumer to producer rate, the nominal ratio corrected for drift.
+		 * @return ratio
+		 */
+		double Ratio() const { return m_Ratio.load(std::memory_order_relaxed); }
+
+		/**
+		 * Amount of times the consumer found the ring empty.
+		 * @return underruns
+		 */
+		uint64_t Underruns() const { return m_Underruns.load(std::memory_order_relaxed); }
+
+		/**
+		 * Amount of times the producer found the ring full.
+		 * @return overruns
+		 */
+		uint64_t Overruns() const { return m_Overruns.load(std::memory_order_relaxed); }
+
+	private:
+		constexpr static double MaxCorrection = 0.01; // Largest drift the control loop corrects for
+		constexpr static double Smoothing = 0.5;       // Time constant of the averaged fill level in seconds
+		constexpr static double Proportional = 0.2;    // Correction per second of fill level error
+		constexpr static double Integral = 0.01;       // Correction added per second per second of fill level error
+
+		int m_Channels;
+		int m_Latency;
+		int m_MaxFrames;
+		double m_Rate;
+		double m_Nominal;
+		AsyncResampler m_Resampler;
+
+		std::vector<float> m_Ring;  // Interleaved frames
+		std::size_t m_Mask;
+		alignas(64) std::atomic<std::size_t> m_Write = 0;
+		alignas(64) std::atomic<std::size_t> m_Read = 0;
+
+		std::vector<float> m_Scratch;   // Resampled block, planar
+		std::vector<float*> m_Channel;  // Channels of the scratch block
+		std::vector<const float*> m_Input; // Channels of the input chunk being resampled
+		bool m_Primed = false;          // Consumer side, set once the ring reached its latency
+		std::atomic<double> m_ReadTime = -1; // Host time of the last read
+		std::atomic<int> m_ReadFrames = 0;   // Size of the last read
+		double m_Fill = -1;             // Smoothed fill level, negative until the first write
+		double m_Integral = 0;          // Integral term of the control loop
+
+		std::atomic<double> m_Ratio;
+		std::atomic<uint64_t> m_Underruns = 0;
+		std::atomic<uint64_t> m_Overruns = 0;
+	};
+}
@@ -18,14 +18,21 @@ namespace Audijo
 
 		~RingBuffer() { delete[] m_Buffer; }
 
-		void Enqueue(T item)
+		/**
+		 * Add an item, when full the oldest item makes room for it.
+		 * @param item item
+		 * @return false if the oldest item was overwritten
+		 */
+		bool Enqueue(T item)
 		{
-			if (IsFull())
+			bool _full = IsFull();
+			if (_full)
 				Dequeue();
 
 			m_Buffer[m_Tail] = item;
 			m_Tail = (m_Tail + 1) % m_MaxSize;
 			m_Count++;
+			return !_full;
 		}
 
 		T Dequeue()
@@ -0,0 +1,124 @@
+#ifdef AUDIJO_SHAREDMEMORY
+#pragma once
+#include "Audijo/pch.hpp"
+#include "Audijo/ApiBase.hpp"
+
+namespace Audijo
+{
+	template<>
+	struct DeviceInfo<SharedMemory> : public DeviceInfo<>
+	{
+		/**
+		 * Name of the shared memory segment
+		 */
+		std::string segment;
+
+		/**
+		 * Buffer size of a single period in the segment
+		 */
+		int bufferSize = 0;
+
+		/**
+		 * Amount of periods the ring in the segment holds
+		 */
+		int periods = 0;
+
+		/**
+		 * Sample format of the audio in the segment
+		 */
+		SampleFormat format = None;
+
+		bool operator==(const DeviceInfo&) const = default;
+
+	private:
+		DeviceInfo(DeviceInfo<>&& d)
+			: DeviceInfo<>{ std::forward<DeviceInfo<>>(d) }
+		{}
+
+		friend class SharedMemoryApi;
+	};
+
+	struct SharedMemoryHeader;
+
+	/**
+	 * Inter-process transport, a stream outputs to a segment that another process' stream uses as
+	 * input. Each segment is a lock-free single producer single consumer ring of periods, the
+	 * callbacks work directly on the shared period buffers when the sample formats match.
+	 */
+	class SharedMemoryApi : public ApiBase
+	{
+		/**
+		 * A mapped segment.
+		 */
+		struct Segment
+		{
+			SharedMemoryHeader* header = nullptr;
+			char* data = nullptr;
+			std::size_t size = 0;
+
+			char* Channel(uint64_t period, int channel) const;
+		};
+
+	public:
+		using DeviceSnapshot = std::shared_ptr<const DeviceRegistry<DeviceInfo<SharedMemory>>::Snapshot>;
+
+		SharedMemoryApi(bool loadDevices = true);
+		~SharedMemoryApi();
+
+		const std::vector<DeviceInfo<SharedMemory>>& Devices(bool reload = false);
+		const DeviceInfo<>& Device(int id) const override { return ApiDevice(id); };
+		int DeviceCount() const override { return m_Devices->devices.size(); };
+		const DeviceInfo<SharedMemory>& ApiDevice(int id) const { auto _device = m_Devices->Find(id); return _device ? *_device : m_NoDevice; };
+		DeviceSnapshot Snapshot() const { return m_Registry.Read(); }
+
+		Error Open(const StreamParameters& settings = StreamParameters{}) override;
+		Error Start() override;
+		Error Stop() override;
+		Error Close() override;
+
+		Error SampleRate(double) override;
+
+		/**
+		 * Create a new segment, it will show up as a device in all processes.
+		 * @param name segment name
+		 * @param channels amount of channels
+		 * @param bufferSize frames per period
+		 * @param sampleRate sample rate
+		 * @param periods amount of periods in the ring
+		 * @param format sample format of the audio in the segment
+		 * @return
+		 * AlreadyOpen - If a segment with this name already exists<br>
+		 * NoMemory - If the segment could not be allocated<br>
+		 * NoError - On success
+		 */
+		Error Create(const std::string& name, int channels, int bufferSize, double sampleRate, int periods = 4, SampleFormat format = Float32);
+
+		/**
+		 * Remove a segment. Processes that have it opened keep their mapping until they close.
+		 * @param name segment name
+		 * @return
+		 * NotPresent - If there's no segment with this name<br>
+		 * NoError - On success
+		 */
+		Error Remove(const std::string& name);
+
+	protected:
+		DeviceRegistry<DeviceInfo<SharedMemory>> m_Registry; // Segments by name
+		DeviceSnapshot m_Devices = m_Registry.Read();       // Devices as of the last reload
+		DeviceInfo<SharedMemory> m_NoDevice{ { NoDevice, "", 0, 0, {}, false, SharedMemory } };
+
+		Segment m_Input;  // Segment we consume periods from
+		Segment m_Output; // Segment we produce periods into
+
+		std::vector<char*> m_DeviceInputs;
+		std::vector<char*> m_DeviceOutputs;
+
+		std::thread m_AudioThread;
+
+		const DeviceInfo<SharedMemory>* DeviceById(int id) const;
+		Error Map(const std::string& name, Segment& segment);
+		void Unmap(Segment& segment);
+		void Run();
+	};
+}
+#endif
@@ -0,0 +1,237 @@
+#pragma once
+#include "Audijo/pch.hpp"
+#include "Audijo/Clock.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Stages of a period that get timed.
+	 */
+	enum Stage
+	{
+		InputStage,    // Converting the device input to the callback format, including resampling
+		CallbackStage, // The user callback, all groups
+		OutputStage,   // Converting the output back to the device format, including recording and resampling
+		WaitStage,     // Time between two periods, spent waiting on the device
+		StageAmount
+	};
+
+	/**
+	 * Kinds of dropouts.
+	 */
+	enum XrunType
+	{
+		InputOverrun,   // Input got lost, a device or ring buffer overflowed
+		OutputUnderrun, // The output device ran out of data and played silence
+		LateCallback,   // A period started later than its deadline, or the driver reported an overload
+		InputUnderrun,  // The input side of a duplex stream on two clocks ran empty, the callback got silence
+		XrunTypes
+	};
+
+	/**
+	 * A single dropout.
+	 */
+	struct Xrun
+	{
+		XrunType type;
+		uint64_t position; // Frame position of the stream when it was detected
+		int frames;        // Amount of frames lost, 0 if unknown
+		double time;       // Host time when it was detected, see HostTime
+	};
+
+	/**
+	 * What the watchdog does once the callback went over its budget several periods in a row.
+	 */
+	enum WatchdogPolicy
+	{
+		NoWatchdog,     // Don't time the callback
+		FlagOverload,   // Set the overload flag of the callback info, so the callback can switch to a cheaper path
+		BypassCallback, // Skip the callback and play silence for a while, then try it again
+		GrowBufferSize, // Double the buffer size, up to the largest buffer size of the stream
+	};
+
+	struct WatchdogParameters
+	{
+		WatchdogPolicy policy = NoWatchdog;
+		double budget = 0.9; // Share of the duration of a period the callback may take, of every period of the pipeline when it has one
+		int overruns = 4;    // Periods in a row over budget before the watchdog acts
+		int recovery = 100;  // Periods within budget before the flag clears, or periods the callback is bypassed
+	};
+
+	/**
+	 * Summary of a histogram.
+	 */
+	struct Measurement
+	{
+		uint64_t count = 0; // Amount of values
+		double min = 0;     // Smallest value
+		double average = 0; // Mean of all values
+		double p99 = 0;     // 99th percentile, accurate to the width of a bucket
+		double max = 0;     // Largest value
+	};
+
+	/**
+	 * Timing of the periods of a stream.
+	 */
+	struct StreamStatistics
+	{
+		Measurement stages[StageAmount]; // Duration of every stage in seconds, per device period
+		Measurement load;                // Time spent processing as a percentage of the duration of the device period
+		uint64_t xruns[XrunTypes]{};     // Amount of dropouts of every kind
+		uint64_t xrunPosition[XrunTypes]{}; // Frame position of the last dropout of every kind
+		uint64_t overBudget = 0;         // Periods the callback went over the budget of the watchdog
+		uint64_t overloads = 0;          // Times the watchdog raised the overload flag
+		uint64_t bypasses = 0;           // Times the watchdog bypassed the callback
+		uint64_t bypassedPeriods = 0;    // Periods played as silence because the callback was bypassed
+		uint64_t bufferGrowths = 0;      // Times the watchdog grew the buffer size
+	};
+
+	/**
+	 * Histogram of positive values in logarithmic buckets. A single thread adds values,
+	 * any thread can take a snapshot, all lock-free.
+	 */
+	class Histogram
+	{
+	public:
+		constexpr static int Divisions = 16; // Buckets per octave
+
+		/**
+		 * Constructor.
+		 * @param min values below this end up in the first bucket
+		 * @param max values above this end up in the last bucket
+		 */
+		Histogram(double min, double max);
+
+		/**
+		 * Add a value, realtime safe. Only the writing thread calls this.
+		 * @param value value
+		 */
+		void Add(double value);
+
+		/**
+		 * Forget all values. Only the writing thread calls this.
+		 */
+		void Clear();
+
+		/**
+		 * Summarize the values added so far, can be called from any thread.
+		 * @return measurement
+		 */
+		Measurement Snapshot() const;
+
+	private:
+		double m_Min;
+		double m_Scale; // Buckets per unit of log2(value / min)
+		int m_Size;
+		std::unique_ptr<std::atomic<uint64_t>[]> m_Buckets;
+		std::atomic<uint64_t> m_Count = 0;
+		std::atomic<double> m_Sum = 0;
+		std::atomic<double> m_Smallest = 0;
+		std::atomic<double> m_Largest = 0;
+	};
+
+	/**
+	 * Timing instrumentation of the periods of a stream. The audio thread marks the start of a device
+	 * period, the end of every stage within it and the end of the period. Every part compiles away
+	 * when AUDIJO_STATISTICS isn't defined.
+	 */
+	class PeriodTimer
+	{
+	public:
+		PeriodTimer();
+
+		/**
+		 * Start of a device period, records the time waited since the last one. Audio thread only.
+		 */
+		void Begin()
+		{
+#ifdef AUDIJO_STATISTICS
+			if (m_Clear.exchange(false, std::memory_order_acquire))
+			{
+				for (auto& _histogram : m_Stages)
+					_histogram.Clear();
+				m_Load.Clear();
+			}
+
+			double _now = HostTime();
+			double _finished = m_Finished.load(std::memory_order_relaxed);
+			if (_finished > 0)
+				m_Stages[WaitStage].Add(_now - _finished);
+
+			m_Lap = _now;
+			for (auto& _time : m_Current)
+				_time = 0;
+#endif
+		}
+
+		/**
+		 * End of a stage, the time since the previous mark is added to it. A stage can be marked
+		 * more than once per device period, the times add up. Audio thread only.
+		 * @param stage stage
+		 */
+		void Lap([[maybe_unused]] Stage stage)
+		{
+#ifdef AUDIJO_STATISTICS
+			double _now = HostTime();
+			m_Current[stage] += _now - m_Lap;
+			m_Lap = _now;
+#endif
+		}
+
+		/**
+		 * End of a device period, records its stages and load. Audio thread only.
+		 * @param duration duration of the device period in seconds
+		 */
+		void End([[maybe_unused]] double duration)
+		{
+#ifdef AUDIJO_STATISTICS
+			double _busy = 0;
+			for (int i = 0; i < WaitStage; i++)
+			{
+				m_Stages[i].Add(m_Current[i]);
+				_busy += m_Current[i];
+			}
+
+			if (duration > 0)
+				m_Load.Add(100 * _busy / duration);
+			m_Finished.store(HostTime(), std::memory_order_relaxed);
+#endif
+		}
+
+		/**
+		 * Don't count the time until the next period as waiting, for when the stream stops.
+		 */
+		void Pause()
+		{
+#ifdef AUDIJO_STATISTICS
+			m_Finished.store(0, std::memory_order_relaxed);
+#endif
+		}
+
+		/**
+		 * Start over, takes effect at the next device period. Can be called from any thread.
+		 */
+		void Reset()
+		{
+#ifdef AUDIJO_STATISTICS
+			m_Clear.store(true, std::memory_order_release);
+#endif
+		}
+
+		/**
+		 * Summarize all periods so far, can be called from any thread.
+		 * @return statistics, all empty when statistics are disabled
+		 */
+		StreamStatistics Snapshot() const;
+
+#ifdef AUDIJO_STATISTICS
+	private:
+		Histogram m_Stages[StageAmount];
+		Histogram m_Load;
+		double m_Current[StageAmount]{}; // Time spent in every stage of the current device period
+		double m_Lap = 0;                // Time of the last mark
+		std::atomic<double> m_Finished = 0; // End of the last device period, 0 when there was none
+		std::atomic<bool> m_Clear = false;
+#endif
+	};
+}
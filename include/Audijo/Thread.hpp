@@ -0,0 +1,253 @@
+#pragma once
+#include "Audijo/pch.hpp"
+
+namespace Audijo
+{
+	enum ThreadPolicy
+	{
+		DefaultPolicy,  // Whatever the backend uses by default
+		NormalPolicy,   // Leave the scheduling of the audio thread alone
+		FifoPolicy,     // SCHED_FIFO on Linux, MMCSS "Pro Audio" with time critical priority on Windows
+		DeadlinePolicy, // SCHED_DEADLINE with the buffer period as deadline, Linux only
+	};
+
+	/**
+	 * Real-time configuration of the audio thread.
+	 */
+	struct ThreadParameters
+	{
+		ThreadPolicy policy = DefaultPolicy; // Scheduling policy
+		int priority = 80;                   // Priority for the Fifo policy, 1 to 99 on Linux
+		std::vector<int> affinity;           // Cpus the audio thread may run on, empty for any
+		bool lockMemory = false;             // Lock all current and future memory of the process
+		std::size_t prefaultStack = 0;       // Amount of stack bytes to touch up front so they never page fault
+	};
+
+	enum ThreadSetting
+	{
+		NotRequested, Applied, Failed
+	};
+
+	/**
+	 * Which of the thread parameters actually took effect.
+	 */
+	struct ThreadStatus
+	{
+		ThreadSetting policy = NotRequested;
+		ThreadSetting affinity = NotRequested;
+		ThreadSetting lockMemory = NotRequested;
+		ThreadSetting prefaultStack = NotRequested;
+	};
+
+	/**
+	 * Apply thread parameters to the calling thread.
+	 * @param parameters thread parameters
+	 * @param policy policy to use, the policy in the parameters is ignored
+	 * @param period duration of a single period in seconds, used by the deadline policy
+	 * @return which of the parameters took effect
+	 */
+	ThreadStatus ConfigureThread(const ThreadParameters& parameters, ThreadPolicy policy, double period);
+
+	/**
+	 * Apply the deadline policy to the calling thread, reserving half of every period for processing.
+	 * Realtime safe, it's a single syscall, so the audio thread can follow a new period with it.
+	 * @param period duration of a single period in seconds
+	 * @return whether the policy took effect
+	 */
+	ThreadSetting ConfigureDeadline(double period);
+
+	/**
+	 * Wake-up signal for a thread that sleeps until a deadline, so it can be stopped
+	 * without waiting for the deadline.
+	 */
+	class Signal
+	{
+	public:
+		/**
+		 * Wake up the waiting thread, or make its next wait return immediately.
+		 */
+		void Notify()
+		{
+			{
+				std::lock_guard _lock{ m_Mutex };
+				m_Notified = true;
+			}
+			m_Condition.notify_one();
+		}
+
+		/**
+		 * Wait until notified or until the deadline passed, consumes the notification.
+		 * @param deadline deadline
+		 * @return true if notified
+		 */
+		template<typename Clock, typename Duration>
+		bool WaitUntil(const std::chrono::time_point<Clock, Duration>& deadline)
+		{
+			std::unique_lock _lock{ m_Mutex };
+			bool _notified = m_Condition.wait_until(_lock, deadline, [this]() { return m_Notified; });
+			m_Notified = false;
+			return _notified;
+		}
+
+	private:
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_Notified = false;
+	};
+
+	/**
+	 * Worker threads that run a job in parallel with the calling thread, for splitting up a single
+	 * period. Workers spin briefly before sleeping on the generation counter, and the caller does the
+	 * same on the pending counter, so neither side needs a syscall while the other keeps up.
+	 */
+	class WorkerGroup
+	{
+	public:
+		using Job = void(*)(void* context, int index);
+
+		/**
+		 * Constructor.
+		 * @param cpus cpu each worker gets pinned to, -1 to not pin, one worker is created for each element
+		 */
+		WorkerGroup(const std::vector<int>& cpus);
+		~WorkerGroup();
+
+		/**
+		 * Amount of worker threads, not counting the calling thread.
+		 * @return worker count
+		 */
+		int Workers() const { return m_Threads.size(); }
+
+		/**
+		 * Set the thread parameters, the workers apply them before their next job. Only call
+		 * this while no job is running.
+		 * @param parameters thread parameters
+		 * @param policy policy to use
+		 * @param period duration of a single period in seconds
+		 */
+		void Configure(const ThreadParameters& parameters, ThreadPolicy policy, double period);
+
+		/**
+		 * Change the period of the deadline policy, the workers apply it before their next job.
+		 * Realtime safe, only call this while no job is running.
+		 * @param period duration of a single period in seconds
+		 */
+		void Period(double period);
+
+		/**
+		 * Run a job with index 0 on the calling thread and index 1 to Workers() on the workers,
+		 * returns once all of them are done. Realtime safe.
+		 * @param job job
+		 * @param context context given to the job
+		 */
+		void Run(Job job, void* context);
+
+		/**
+		 * Run a callable with index 0 on the calling thread and index 1 to Workers() on the workers.
+		 * @param job callable taking the index
+		 */
+		template<typename Fn>
+		void Run(Fn& job) { Run([](void* context, int index) { (*(Fn*)context)(index); }, &job); }
+
+	private:
+		constexpr static int SpinCount = 4096;
+
+		std::vector<std::thread> m_Threads;
+		std::vector<int> m_Cpus;
+		bool m_Running = true;
+
+		Job m_Job = nullptr;
+		void* m_Context = nullptr;
+		alignas(64) std::atomic<uint32_t> m_Generation = 0; // Incremented for every job
+		alignas(64) std::atomic<uint32_t> m_Pending = 0;    // Workers that haven't finished the current job
+
+		ThreadParameters m_Parameters;
+		ThreadPolicy m_Policy = NormalPolicy;
+		std::atomic<double> m_Period = 0;
+		std::atomic<uint32_t> m_Configuration = 0; // Incremented when the parameters change
+
+		void Work(int index);
+	};
+
+	/**
+	 * Worker thread that runs periods ahead of the audio thread. Every period the audio thread hands
+	 * over a slot and takes back the slot it handed over a number of periods before, so the worker
+	 * has that many periods to finish it. Slots go through their states lock-free, only the worker
+	 * ever sleeps.
+	 */
+	class Pipeline
+	{
+	public:
+		using Job = void(*)(void* context, int slot);
+
+		/**
+		 * Constructor.
+		 * @param slots amount of slots, one more than the amount of periods the worker runs ahead
+		 * @param job job that processes a slot, runs on the worker
+		 * @param context context given to the job
+		 */
+		Pipeline(int slots, Job job, void* context);
+		~Pipeline();
+
+		/**
+		 * Amount of slots.
+		 * @return slot count
+		 */
+		int Slots() const { return m_Slots; }
+
+		/**
+		 * Set the thread parameters, the worker applies them before its next slot.
+		 * @param parameters thread parameters
+		 * @param policy policy to use
+		 * @param period duration of a single period in seconds
+		 */
+		void Configure(const ThreadParameters& parameters, ThreadPolicy policy, double period);
+
+		/**
+		 * Change the period of the deadline policy, the worker applies it before its next slot.
+		 * Realtime safe.
+		 * @param period duration of a single period in seconds
+		 */
+		void Period(double period);
+
+		/**
+		 * Take a slot to fill, audio thread only. Realtime safe.
+		 * @param slot slot
+		 * @return false if the worker is still busy with it
+		 */
+		bool Acquire(int slot);
+
+		/**
+		 * Hand a filled slot to the worker, audio thread only. Realtime safe.
+		 * @param slot slot taken with Acquire
+		 */
+		void Submit(int slot);
+
+		/**
+		 * Take back a slot the worker finished, audio thread only. Realtime safe.
+		 * @param slot slot
+		 * @return false if the worker hasn't finished it yet, it's left to the worker
+		 */
+		bool Collect(int slot);
+
+	private:
+		enum SlotState : uint32_t { Free, Filling, Queued, Done };
+
+		int m_Slots;
+		Job m_Job;
+		void* m_Context;
+		std::unique_ptr<std::atomic<uint32_t>[]> m_States;
+		std::unique_ptr<int[]> m_Queue;                      // Slots in the order they were submitted
+		alignas(64) std::atomic<uint32_t> m_Submitted = 0;  // Slots submitted so far, the worker waits on it
+		std::atomic<bool> m_Running = true;
+		std::thread m_Thread;
+
+		ThreadParameters m_Parameters;
+		ThreadPolicy m_Policy = NormalPolicy;
+		std::atomic<double> m_Period = 0;
+		std::mutex m_ConfigurationMutex;
+		std::atomic<uint32_t> m_Configuration = 0; // Incremented when the parameters change
+
+		void Work();
+	};
+}
\ No newline at end of file
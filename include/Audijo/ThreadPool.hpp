@@ -0,0 +1,50 @@
+#pragma once
+#include "Audijo/pch.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Fixed size pool of worker threads executing submitted tasks in order of submission.
+	 * Not realtime safe, tasks are submitted from control and background threads.
+	 */
+	class ThreadPool
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param threads amount of worker threads
+		 */
+		ThreadPool(int threads = std::max<int>(std::thread::hardware_concurrency(), 1));
+		~ThreadPool();
+
+		/**
+		 * Submit a task.
+		 * @param task task
+		 * @return future with the result of the task
+		 */
+		template<typename Task>
+		auto Submit(Task&& task) -> std::future<std::invoke_result_t<Task>>
+		{
+			auto _task = std::make_shared<std::packaged_task<std::invoke_result_t<Task>()>>(std::forward<Task>(task));
+			auto _future = _task->get_future();
+			Enqueue([_task]() { (*_task)(); });
+			return _future;
+		}
+
+		/**
+		 * Amount of worker threads.
+		 * @return thread count
+		 */
+		int Threads() const { return m_Threads.size(); }
+
+	private:
+		std::vector<std::thread> m_Threads;
+		std::deque<std::function<void()>> m_Tasks;
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_Running = true;
+
+		void Enqueue(std::function<void()>&& task);
+		void Work();
+	};
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "Audijo/pch.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Single event in a trace. Names point to string literals, so recording never copies a string.
+	 */
+	struct TraceEvent
+	{
+		uint64_t time;    // Nanoseconds on std::chrono::steady_clock
+		const char* name; // Static string
+		int64_t arg;      // Value shown with the event
+		char phase;       // 'B' begin, 'E' end, 'i' instant
+	};
+
+	/**
+	 * Traces the activity of the audio thread and its workers to a Chrome JSON trace, which loads in
+	 * chrome://tracing and in Perfetto. Every thread records into its own lock-free buffer, a background
+	 * thread writes them to the file. When not tracing recording is a single relaxed load, and all of
+	 * it compiles away when AUDIJO_TRACE isn't defined.
+	 */
+	class Tracer
+	{
+	public:
+		constexpr static std::size_t BufferSize = 16384; // Events per thread, more are dropped until the next flush
+
+		/**
+		 * Start tracing to a file, any trace in progress is stopped first.
+		 * @param path path of the JSON file
+		 * @return false if the file couldn't be created
+		 */
+		static bool Start(const std::string& path);
+
+		/**
+		 * Stop tracing, writes what's left and finishes the file.
+		 */
+		static void Stop();
+
+		/**
+		 * Check whether a trace is in progress.
+		 * @return true while tracing
+		 */
+		static bool Enabled() { return m_Enabled.load(std::memory_order_relaxed); }
+
+		/**
+		 * Name the calling thread in the trace and set up its buffer. Threads that never call this get
+		 * their buffer at their first event, which allocates, so audio threads call this up front.
+		 * @param name static string
+		 */
+		static void Thread(const char* name);
+
+		/**
+		 * Record an event on the calling thread, realtime safe once the thread has its buffer.
+		 * @param phase 'B' begin, 'E' end, 'i' instant
+		 * @param name static string
+		 * @param arg value shown with the event
+		 */
+		static void Write(char phase, const char* name, int64_t arg);
+
+	private:
+		static inline std::atomic<bool> m_Enabled = false;
+	};
+
+	/**
+	 * Name the calling thread in traces, see Tracer::Thread.
+	 * @param name static string
+	 */
+	inline void TraceThread([[maybe_unused]] const char* name)
+	{
+#ifdef AUDIJO_TRACE
+		Tracer::Thread(name);
+#endif
+	}
+
+	/**
+	 * Begin a span on the calling thread, ended by the next TraceEnd.
+	 * @param name static string
+	 * @param arg value shown with the span
+	 */
+	inline void TraceBegin([[maybe_unused]] const char* name, [[maybe_unused]] int64_t arg = 0)
+	{
+#ifdef AUDIJO_TRACE
+		if (Tracer::Enabled())
+			Tracer::Write('B', name, arg);
+#endif
+	}
+
+	/**
+	 * End the last span begun on the calling thread.
+	 */
+	inline void TraceEnd()
+	{
+#ifdef AUDIJO_TRACE
+		if (Tracer::Enabled())
+			Tracer::Write('E', nullptr, 0);
+#endif
+	}
+
+	/**
+	 * Mark a moment on the calling thread.
+	 * @param name static string
+	 * @param arg value shown with the mark
+	 */
+	inline void TraceInstant([[maybe_unused]] const char* name, [[maybe_unused]] int64_t arg = 0)
+	{
+#ifdef AUDIJO_TRACE
+		if (Tracer::Enabled())
+			Tracer::Write('i', name, arg);
+#endif
+	}
+
+	/**
+	 * Span for the lifetime of a scope.
+	 */
+	struct TraceScope
+	{
+		TraceScope(const char* name, int64_t arg = 0) { TraceBegin(name, arg); }
+		~TraceScope() { TraceEnd(); }
+	};
+}
@@ -8,6 +8,12 @@ namespace Audijo
 	template<>
 	struct DeviceInfo<Wasapi> : public DeviceInfo<>
 	{
+		/**
+		 * Endpoint id of the device, stays the same when it's unplugged and plugged back in
+		 */
+		std::string endpoint;
+
+		bool operator==(const DeviceInfo&) const = default;
 
 	private:
 		DeviceInfo(DeviceInfo<>&& d)
@@ -59,13 +65,16 @@ namespace Audijo
 		};
 
 	public:
+		using DeviceSnapshot = std::shared_ptr<const DeviceRegistry<DeviceInfo<Wasapi>>::Snapshot>;
+
 		WasapiApi(bool loadDevices = true);
-		~WasapiApi() { Close(); }
+		~WasapiApi() { StopExecutor(); StopNotifications(); Close(); }
 
 		const std::vector<DeviceInfo<Wasapi>>& Devices(bool reload = false);
-		const DeviceInfo<>& Device(int id) const override { for (auto& i : m_Devices) if (i.id == id) return (DeviceInfo<>&)i; };
-		int DeviceCount() const override { return m_Devices.size(); };
-		const DeviceInfo<Wasapi>& ApiDevice(int id) const { for (auto& i : m_Devices) if (i.id == id) return i; };
+		const DeviceInfo<>& Device(int id) const override { return ApiDevice(id); };
+		int DeviceCount() const override { return m_Devices->devices.size(); };
+		const DeviceInfo<Wasapi>& ApiDevice(int id) const { auto _device = m_Devices->Find(id); return _device ? *_device : m_NoDevice; };
+		DeviceSnapshot Snapshot() const { return m_Registry.Read(); }
 
 		Error Open(const StreamParameters& settings = StreamParameters{}) override;
 		Error Start() override;
@@ -75,11 +84,13 @@ namespace Audijo
 		Error SampleRate(double) override;
 
 	protected:
-		std::vector<DeviceInfo<Wasapi>> m_Devices;
+		DeviceRegistry<DeviceInfo<Wasapi>> m_Registry; // Devices by endpoint id
+		DeviceSnapshot m_Devices = m_Registry.Read(); // Devices as of the last reload
+		DeviceInfo<Wasapi> m_NoDevice{ { NoDevice, "", 0, 0, {}, false, Wasapi } };
+		DeviceProber<DeviceInfo<Wasapi>> m_Prober{ m_Registry };
 
 		bool m_CoInitialized = false;
 		Pointer<IMMDeviceEnumerator> m_DeviceEnumerator; // The wasapi device enumerator
-		Pointer<IMMDeviceCollection> m_WasapiDevices; // Device collection
 		Pointer<IMMDevice> m_InputDevice;  // Input device
 		Pointer<IMMDevice> m_OutputDevice; // Output device
 		Pointer<IAudioClient> m_InputClient;  // General client for input
@@ -88,6 +99,35 @@ namespace Audijo
 		Pointer<IAudioRenderClient> m_RenderClient;   // Output client
 
 		std::thread m_AudioThread;
+		HANDLE m_WakeEvent = nullptr;
+
+		/**
+		 * The executor joins the multithreaded apartment before its first control call, and creates
+		 * its own device enumerator there.
+		 */
+		void ControlThread() override;
+
+		/**
+		 * Device enumerator of the calling thread's apartment. The one of the constructor belongs to the
+		 * apartment of the thread that created the stream, the executor uses its own.
+		 * @return enumerator
+		 */
+		IMMDeviceEnumerator* Enumerator();
+
+		/**
+		 * Probe the channels and sample rate of a device from its mix format.
+		 * @param device device, gets the capabilities
+		 * @param flow data flow of the device
+		 * @return false if the device couldn't be probed
+		 */
+		static bool Probe(DeviceInfo<Wasapi>& device, EDataFlow flow);
+
+		/**
+		 * Endpoint id of a device.
+		 * @param device device
+		 * @return endpoint id, empty if it couldn't be retrieved
+		 */
+		static std::string EndpointId(IMMDevice* device);
 	};
 }
 #endif
\ No newline at end of file
@@ -1,11 +1,8 @@
-
-
-
-
+#pragma once
+#ifdef _WIN32
 //#define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <process.h>
-#include <stdint.h>
 
 #ifndef INITGUID
 #define INITGUID
@@ -18,15 +15,58 @@
 
 #undef min
 #undef max
+#endif
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
+#ifdef AUDIJO_PIPEWIRE
+#include <pipewire/pipewire.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/node/io.h>
+#endif
+
+#ifdef AUDIJO_SHAREDMEMORY
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#endif
+
+#include <stdint.h>
 #include <vector>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <memory>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
 #include <cassert>
 #include <concepts>
 #include <algorithm>
 #include <iostream>
 #include <cmath>
 #include <thread>
-
-#define LOGL(x) std::cout << x << std::endl
-#define LOG(x) std::cout << x 
-
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <coroutine>
+#include <functional>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <span>
+#include <numbers>
+#include <numeric>
+#include <map>
+#include <sstream>
@@ -0,0 +1,281 @@
+#include "Audijo/AggregateStream.hpp"
+
+namespace Audijo
+{
+	DelayLine::DelayLine(int channels, int delay, int maxFrames)
+		: m_Channels(channels), m_Delay(std::max(delay, 0)), m_History(m_Channels * m_Delay), m_Scratch(m_Delay + maxFrames)
+	{}
+
+	void DelayLine::Process(float** channels, int frames)
+	{
+		if (m_Delay == 0)
+			return;
+
+		for (int i = 0; i < m_Channels; i++)
+		{
+			float* _history = m_History.data() + i * m_Delay;
+			std::copy_n(_history, m_Delay, m_Scratch.data());
+			std::copy_n(channels[i], frames, m_Scratch.data() + m_Delay);
+			std::copy_n(m_Scratch.data(), frames, channels[i]);
+			std::copy_n(m_Scratch.data() + frames, m_Delay, _history);
+		}
+	}
+
+	Error AggregateStream::Add(Stream<>& stream, const StreamParameters& parameters, int latency)
+	{
+		if (State() != Closed)
+			return AlreadyOpen;
+
+		m_Members.emplace_back(&stream, parameters, latency);
+		return NoError;
+	}
+
+	Error AggregateStream::Open()
+	{
+		if (State() != Closed)
+			return AlreadyOpen;
+
+		if (!m_Callback)
+			return NoCallback;
+
+		if (m_Members.empty())
+			return NotPresent;
+
+		for (std::size_t i = 0; i < m_Members.size(); i++)
+		{
+			auto& _member = m_Members[i];
+			if (i == 0)
+				_member.stream->Callback([this](Buffer<float>& input, Buffer<float>& output, CallbackInfo info) {
+					Master(input, output, info);
+				});
+			else
+				_member.stream->Callback([this, &_member](Buffer<float>& input, Buffer<float>& output, CallbackInfo) {
+					Follow(_member, input, output);
+				});
+
+			// Running at the rate of the master keeps the bridges from having to convert
+			StreamParameters _parameters = _member.parameters;
+			if (i > 0 && _parameters.sampleRate == (double)Default)
+				_parameters.sampleRate = m_Members[0].stream->Information().sampleRate;
+
+			if (auto _error = _member.stream->Open(_parameters))
+			{
+				for (std::size_t j = 0; j < i; j++)
+					m_Members[j].stream->Close();
+				return _error;
+			}
+		}
+
+		Prepare();
+		m_State.store(Opened, std::memory_order_release);
+		return NoError;
+	}
+
+	void AggregateStream::Prepare()
+	{
+		auto _master = m_Members[0].stream->Information();
+		double _rate = _master.sampleRate;
+		int _maxFrames = _master.maxBufferSize;
+
+		m_Information = AggregateInformation{};
+		m_Information.bufferSize = _master.bufferSize;
+		m_Information.sampleRate = _rate;
+
+		// Channels and the latency every member adds before alignment
+		for (std::size_t i = 0; i < m_Members.size(); i++)
+		{
+			auto& _member = m_Members[i];
+			auto _stream = _member.stream->Information();
+			auto& _info = _member.information;
+			double _ratio = _rate / _stream.sampleRate;
+			int _deviceLatency = _member.latency + (int)std::lround(_stream.resamplingDelay * _rate);
+
+			_info = AggregateMember{};
+			_info.firstInput = m_Information.inputChannels;
+			_info.inputs = _stream.inputChannels;
+			_info.firstOutput = m_Information.outputChannels;
+			_info.outputs = _stream.outputChannels;
+			_info.inputLatency = _info.outputLatency = _deviceLatency;
+			m_Information.inputChannels += _info.inputs;
+			m_Information.outputChannels += _info.outputs;
+
+			_member.input.reset();
+			_member.output.reset();
+			if (i == 0)
+				continue;
+
+			// Held at a period of the reader and two of the writer, so the phase between both clocks never runs it empty
+			int _period = (int)std::ceil(_stream.bufferSize * _ratio);
+			if (_info.inputs > 0)
+			{
+				int _latency = _master.bufferSize + 2 * _period;
+				_member.input = std::make_unique<DuplexBridge>(_info.inputs, _latency, _stream.maxBufferSize, _rate, _ratio);
+				_info.inputLatency += _latency;
+			}
+
+			if (_info.outputs > 0)
+			{
+				int _latency = _stream.bufferSize + (int)std::ceil(2 * _master.bufferSize / _ratio);
+				_member.output = std::make_unique<DuplexBridge>(_info.outputs, _latency, _maxFrames, _stream.sampleRate, 1 / _ratio);
+				_info.outputLatency += (int)std::lround(_latency * _ratio);
+			}
+		}
+
+		// Every member is delayed up to the one with the most latency
+		for (auto& _member : m_Members)
+		{
+			auto& _info = _member.information;
+			if (_info.inputs > 0)
+				m_Information.inputLatency = std::max(m_Information.inputLatency, _info.inputLatency);
+			if (_info.outputs > 0)
+				m_Information.outputLatency = std::max(m_Information.outputLatency, _info.outputLatency);
+		}
+
+		for (auto& _member : m_Members)
+		{
+			auto& _info = _member.information;
+			_info.inputDelay = _info.inputs > 0 ? m_Information.inputLatency - _info.inputLatency : 0;
+			_info.outputDelay = _info.outputs > 0 ? m_Information.outputLatency - _info.outputLatency : 0;
+			_member.inputDelay = DelayLine{ _info.inputs, _info.inputDelay, _maxFrames };
+			_member.outputDelay = DelayLine{ _info.outputs, _info.outputDelay, _maxFrames };
+		}
+
+		// Channels of the master come from its own buffers every period, the others from the bridges
+		auto& _first = m_Members[0].information;
+		int _bridgedInputs = m_Information.inputChannels - _first.inputs;
+		int _bridgedOutputs = m_Information.outputChannels - _first.outputs;
+		m_Memory.assign((std::size_t)(_bridgedInputs + _bridgedOutputs) * _maxFrames, 0.f);
+		m_Inputs.assign(m_Information.inputChannels, nullptr);
+		m_Outputs.assign(m_Information.outputChannels, nullptr);
+		for (int i = 0; i < _bridgedInputs; i++)
+			m_Inputs[_first.inputs + i] = m_Memory.data() + (std::size_t)i * _maxFrames;
+		for (int i = 0; i < _bridgedOutputs; i++)
+			m_Outputs[_first.outputs + i] = m_Memory.data() + (std::size_t)(_bridgedInputs + i) * _maxFrames;
+	}
+
+	Error AggregateStream::Start()
+	{
+		if (State() == Closed)
+			return NotOpen;
+
+		if (State() != Opened)
+			return AlreadyRunning;
+
+		for (std::size_t i = m_Members.size(); i-- > 0;)
+			if (auto _error = m_Members[i].stream->Start())
+			{
+				for (std::size_t j = i + 1; j < m_Members.size(); j++)
+					m_Members[j].stream->Stop();
+				return _error;
+			}
+
+		m_State.store(Running, std::memory_order_release);
+		return NoError;
+	}
+
+	Error AggregateStream::Stop()
+	{
+		if (State() == Closed)
+			return NotOpen;
+
+		if (State() != Running)
+			return NotRunning;
+
+		for (auto& _member : m_Members)
+			_member.stream->Stop();
+
+		m_State.store(Opened, std::memory_order_release);
+		return NoError;
+	}
+
+	Error AggregateStream::Close()
+	{
+		if (State() == Closed)
+			return NotOpen;
+
+		if (State() == Running)
+			Stop();
+
+		for (auto& _member : m_Members)
+		{
+			_member.stream->Close();
+			_member.input.reset();
+			_member.output.reset();
+		}
+
+		m_State.store(Closed, std::memory_order_release);
+		return NoError;
+	}
+
+	AggregateInformation AggregateStream::Information() const
+	{
+		AggregateInformation _information = m_Information;
+		_information.state = State();
+		if (_information.state == Closed)
+			return _information;
+
+		for (auto& _member : m_Members)
+		{
+			auto& _info = _information.members.emplace_back(_member.information);
+			if (_member.input)
+			{
+				_info.ratio = _member.input->Ratio();
+				_info.underruns += _member.input->Underruns();
+				_info.overruns += _member.input->Overruns();
+			}
+
+			if (_member.output)
+			{
+				if (!_member.input)
+					_info.ratio = 1 / _member.output->Ratio();
+				_info.underruns += _member.output->Underruns();
+				_info.overruns += _member.output->Overruns();
+			}
+		}
+		return _information;
+	}
+
+	void AggregateStream::Master(Buffer<float>& input, Buffer<float>& output, CallbackInfo info)
+	{
+		int _frames = info.bufferSize;
+		for (std::size_t i = 0; i < m_Members.size(); i++)
+		{
+			auto& _member = m_Members[i];
+			auto& _info = _member.information;
+			float** _inputs = m_Inputs.data() + _info.firstInput;
+			if (i == 0)
+				for (int c = 0; c < _info.inputs; c++)
+					_inputs[c] = input.data()[c];
+			else if (_member.input)
+				_member.input->Read(_inputs, _frames);
+
+			_member.inputDelay.Process(_inputs, _frames);
+		}
+
+		auto& _first = m_Members[0].information;
+		for (int c = 0; c < _first.outputs; c++)
+			m_Outputs[c] = output.data()[c];
+
+		Buffer<float> _input{ m_Inputs.data(), (int)m_Inputs.size(), _frames };
+		Buffer<float> _output{ m_Outputs.data(), (int)m_Outputs.size(), _frames };
+		info.inputChannels = _input.Channels();
+		info.outputChannels = _output.Channels();
+		m_Callback(_input, _output, info);
+
+		for (auto& _member : m_Members)
+		{
+			float** _outputs = m_Outputs.data() + _member.information.firstOutput;
+			_member.outputDelay.Process(_outputs, _frames);
+			if (_member.output)
+				_member.output->Write(_outputs, _frames);
+		}
+	}
+
+	void AggregateStream::Follow(Member& member, Buffer<float>& input, Buffer<float>& output)
+	{
+		if (member.input)
+			member.input->Write(input.data(), input.Frames());
+		if (member.output)
+			member.output->Read(output.data(), output.Frames());
+	}
+}
@@ -1,4 +1,5 @@
 #include "Audijo/ApiBase.hpp"
+#include "Audijo/PullStream.hpp"
 
 namespace Audijo
 {
@@ -26,43 +27,997 @@ namespace Audijo
 		}
 	}
 
-	void ApiBase::AllocateBuffers()
+	constexpr static std::size_t CacheLine = 64;
+
+	ApiBase::ApiBase()
+	{
+		// The audio thread never allocates, so reserve everything up front
+		m_PendingEvents.reserve(MaxEvents);
+		m_DueEvents.reserve(MaxEvents);
+
+		// Realtime logging needs the thread that formats its records
+		Logger::Start();
+	}
+
+	StreamInformation ApiBase::Information() const
+	{
+		StreamInformation _information = m_Information;
+		_information.state = State();
+		uint32_t _status = m_ThreadStatus.load(std::memory_order_acquire);
+		_information.threadStatus = ThreadStatus{ (ThreadSetting)(_status & 0xFF), (ThreadSetting)(_status >> 8 & 0xFF), 
+			(ThreadSetting)(_status >> 16 & 0xFF), (ThreadSetting)(_status >> 24 & 0xFF) };
+		return _information;
+	}
+
+	void ApiBase::AllocateBuffers(int frames)
 	{
 		int _nInChannels = m_Information.inputChannels;
 		int _nOutChannels = m_Information.outputChannels;
-		int _bufferSize = m_Information.bufferSize;
+		int _bufferSize = std::max(frames > 0 ? frames : m_Information.bufferSize, m_Information.maxBufferSize);
+		m_MaxFrames = _bufferSize;
+		m_Information.maxBufferSize = _bufferSize;
+		PublishPeriod(m_Information.bufferSize, m_Information.sampleRate);
 		auto _inFormat = m_Information.inFormat;
 		auto _outFormat = m_Information.outFormat;
 
+		// Channels are padded to whole cache lines, so threads working on neighbouring channels never false-share
+		std::size_t _inStride = (_bufferSize * (_inFormat & Bytes) + CacheLine - 1) / CacheLine * CacheLine;
+		std::size_t _outStride = (_bufferSize * (_outFormat & Bytes) + CacheLine - 1) / CacheLine * CacheLine;
+		m_BufferMemory = new (std::align_val_t{ CacheLine }) char[_inStride * _nInChannels + _outStride * _nOutChannels];
+
 		m_InputBuffers = new char* [_nInChannels];
 		m_OutputBuffers = new char* [_nOutChannels];
 
 		for (int i = 0; i < _nInChannels; i++)
-			m_InputBuffers[i] = new char[_bufferSize * (_inFormat & Bytes)];
+			m_InputBuffers[i] = m_BufferMemory + i * _inStride;
 
 		for (int i = 0; i < _nOutChannels; i++)
-			m_OutputBuffers[i] = new char[_bufferSize * (_inFormat & Bytes)];
+			m_OutputBuffers[i] = m_BufferMemory + _nInChannels * _inStride + i * _outStride;
+
+		// The callback keeps running periods of the buffer size, at the rate of the stream
+		double _deviceRate = m_Information.deviceSampleRate;
+		if (_deviceRate > 0 && _deviceRate != m_Information.sampleRate)
+		{
+			m_Converter = std::make_unique<RateConverter>(_nInChannels, _nOutChannels, _deviceRate, 
+				m_Information.sampleRate, m_Information.bufferSize, _bufferSize);
+			m_Information.resamplingDelay = m_Converter->Delay();
+		}
+
+		AllocatePipeline(_bufferSize);
+
+		if (m_Pull)
+			m_Pull->Allocate(_nInChannels, _nOutChannels, _bufferSize);
+	}
+
+	void ApiBase::AllocatePipeline(int frames)
+	{
+		int _depth = std::max(m_Information.parameters.pipeline, 0);
+		if (_depth == 0)
+			return;
+
+		int _slots = _depth + 1;
+		int _nInChannels = m_Information.inputChannels;
+		int _nOutChannels = m_Information.outputChannels;
+		std::size_t _inStride = (frames * (m_Information.inFormat & Bytes) + CacheLine - 1) / CacheLine * CacheLine;
+		std::size_t _outStride = (frames * (m_Information.outFormat & Bytes) + CacheLine - 1) / CacheLine * CacheLine;
+		std::size_t _slotSize = _inStride * _nInChannels + _outStride * _nOutChannels;
+		m_PipelineMemory = new (std::align_val_t{ CacheLine }) char[std::max<std::size_t>(_slotSize * _slots, 1)];
+
+		m_PipelineSlots.resize(_slots);
+		for (int i = 0; i < _slots; i++)
+		{
+			auto& _slot = m_PipelineSlots[i];
+			char* _memory = m_PipelineMemory + i * _slotSize;
+			_slot.inputs.resize(_nInChannels);
+			_slot.outputs.resize(_nOutChannels);
+			for (int c = 0; c < _nInChannels; c++)
+				_slot.inputs[c] = _memory + c * _inStride;
+			for (int c = 0; c < _nOutChannels; c++)
+				_slot.outputs[c] = _memory + _nInChannels * _inStride + c * _outStride;
+			_slot.events.reserve(MaxEvents);
+		}
+
+		m_Pipeline = std::make_unique<Pipeline>(_slots, [](void* context, int slot) {
+			auto& _api = *(ApiBase*)context;
+			auto& _slot = _api.m_PipelineSlots[slot];
+			_api.RunCallback(_slot.inputs.data(), _slot.outputs.data(), _slot.frames, _slot.sampleRate, _slot.position, _slot.clock, _slot.events);
+		}, this);
+
+		PublishPeriod(m_Information.bufferSize, m_Information.sampleRate);
+	}
+
+	void ApiBase::PublishPeriod(int bufferSize, double sampleRate)
+	{
+		m_Information.bufferSize = bufferSize;
+		m_Information.sampleRate = sampleRate;
+		m_Information.pipelineDelay = m_Pipeline && sampleRate > 0 ? (m_Pipeline->Slots() - 1) * bufferSize / sampleRate : 0;
+
+		// Seqlock, the audio thread skips a period boundary when it sees an odd or changed sequence
+		uint32_t _sequence = m_PeriodSequence.load(std::memory_order_relaxed);
+		m_PeriodSequence.store(_sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_NextBufferSize.store(bufferSize, std::memory_order_relaxed);
+		m_NextSampleRate.store(sampleRate, std::memory_order_relaxed);
+		m_PeriodSequence.store(_sequence + 2, std::memory_order_release);
+	}
+
+	bool ApiBase::UpdatePeriod()
+	{
+		uint32_t _sequence = m_PeriodSequence.load(std::memory_order_acquire);
+		if (_sequence == m_PeriodApplied || (_sequence & 1))
+			return false;
+
+		int _bufferSize = m_NextBufferSize.load(std::memory_order_relaxed);
+		double _sampleRate = m_NextSampleRate.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		// Never wait on a control thread, pick it up at the next period instead
+		if (m_PeriodSequence.load(std::memory_order_relaxed) != _sequence)
+			return false;
+
+		m_PeriodApplied = _sequence;
+		if (_bufferSize == m_BufferSize && _sampleRate == m_SampleRate)
+			return false;
+
+		// The clock restarts at the new period duration
+		if (_sampleRate != m_SampleRate)
+			m_LoopFrames = 0;
+
+		m_BufferSize = _bufferSize;
+		m_SampleRate = _sampleRate;
+
+		// The deadline reservation follows the period, also on the threads helping out
+		if (m_ThreadPolicy == DeadlinePolicy && _sampleRate > 0)
+		{
+			double _period = _bufferSize / _sampleRate;
+			ConfigureDeadline(_period);
+			if (m_Workers)
+				m_Workers->Period(_period);
+			if (m_Pipeline)
+				m_Pipeline->Period(_period);
+		}
+		return true;
 	}
 
 	void ApiBase::FreeBuffers()
 	{
-		if (m_InputBuffers != nullptr)
+		// The worker might still be finishing a slot
+		m_Pipeline.reset();
+		m_PipelineSlots.clear();
+		if (m_PipelineMemory != nullptr)
+		{
+			operator delete[](m_PipelineMemory, std::align_val_t{ CacheLine });
+			m_PipelineMemory = nullptr;
+		}
+
+		delete[] m_InputBuffers;
+		m_InputBuffers = nullptr;
+		delete[] m_OutputBuffers;
+		m_OutputBuffers = nullptr;
+		m_Converter.reset();
+
+		if (m_BufferMemory != nullptr)
+		{
+			operator delete[](m_BufferMemory, std::align_val_t{ CacheLine });
+			m_BufferMemory = nullptr;
+		}
+	}
+
+	void ApiBase::State(StreamState state)
+	{
+		m_State.store(state, std::memory_order_release);
+		FollowState(state);
+	}
+
+	bool ApiBase::Transition(StreamState from, StreamState to)
+	{
+		if (!m_State.compare_exchange_strong(from, to, std::memory_order_acq_rel))
+			return false;
+
+		FollowState(to);
+		return true;
+	}
+
+	void ApiBase::FollowState(StreamState state)
+	{
+		// Readers and writers of the pull stream give up once it's not running
+		if (!m_Pull)
+			return;
+
+		if (state == Closed)
+			m_Pull->Close();
+		else
+			m_Pull->Running(state == Starting || state == Running);
+	}
+
+	Error ApiBase::BeginStart()
+	{
+		if (Transition(Opened, Starting))
+		{
+			m_ResetClock.store(true, std::memory_order_relaxed);
+			m_ResetPipeline.store(true, std::memory_order_relaxed);
+			m_ResetWatchdog.store(true, std::memory_order_relaxed);
+			m_ThreadStatus.store(0, std::memory_order_relaxed);
+			m_Timer.Pause();
+
+			// Someone has to act on the notifications of a running stream
+			if (m_Information.parameters.restart.policy != NoRestart || m_Information.parameters.watchdog.policy == GrowBufferSize
+				|| m_FollowsDevicePeriod)
+				StartNotifications();
+			return NoError;
+		}
+
+		return State() == Closed ? NotOpen : AlreadyRunning;
+	}
+
+	Error ApiBase::BeginStop()
+	{
+		if (Transition(Running, Stopping))
+			return NoError;
+
+		return State() == Closed ? NotOpen : NotRunning;
+	}
+
+	void ApiBase::Callback(std::unique_ptr<CallbackWrapperBase>&& callback)
+	{
+		DetachPull();
+		m_Callback = std::move(callback);
+		m_Groups.clear();
+		m_Workers.reset();
+	}
+
+	Error ApiBase::GroupCallback(const std::vector<ChannelGroup>& groups, std::unique_ptr<CallbackWrapperBase>&& callback)
+	{
+		// The audio thread runs the groups and their workers while the stream is started
+		if (State() != Closed && State() != Opened)
+			return AlreadyRunning;
+
+		// A channel written by two groups at once would be a data race
+		for (std::size_t i = 0; i < groups.size(); i++)
+			for (std::size_t j = i + 1; j < groups.size(); j++)
+			{
+				auto _overlap = [](int a, int as, int b, int bs) { return as > 0 && bs > 0 && a < b + bs && b < a + as; };
+				if (_overlap(groups[i].input, groups[i].inputs, groups[j].input, groups[j].inputs)
+					|| _overlap(groups[i].output, groups[i].outputs, groups[j].output, groups[j].outputs))
+					return InvalidChannelGroups;
+			}
+
+		DetachPull();
+		m_Callback = std::move(callback);
+		m_Groups = groups;
+
+		// One worker for each group after the first, the first one is processed by the audio thread itself
+		std::vector<int> _cpus;
+		for (std::size_t i = 1; i < groups.size(); i++)
+			_cpus.push_back(groups[i].cpu);
+		m_Workers = _cpus.empty() ? nullptr : std::make_unique<WorkerGroup>(_cpus);
+		return NoError;
+	}
+
+	void ApiBase::DetachPull()
+	{
+		// The callback that fed it is replaced, so it won't get any more periods
+		if (m_Pull)
+			m_Pull->Close();
+		m_Pull = nullptr;
+	}
+
+	void ApiBase::ApplyThreadConfiguration(ThreadPolicy fallback)
+	{
+		m_ThreadConfigured = true;
+		TraceThread("Audio");
+
+		// The period as published to the audio thread, control threads may be changing the information
+		ThreadPolicy _policy = m_Information.thread.policy == DefaultPolicy ? fallback : m_Information.thread.policy;
+		double _sampleRate = m_NextSampleRate.load(std::memory_order_relaxed);
+		double _period = _sampleRate > 0 ? m_NextBufferSize.load(std::memory_order_relaxed) / _sampleRate : 0;
+		m_ThreadPolicy = _policy;
+		auto _status = ConfigureThread(m_Information.thread, _policy, _period);
+		m_ThreadStatus.store(_status.policy | _status.affinity << 8 | _status.lockMemory << 16 | _status.prefaultStack << 24, std::memory_order_release);
+
+		// Workers of the channel groups and of the pipeline run with the same parameters
+		if (m_Workers)
+			m_Workers->Configure(m_Information.thread, _policy, _period);
+		if (m_Pipeline)
+			m_Pipeline->Configure(m_Information.thread, _policy, _period);
+	}
+
+	void ApiBase::Process(char** deviceInputs, char** deviceOutputs, int frames, double time)
+	{
+		if (time < 0)
+			time = HostTime();
+
+		// Driver owned audio threads are configured at their first period
+		if (!m_ThreadConfigured.load(std::memory_order_relaxed))
+			ApplyThreadConfiguration();
+
+		m_ProcessEpoch.fetch_add(1);
+		m_Timer.Begin();
+		TraceBegin("Period", frames);
+		UpdatePeriod();
+
+		// Handle the messages from the control threads before anything else
+		if (auto _commands = m_Commands.load(std::memory_order_acquire))
+			for (auto _queue : *_commands)
+				_queue->Drain();
+
+		if (!m_Converter)
+			Period(deviceInputs, deviceOutputs, frames, time, m_Information.deviceInFormat, m_Information.deviceOutFormat);
+		else
 		{
 			int _nInChannels = m_Information.inputChannels;
+			int _nOutChannels = m_Information.outputChannels;
+			double _deviceRate = m_Information.deviceSampleRate;
+			auto _deviceInFormat = (SampleFormat)(m_Information.deviceInFormat & ~Swap);
+			auto _deviceOutFormat = (SampleFormat)(m_Information.deviceOutFormat & ~Swap);
+			char** _inputs = (char**)m_Converter->Inputs();
+			char** _outputs = (char**)m_Converter->Outputs();
+
 			for (int i = 0; i < _nInChannels; i++)
-				delete[] m_InputBuffers[i];
-			delete[] m_InputBuffers;
-			m_InputBuffers = nullptr;
+			{
+				if (m_Information.deviceInFormat & Swap)
+					ByteSwapBuffer(deviceInputs[i], frames, _deviceInFormat);
+				ConvertBuffer((char*)m_Converter->DeviceInputs()[i], deviceInputs[i], frames, Float32, _deviceInFormat);
+			}
+			TraceBegin("Resample");
+			m_Converter->Write(frames);
+			m_Timer.Lap(InputStage);
+			TraceEnd();
+
+			// Periods play after the output that is already queued
+			while (m_Converter->Pending(frames))
+			{
+				m_Converter->BeginPeriod();
+				Period(_inputs, _outputs, m_BufferSize, time + m_Converter->Queued() / _deviceRate, Float32, Float32);
+				TraceBegin("Resample");
+				m_Converter->EndPeriod();
+				m_Timer.Lap(OutputStage);
+				TraceEnd();
+			}
+
+			TraceBegin("Resample");
+			m_Converter->Read(frames);
+			for (int i = 0; i < _nOutChannels; i++)
+			{
+				ConvertBuffer(deviceOutputs[i], (char*)m_Converter->DeviceOutputs()[i], frames, _deviceOutFormat, Float32);
+				if (m_Information.deviceOutFormat & Swap)
+					ByteSwapBuffer(deviceOutputs[i], frames, _deviceOutFormat);
+			}
+			m_Timer.Lap(OutputStage);
+			TraceEnd();
 		}
 
-		if (m_OutputBuffers != nullptr)
+		TraceEnd();
+		m_Timer.End(frames / (m_Converter ? m_Information.deviceSampleRate : m_SampleRate));
+		m_ProcessEpoch.fetch_add(1);
+	}
+
+	void ApiBase::Period(char** deviceInputs, char** deviceOutputs, int frames, double time, SampleFormat deviceInFormat, SampleFormat deviceOutFormat)
+	{
+		int _nInChannels = m_Information.inputChannels;
+		int _nOutChannels = m_Information.outputChannels;
+		auto _sampleRate = m_SampleRate;
+		auto _deviceInFormat = (SampleFormat)(deviceInFormat & ~Swap);
+		bool _inSwap = deviceInFormat & Swap;
+		auto _deviceOutFormat = (SampleFormat)(deviceOutFormat & ~Swap);
+		bool _outSwap = deviceOutFormat & Swap;
+		auto _inFormat = m_Information.inFormat;
+		auto _outFormat = m_Information.outFormat;
+
+		TraceBegin("Input");
+		uint64_t _position = m_Position.load(std::memory_order_relaxed);
+		auto _events = CollectEvents(_position, frames);
+		auto _clock = UpdateClock(_position, frames, time);
+
+		// If the device already uses the callback format we can skip the conversion entirely
+		bool _directIn = _inFormat == deviceInFormat;
+		bool _directOut = _outFormat == deviceOutFormat;
+
+		// Groups write their outputs from different threads, only use device buffers that can't false-share
+		if (_directOut && m_Workers)
+			for (int i = 0; i < _nOutChannels; i++)
+				if ((uintptr_t)deviceOutputs[i] % CacheLine != 0)
+					_directOut = false;
+		char** _inputs = _directIn ? deviceInputs : m_InputBuffers;
+		char** _outputs = _directOut ? deviceOutputs : m_OutputBuffers;
+
+		// Prepare the input buffer
+		if (!_directIn)
+			for (int i = 0; i < _nInChannels; i++)
+			{
+				if (_inSwap)
+					ByteSwapBuffer(deviceInputs[i], frames, _deviceInFormat);
+				ConvertBuffer(m_InputBuffers[i], deviceInputs[i], frames, _inFormat, _deviceInFormat);
+			}
+		m_Timer.Lap(InputStage);
+		TraceEnd();
+
+		// usercallback
+		TraceBegin("Callback", (int64_t)_position);
+		if (m_Pipeline)
+			RunPipelined(_inputs, _outputs, frames, _sampleRate, _position, _clock, _events);
+		else
+			RunCallback(_inputs, _outputs, frames, _sampleRate, _position, _clock, _events);
+		m_Timer.Lap(CallbackStage);
+		TraceEnd();
+
+		TraceBegin("Output");
+		// Copy the recorded channels to the recorder, if it has no room the period is dropped
+		if (auto _recorder = m_Recorder.load(std::memory_order_acquire))
+			if (auto _block = _recorder->Acquire())
+			{
+				for (std::size_t i = 0; i < m_RecordChannels.size(); i++)
+				{
+					int _channel = m_RecordChannels[i];
+					if (_channel < _nInChannels)
+						ConvertBuffer((char*)_block->Channel(i), _inputs[_channel], frames, Float32, _inFormat);
+					else
+						ConvertBuffer((char*)_block->Channel(i), _outputs[_channel - _nInChannels], frames, Float32, _outFormat);
+				}
+				_recorder->Commit(frames);
+			}
+
+		// Convert the output buffer
+		if (!_directOut)
+			for (int i = 0; i < _nOutChannels; i++)
+			{
+				ConvertBuffer(deviceOutputs[i], m_OutputBuffers[i], frames, _deviceOutFormat, _outFormat);
+				if (_outSwap)
+					ByteSwapBuffer(deviceOutputs[i], frames, _deviceOutFormat);
+			}
+		m_Timer.Lap(OutputStage);
+		TraceEnd();
+
+		m_Position.store(_position + frames, std::memory_order_release);
+	}
+
+	void ApiBase::RunCallback(char** inputs, char** outputs, int frames, double sampleRate, uint64_t position, const StreamClock& clock, std::span<const Event> events)
+	{
+		int _nInChannels = m_Information.inputChannels;
+		int _nOutChannels = m_Information.outputChannels;
+		bool _watchdog = m_Information.parameters.watchdog.policy != NoWatchdog;
+		if (_watchdog && m_ResetWatchdog.exchange(false, std::memory_order_relaxed))
 		{
-			int _nOutChannels = m_Information.outputChannels;
+			m_OverBudget = 0;
+			m_WithinBudget = 0;
+			m_Bypass = 0;
+			m_Overload = false;
+		}
+
+		// Bypassed by the watchdog, silence until it tries the callback again
+		if (m_Bypass > 0)
+		{
+			m_Bypass--;
+			m_BypassedCount.fetch_add(1, std::memory_order_relaxed);
+			std::size_t _bytes = frames * (m_Information.outFormat & Bytes);
 			for (int i = 0; i < _nOutChannels; i++)
-				delete[] m_OutputBuffers[i];
-			delete[] m_OutputBuffers;
-			m_OutputBuffers = nullptr;
+				std::memset(outputs[i], 0, _bytes);
+			return;
 		}
+
+		double _start = _watchdog ? HostTime() : 0;
+		if (m_Groups.empty())
+			m_Callback->Call((void**)inputs, (void**)outputs, CallbackInfo{
+				_nInChannels, _nOutChannels, frames, sampleRate, 0, position, clock.time, clock.rate, events, m_Overload
+				}, m_UserData);
+		else
+		{
+			// Every group gets a view of its own channels, all groups run in parallel
+			auto _group = [&](int index) 
+			{
+				auto& _channels = m_Groups[index];
+				int _input = std::clamp(_channels.input, 0, _nInChannels);
+				int _output = std::clamp(_channels.output, 0, _nOutChannels);
+				int _inputCount = std::clamp(_channels.inputs, 0, _nInChannels - _input);
+				int _outputCount = std::clamp(_channels.outputs, 0, _nOutChannels - _output);
+				m_Callback->Call((void**)(inputs + _input), (void**)(outputs + _output), CallbackInfo{
+					_inputCount, _outputCount, frames, sampleRate, index, position, clock.time, clock.rate, events, m_Overload
+					}, m_UserData);
+			};
+
+			if (m_Workers)
+				m_Workers->Run(_group);
+			else
+				_group(0);
+
+			// Output channels outside of every group are silent
+			std::size_t _bytes = frames * (m_Information.outFormat & Bytes);
+			for (int i = 0; i < _nOutChannels; i++)
+				if (std::none_of(m_Groups.begin(), m_Groups.end(), [i](const ChannelGroup& g) { return i >= g.output && i < g.output + g.outputs; }))
+					std::memset(outputs[i], 0, _bytes);
+		}
+
+		if (_watchdog)
+			Watchdog(HostTime() - _start, frames, sampleRate);
+	}
+
+	void ApiBase::Watchdog(double duration, int frames, double sampleRate)
+	{
+		// A pipelined callback has until its output gets played, a full pipeline of periods later. Taken
+		// from the slots, closing resets m_Pipeline while its worker can still be in here
+		auto& _watchdog = m_Information.parameters.watchdog;
+		int _periods = m_PipelineSlots.empty() ? 1 : (int)m_PipelineSlots.size() - 1;
+		if (duration <= _watchdog.budget * _periods * frames / sampleRate)
+		{
+			m_OverBudget = 0;
+
+			// The flag stays up until the callback kept within budget for a while
+			if (m_Overload && ++m_WithinBudget >= _watchdog.recovery)
+				m_Overload = false;
+			return;
+		}
+
+		m_OverBudgetCount.fetch_add(1, std::memory_order_relaxed);
+		m_WithinBudget = 0;
+		if (++m_OverBudget < _watchdog.overruns)
+			return;
+
+		m_OverBudget = 0;
+		switch (_watchdog.policy)
+		{
+		case FlagOverload:
+			if (m_Overload)
+				return;
+
+			m_Overload = true;
+			m_OverloadCount.fetch_add(1, std::memory_order_relaxed);
+			Notify(Overloaded);
+			break;
+
+		case BypassCallback:
+			m_Bypass = std::max(_watchdog.recovery, 1);
+			m_BypassCount.fetch_add(1, std::memory_order_relaxed);
+			Notify(Overloaded);
+			break;
+
+		case GrowBufferSize:
+			// Changing the buffer size is up to the notification thread, it can call into the backend
+			if (frames < m_MaxFrames)
+				Notify(Overloaded, std::min(frames * 2, m_MaxFrames));
+			break;
+
+		case NoWatchdog:
+			break;
+		}
+	}
+
+	void ApiBase::RunPipelined(char** inputs, char** outputs, int frames, double sampleRate, uint64_t position, const StreamClock& clock, std::span<const Event> events)
+	{
+		std::size_t _inBytes = frames * (m_Information.inFormat & Bytes);
+		std::size_t _outBytes = frames * (m_Information.outFormat & Bytes);
+		int _slots = m_Pipeline->Slots();
+		uint64_t _period = m_PipelinePeriod++;
+		if (m_ResetPipeline.exchange(false, std::memory_order_relaxed))
+			m_PipelineStart = _period;
+
+		// Hand this period to the worker, if it's still busy with the slot the period is lost
+		int _next = _period % _slots;
+		if (m_Pipeline->Acquire(_next))
+		{
+			auto& _slot = m_PipelineSlots[_next];
+			for (int i = 0; i < m_Information.inputChannels; i++)
+				std::memcpy(_slot.inputs[i], inputs[i], _inBytes);
+			_slot.period = _period;
+			_slot.frames = frames;
+			_slot.sampleRate = sampleRate;
+			_slot.position = position;
+			_slot.clock = clock;
+			_slot.events.assign(events.begin(), events.end());
+			m_Pipeline->Submit(_next);
+		}
+		else
+			ReportXrun(InputOverrun, frames);
+
+		// Play what the worker finished for the period that was handed over a full pipeline ago
+		bool _played = false;
+		uint64_t _depth = _slots - 1;
+		if (_period >= m_PipelineStart + _depth)
+		{
+			int _ready = (_period - _depth) % _slots;
+			auto& _slot = m_PipelineSlots[_ready];
+			if (!m_Pipeline->Collect(_ready))
+				ReportXrun(OutputUnderrun, frames);
+			else if (_slot.period == _period - _depth)
+			{
+				// The buffer size might have changed since, what's missing is silence
+				std::size_t _bytes = std::min(_outBytes, _slot.frames * (std::size_t)(m_Information.outFormat & Bytes));
+				for (int i = 0; i < m_Information.outputChannels; i++)
+				{
+					std::memcpy(outputs[i], _slot.outputs[i], _bytes);
+					std::memset(outputs[i] + _bytes, 0, _outBytes - _bytes);
+				}
+				_played = true;
+			}
+		}
+
+		if (!_played)
+			for (int i = 0; i < m_Information.outputChannels; i++)
+				std::memset(outputs[i], 0, _outBytes);
+	}
+
+	void ApiBase::AddCommandQueue(std::unique_ptr<CommandQueueBase>&& queue)
+	{
+		// Publish a new list, the old one can go once the audio thread is done with it
+		auto _list = std::make_unique<std::vector<CommandQueueBase*>>();
+		if (m_CommandList)
+			*_list = *m_CommandList;
+		_list->push_back(queue.get());
+		m_CommandQueues.push_back(std::move(queue));
+
+		m_Commands.store(_list.get(), std::memory_order_release);
+		Quiesce();
+		m_CommandList = std::move(_list);
+	}
+
+	StreamClock ApiBase::UpdateClock(uint64_t position, int frames, double time)
+	{
+		// Restart the loop when starting, when the period size changed or when periods went missing
+		bool _reset = m_ResetClock.exchange(false, std::memory_order_relaxed) || frames != m_LoopFrames;
+		double _expected = m_Loop.Time() + m_Loop.Period();
+		if (!_reset && !m_Loop.Update(time))
+		{
+			ReportXrun(LateCallback, (int)((time - _expected) * m_SampleRate));
+			_reset = true;
+		}
+
+		if (_reset)
+		{
+			m_Loop.Reset(time, frames / m_SampleRate);
+			m_LoopFrames = frames;
+		}
+
+		StreamClock _clock{ position, m_Loop.Time(), frames / m_Loop.Period() };
+
+		// Seqlock, readers retry when they see an odd or changed sequence
+		uint32_t _sequence = m_ClockSequence.load(std::memory_order_relaxed);
+		m_ClockSequence.store(_sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_ClockPosition.store(_clock.position, std::memory_order_relaxed);
+		m_ClockTime.store(_clock.time, std::memory_order_relaxed);
+		m_ClockRate.store(_clock.rate, std::memory_order_relaxed);
+		m_ClockSequence.store(_sequence + 2, std::memory_order_release);
+		return _clock;
+	}
+
+	void ApiBase::ReportXrun(XrunType type, int frames)
+	{
+		uint64_t _position = m_Position.load(std::memory_order_relaxed);
+		m_XrunCount[type].fetch_add(1, std::memory_order_relaxed);
+		m_XrunPosition[type].store(_position, std::memory_order_relaxed);
+		TraceInstant("Xrun", type);
+
+		// A full feed drops the newest, the counters still have them
+		if (m_XrunFeed.load(std::memory_order_relaxed))
+			m_Xruns.Push(Xrun{ type, _position, frames, HostTime() });
+	}
+
+	StreamStatistics ApiBase::Statistics() const
+	{
+		auto _statistics = m_Timer.Snapshot();
+		for (int i = 0; i < XrunTypes; i++)
+		{
+			_statistics.xruns[i] = m_XrunCount[i].load(std::memory_order_relaxed);
+			_statistics.xrunPosition[i] = m_XrunPosition[i].load(std::memory_order_relaxed);
+		}
+		_statistics.overBudget = m_OverBudgetCount.load(std::memory_order_relaxed);
+		_statistics.overloads = m_OverloadCount.load(std::memory_order_relaxed);
+		_statistics.bypasses = m_BypassCount.load(std::memory_order_relaxed);
+		_statistics.bypassedPeriods = m_BypassedCount.load(std::memory_order_relaxed);
+		_statistics.bufferGrowths = m_GrowthCount.load(std::memory_order_relaxed);
+		return _statistics;
+	}
+
+	void ApiBase::ResetStatistics()
+	{
+		m_Timer.Reset();
+		for (int i = 0; i < XrunTypes; i++)
+		{
+			m_XrunCount[i].store(0, std::memory_order_relaxed);
+			m_XrunPosition[i].store(0, std::memory_order_relaxed);
+		}
+		m_OverBudgetCount.store(0, std::memory_order_relaxed);
+		m_OverloadCount.store(0, std::memory_order_relaxed);
+		m_BypassCount.store(0, std::memory_order_relaxed);
+		m_BypassedCount.store(0, std::memory_order_relaxed);
+		m_GrowthCount.store(0, std::memory_order_relaxed);
+	}
+
+	void ApiBase::Notify(NotificationType type, double value)
+	{
+		TraceInstant("Notification", type);
+
+		// A full queue drops the newest, the ones before it already ask for the same recovery
+		m_Notifications.Push(Notification{ type, value, m_Position.load(std::memory_order_relaxed), HostTime() });
+	}
+
+	void ApiBase::Listener(std::function<void(const Notification&)> listener)
+	{
+		{
+			std::lock_guard _lock{ m_NotifierMutex };
+			m_Listener = std::move(listener);
+		}
+
+		StartNotifications();
+	}
+
+	void ApiBase::StartNotifications()
+	{
+		std::lock_guard _lock{ m_NotifierMutex };
+		if (m_NotifierRunning)
+			return;
+
+		m_NotifierRunning = true;
+		m_Notifier = std::thread{ [this]() {
+			std::unique_lock _lock{ m_NotifierMutex };
+			while (m_NotifierRunning)
+			{
+				// Posting never wakes us, it has to be realtime safe, so poll
+				m_NotifierWake.wait_for(_lock, std::chrono::milliseconds(10));
+
+				Notification _notification;
+				while (m_NotifierRunning && m_Notifications.Pop(_notification))
+				{
+					_lock.unlock();
+					Dispatch(_notification);
+					_lock.lock();
+				}
+			}
+		} };
+	}
+
+	void ApiBase::StopNotifications()
+	{
+		{
+			std::lock_guard _lock{ m_NotifierMutex };
+			m_NotifierRunning = false;
+		}
+
+		m_NotifierWake.notify_one();
+		if (m_Notifier.joinable())
+			m_Notifier.join();
+	}
+
+	std::future<Error> ApiBase::Execute(std::function<Error(ApiBase&)> call)
+	{
+		std::lock_guard _lock{ m_ExecutorMutex };
+		if (!m_Executor)
+			m_Executor = std::make_unique<ThreadPool>(1);
+
+		return m_Executor->Submit([this, call = std::move(call)]() {
+			ControlThread();
+			std::lock_guard _lock{ m_ControlMutex };
+			return call(*this);
+		});
+	}
+
+	void ApiBase::StopExecutor()
+	{
+		std::unique_ptr<ThreadPool> _executor;
+		{
+			std::lock_guard _lock{ m_ExecutorMutex };
+			_executor = std::move(m_Executor);
+		}
+
+		// The pool finishes the calls that are waiting before it joins
+		_executor.reset();
+	}
+
+	void ApiBase::Deliver(const Notification& notification)
+	{
+		std::function<void(const Notification&)> _listener;
+		{
+			std::lock_guard _lock{ m_NotifierMutex };
+			_listener = m_Listener;
+		}
+
+		// Called without the lock, so the listener can replace itself
+		if (_listener)
+			_listener(notification);
+	}
+
+	void ApiBase::Dispatch(const Notification& notification)
+	{
+		Deliver(notification);
+
+		// Control calls from other threads wait until the restart is done
+		std::unique_lock _control{ m_ControlMutex };
+		auto _type = notification.type;
+
+		// The watchdog asks for a larger buffer size, never worth reopening the stream for
+		if (_type == Overloaded)
+		{
+			if (m_Information.parameters.watchdog.policy == GrowBufferSize && State() != Closed
+				&& notification.value > m_Information.bufferSize && BufferSize((std::size_t)notification.value) == NoError)
+				m_GrowthCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		// The device already runs at the new size, only publish it
+		if (_type == BufferSizeChanged && m_FollowsDevicePeriod)
+		{
+			if (State() != Closed && notification.value > 0 && notification.value <= m_MaxFrames)
+				PublishPeriod((int)notification.value, m_Information.sampleRate);
+			return;
+		}
+
+		auto _policy = m_Information.parameters.restart.policy;
+		bool _reset = _type == ResetRequested || _type == SampleRateChanged || _type == BufferSizeChanged || _type == FormatChanged;
+		bool _lost = _type == DeviceLost || _type == StreamFailed;
+		bool _restart = (_reset && _policy != NoRestart) || (_lost && _policy == RestartAlways);
+		if (!_restart || State() == Closed)
+			return;
+
+		// Already running at the rate, because it was changed through the stream
+		if (_type == SampleRateChanged && notification.value == m_Information.sampleRate)
+			return;
+
+		// A new buffer size usually doesn't need the stream to be reopened
+		if (_type == BufferSizeChanged && BufferSize((std::size_t)notification.value) == NoError)
+			return;
+
+		// Whatever the device posted before the restart no longer applies to the reopened stream
+		Notification _stale;
+		while (m_Notifications.Pop(_stale))
+			Deliver(_stale);
+
+		StreamParameters _parameters = m_Information.parameters;
+		if (_type == BufferSizeChanged)
+			_parameters.bufferSize = (int)notification.value;
+		bool _running = State() != Opened;
+		Close();
+
+		Error _error = NoError;
+		for (int i = 0; i < _parameters.restart.attempts; i++)
+		{
+			// Give the device time to come back, stopping the notifications cuts the wait short
+			if (i > 0)
+			{
+				_control.unlock();
+				std::unique_lock _lock{ m_NotifierMutex };
+				if (m_NotifierWake.wait_for(_lock, std::chrono::duration<double>(_parameters.restart.delay), [this]() { return !m_NotifierRunning; }))
+					return;
+
+				// Opened in the meantime by someone else, their parameters win
+				_lock.unlock();
+				_control.lock();
+				if (State() != Closed)
+					return;
+			}
+
+			if ((_error = Reopen(_parameters, _running)) == NoError)
+			{
+				_control.unlock();
+				Deliver(Notification{ Restarted, (double)(i + 1), Position(), HostTime() });
+				return;
+			}
+		}
+
+		_control.unlock();
+		Deliver(Notification{ RestartFailed, (double)_error, Position(), HostTime() });
+	}
+
+	Error ApiBase::Restart()
+	{
+		if (State() == Closed)
+			return NotOpen;
+
+		StreamParameters _parameters = m_Information.parameters;
+		bool _running = State() != Opened;
+		Close();
+		return Reopen(_parameters, _running);
+	}
+
+	Error ApiBase::Reopen(const StreamParameters& parameters, bool start)
+	{
+		if (auto _error = Open(parameters))
+			return _error;
+
+		if (start)
+			if (auto _error = Start())
+			{
+				Close();
+				return _error;
+			}
+
+		return NoError;
+	}
+
+	StreamClock ApiBase::Clock() const
+	{
+		StreamClock _clock;
+		uint32_t _before, _after;
+		do
+		{
+			_before = m_ClockSequence.load(std::memory_order_acquire);
+			_clock.position = m_ClockPosition.load(std::memory_order_relaxed);
+			_clock.time = m_ClockTime.load(std::memory_order_relaxed);
+			_clock.rate = m_ClockRate.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			_after = m_ClockSequence.load(std::memory_order_relaxed);
+		} while (_before != _after || (_before & 1));
+		return _clock;
+	}
+
+	std::span<const Event> ApiBase::CollectEvents(uint64_t position, int frames)
+	{
+		// Take what arrived, as long as there's room
+		while (m_PendingEvents.size() < MaxEvents && m_Events.Consume([&](Event& e) { m_PendingEvents.push_back(e); }));
+
+		m_DueEvents.clear();
+		if (m_PendingEvents.empty())
+			return {};
+
+		uint64_t _end = position + frames;
+		std::erase_if(m_PendingEvents, [&](const Event& e) {
+			if (e.frame >= _end)
+				return false;
+
+			m_DueEvents.push_back(e);
+			return true;
+		});
+
+		// Events mostly arrive in order, insertion sort keeps events on the same frame in order of arrival
+		for (std::size_t i = 1; i < m_DueEvents.size(); i++)
+			for (std::size_t j = i; j > 0 && m_DueEvents[j - 1].frame > m_DueEvents[j].frame; j--)
+				std::swap(m_DueEvents[j - 1], m_DueEvents[j]);
+
+		for (auto& _event : m_DueEvents)
+			_event.offset = _event.frame > position ? (int)(_event.frame - position) : 0;
+
+		return m_DueEvents;
+	}
+
+	void ApiBase::Quiesce()
+	{
+		uint64_t _epoch = m_ProcessEpoch.load();
+		if (_epoch & 1)
+			while (m_ProcessEpoch.load() == _epoch)
+				std::this_thread::yield();
+	}
+
+	Error ApiBase::Record(const std::string& path, const std::vector<int>& channels)
+	{
+		if (State() == Closed)
+			return NotOpen;
+
+		// Channels are numbered inputs first, then outputs. No channels means all of them.
+		int _nChannels = m_Information.inputChannels + m_Information.outputChannels;
+		std::vector<int> _channels = channels;
+		if (_channels.empty())
+			for (int i = 0; i < _nChannels; i++)
+				_channels.push_back(i);
+
+		for (auto& _channel : _channels)
+			if (_channel < 0 || _channel >= _nChannels)
+				return Fail;
+
+		StopRecording();
+
+		auto _recorder = std::make_unique<Recorder>(path, (int)_channels.size(), m_MaxFrames, m_Information.sampleRate);
+		if (!_recorder->Start())
+			return Fail;
+
+		// Publish the recorder, the channels are set before so the audio thread sees them with it
+		m_RecordChannels = std::move(_channels);
+		m_Recording = std::move(_recorder);
+		m_Recorder.store(m_Recording.get(), std::memory_order_release);
+		return NoError;
+	}
+
+	Error ApiBase::StopRecording()
+	{
+		if (!m_Recorder.exchange(nullptr))
+			return NotRunning;
+
+		// Once the audio thread is done with the recorder, write what's left and finish the file
+		Quiesce();
+		m_Recording->Stop();
+		return NoError;
+	}
+
+	RecordingInformation ApiBase::Recording() const
+	{
+		return m_Recording ? m_Recording->Information() : RecordingInformation{};
 	}
 
 	void ApiBase::ConvertBuffer(char* outBuffer, char* inBuffer, size_t bufferSize, SampleFormat outFormat, SampleFormat inFormat)
@@ -114,6 +1069,7 @@ namespace Audijo
 			case Float32: ConvertBufferTyped<double, float>(outBuffer, inBuffer, bufferSize); break;
 			default: std::copy(inBuffer, inBuffer + 8 * bufferSize, outBuffer);
 			} break;
+		default: break;
 		}
 	}
 
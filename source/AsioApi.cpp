@@ -44,7 +44,8 @@ namespace Audijo
 	DeviceInfo<Asio>::DeviceInfo(DeviceInfo<>&& d)
 		: DeviceInfo<>{ std::forward<DeviceInfo<>>(d) }
 	{
-		Channels();
+		// Channel information is probed when it's first asked for, loading every
+		// driver a second time while enumerating made startup twice as slow.
 	}
 
 	ChannelInfo& DeviceInfo<Asio>::Channel(int index, bool input) const
@@ -55,13 +56,14 @@ namespace Audijo
 	std::vector<ChannelInfo>& DeviceInfo<Asio>::Channels() const
 	{
 		// Only probe information if it's the same id, or when there's not an opened asio driver
-		if (m_Channels.empty() && ((AsioApi::m_AsioApi && AsioApi::m_AsioApi->m_Information.input == id) || AsioApi::m_State == AsioApi::Loaded))
+		if (m_Channels.empty() && !name.empty() && ((AsioApi::m_AsioApi && AsioApi::m_AsioApi->m_Information.input == id) || AsioApi::m_DriverState == AsioApi::Loaded))
 		{
 			// Only open driver if not currently opened
 			if (!AsioApi::m_AsioApi || AsioApi::m_AsioApi->m_Information.input != id)
 			{
-				char _name[32];
-				drivers.asioGetDriverName(id, _name, 32);
+				// Ids are stable across reloads, the driver index isn't, so load it by name
+				char _name[32]{};
+				name.copy(_name, sizeof(_name) - 1);
 				drivers.loadDriver(_name);
 				ASIOInit(&driverInfo);
 			}
@@ -110,23 +112,20 @@ namespace Audijo
 	}
 
 	AsioApi::~AsioApi()
-	{   
+	{
+		StopExecutor();
+		StopNotifications();
 		Close();
 	}
 
 	const std::vector<DeviceInfo<Asio>>& AsioApi::Devices(bool reload)
 	{
 		// Can't probe new info when a stream has been opened
-		if (m_State != Loaded || !reload)
-			return m_Devices;
-
-		// Make a list of all numbers from 0 to amount of current devices
-		// this is used to determine if we need to delete devices from the list after querying.
-		std::vector<int> _toDelete;
-		for (int i = m_Devices.size() - 1; i >= 0; i--)
-			_toDelete.push_back(i);
+		if (m_DriverState != Loaded || !reload)
+			return m_Devices->devices;
 
 		// Go through all devices
+		std::vector<std::pair<std::string, DeviceInfo<Asio>>> _devices;
 		for (int i = 0; i < drivers.asioGetNumDev(); i++)
 		{
 			// Get device name
@@ -136,7 +135,7 @@ namespace Audijo
 			// Load the driver to collect further information
 			if (!drivers.loadDriver(_name))
 			{
-				LOGL("Failed to load device: " << _name);
+				LOGW("Failed to load device: " << _name);
 				continue;
 			}
 
@@ -159,43 +158,21 @@ namespace Audijo
 			// Make sure to remove the current driver once we're done querying
 			drivers.removeCurrentDriver();
 
-			// Edit an existing device, or if doesn't exist, just add new device.
-			bool _found = false;
-			int _index = 0;
-			for (auto& _device : m_Devices)
-			{
-				if (_device.name == _name)
-				{
-					_found = true;
-					_device.id = i;
-					_device.inputChannels = _in;
-					_device.outputChannels = _out;
-					_device.sampleRates = _srates;
-					_device.defaultDevice = i == 0; // No default in ASIO, so just id == 0
-
-					// Erase from the toDelete, since we've still found the device!
-					_toDelete.erase(std::find(_toDelete.begin(), _toDelete.end(), _index));
-					break;
-				}
-				_index++;
-			}
-
-			if (!_found) // No default in ASIO, so just id == 0
-				m_Devices.push_back(DeviceInfo<Asio>{{ i, _name, _in, _out, _srates, i == 0, Asio }});
+			// No default in ASIO, so just the first driver
+			_devices.emplace_back(_name, DeviceInfo<Asio>{{ NoDevice, _name, _in, _out, _srates, i == 0, Asio }});
 		}
 
-		// Delete all devices we couldn't find again.
-		for (auto& i : _toDelete)
-			m_Devices.erase(m_Devices.begin() + i);
-
-		return m_Devices;
+		// Drivers keep their id when others get installed or removed
+		m_Registry.Update(std::move(_devices));
+		m_Devices = m_Registry.Read();
+		return m_Devices->devices;
 	}
 
 	Error AsioApi::Open(const StreamParameters& settings)
 	{
 		// The ASIO state is global, since ASIO only allows a single driver to be opened per program,
 		// so if the state is not 'Loaded' we can't open another stream.
-		if (m_State == Prepared || m_State == Running)
+		if (m_DriverState == Prepared || m_DriverState == Running)
 			return AlreadyOpen;
 
 		// Make sure to free buffers first
@@ -220,9 +197,14 @@ namespace Audijo
 				return InvalidDuplex;
 			}
 
-			// Since ASIO doesn't have a 'default' device, just set it to 0 if none is selected
+			// Since ASIO doesn't have a 'default' device, use the first driver if none is selected
 			if (m_Information.input == Default)
-				m_Information.input = m_Information.output = 0;
+			{
+				m_Information.input = m_Information.output = NoDevice;
+				for (auto& i : m_Devices->devices)
+					if (i.defaultDevice)
+						m_Information.input = m_Information.output = i.id;
+			}
 		}
 
 		auto _device = DeviceById(m_Information.input);
@@ -245,14 +227,16 @@ namespace Audijo
 
 		// Open the driver
 		{
+			char _name[32]{};
+			_device->name.copy(_name, sizeof(_name) - 1);
 			drivers.removeCurrentDriver();
-			drivers.loadDriver(_device->name.data());
+			drivers.loadDriver(_name);
 
 			// Init the ASIO
 			driverInfo.asioVersion = 2;
 			driverInfo.sysRef = GetForegroundWindow();
 			CHECK(ASIOInit(&driverInfo), "Failed to initialize ASIO: ", return _error == ASE_HWMalfunction ? Fail : NotPresent);
-			m_State = Initialized;
+			m_DriverState = Initialized;
 		}
 
 		// SampleRate
@@ -267,9 +251,13 @@ namespace Audijo
 				m_Information.sampleRate = _sampleRate; // Also update in settings
 			}
 
-			// Set samplerate
-			CHECK(ASIOSetSampleRate(_sampleRate), "Failed to set sample rate to " << _sampleRate << ": ",
-				m_State = Loaded; return _error == ASE_InvalidMode ? InvalidSampleRate : NotPresent);
+			// Set samplerate, if the driver can't run at it keep its current rate and resample
+			ASIOSampleRate _deviceRate = 0;
+			if (m_Information.resampling && ASIOCanSampleRate(_sampleRate) != ASE_OK && ASIOGetSampleRate(&_deviceRate) == ASE_OK)
+				m_Information.deviceSampleRate = _deviceRate;
+			else
+				CHECK(ASIOSetSampleRate(_sampleRate), "Failed to set sample rate to " << _sampleRate << ": ",
+					m_DriverState = Loaded; return _error == ASE_InvalidMode ? InvalidSampleRate : NotPresent);
 		}
 
 		// Get channel formats
@@ -279,7 +267,7 @@ namespace Audijo
 			_inChannelInfo.channel = 0;
 			_inChannelInfo.isInput = true;
 			CHECK(ASIOGetChannelInfo(&_inChannelInfo), "Failed to collect channel info: ",
-				m_State = Loaded; return NotPresent);
+				m_DriverState = Loaded; return NotPresent);
 
 			m_Information.deviceInFormat = Float32;
 			switch (_inChannelInfo.type)
@@ -302,7 +290,7 @@ namespace Audijo
 			_outChannelInfo.channel = 0;
 			_outChannelInfo.isInput = true;
 			CHECK(ASIOGetChannelInfo(&_outChannelInfo), "Failed to collect channel info: ",
-				m_State = Loaded; return NotPresent);
+				m_DriverState = Loaded; return NotPresent);
 
 			m_Information.deviceOutFormat = Float32;
 			switch (_outChannelInfo.type)
@@ -361,11 +349,13 @@ namespace Audijo
 			CHECK(ASIOCreateBuffers(m_BufferInfos, _nChannels, _bufferSize, &m_Callbacks), "Failed to create ASIO buffers: ",
 				return _error == ASE_NoMemory ? NoMemory : _error == ASE_InvalidMode ? InvalidBufferSize : NotPresent);
 			
-			m_State = Prepared;
-			m_Information.state = Opened;
+			m_DeviceFrames = _bufferSize;
+			m_DriverState = Prepared;
+			State(Opened);
 
 			// Allocate the user callback buffers
 			AllocateBuffers();
+			CollectDeviceBuffers();
 		}
 
 		// Since we can only have a single asio instance open at any time, set 
@@ -376,89 +366,121 @@ namespace Audijo
 
 	Error AsioApi::Start()
 	{
-		if (m_State == Loaded)
+		if (m_DriverState == Loaded)
 			return NotOpen;
 
-		if (m_State == Running)
-			return AlreadyRunning;
+		if (auto _error = BeginStart())
+			return _error;
+
+		// The driver owns the audio thread, it is configured at the first buffer switch
+		m_ThreadConfigured = false;
+		m_TimeOffsetValid = false;
 
 		auto error = ASIOStart();
 		if (error != ASE_OK)
+		{
+			Transition(Starting, Opened);
 			return Fail;
+		}
 
-		m_State = Running;
-		m_Information.state = StreamState::Running;
+		m_DriverState = Running;
+		Transition(Starting, StreamState::Running);
 		return NoError;
 	};
 
 	Error AsioApi::Stop()
 	{
-		if (m_State == Loaded)
+		if (m_DriverState == Loaded)
 			return NotOpen;
 
-		if (m_State == Prepared)
-			return NotRunning;
+		if (auto _error = BeginStop())
+			return _error;
 
-		CHECK(ASIOStop(), "Failed to stop the stream.", return Fail);
+		// Returns once the driver stopped calling back
+		CHECK(ASIOStop(), "Failed to stop the stream.", Transition(Stopping, StreamState::Running); return Fail);
 
-		m_State = Prepared;
-		m_Information.state = Opened;
+		m_DriverState = Prepared;
+		Transition(Stopping, Opened);
 		return NoError;
 	};
 
 	Error AsioApi::Close()
 	{
-		if (m_State == Loaded)
+		if (m_DriverState == Loaded)
 			return NotOpen;
 
-		if (m_State == Running)
+		if (m_DriverState == Running)
 			CHECK(ASIOStop(), "Failed to stop the stream.", return Fail);
-		
+
+		StopRecording();
 		drivers.removeCurrentDriver();
 		theAsioDriver = nullptr;
 
-		m_State = Loaded;
+		m_DriverState = Loaded;
 		m_Information = StreamInformation{};
-		m_Information.state = Closed;
+		State(Closed);
 		return NoError;
 	};	
 	
 	Error AsioApi::SampleRate(double srate)
 	{
-		if (m_State == Loaded)
+		if (m_DriverState == Loaded)
 			return NotOpen;
 
+		// The resampling stage was set up for the rate the stream was opened at
+		if (m_Converter)
+			return Fail;
+
 		CHECK(ASIOSetSampleRate(srate), "Failed to set sample rate", 
 			return _error == ASE_InvalidMode ? InvalidSampleRate : Fail);
 
+		// Takes effect at the next buffer switch
+		PublishPeriod(m_Information.bufferSize, srate);
+		m_Information.parameters.sampleRate = srate;
 		return NoError;
 	};
 
 	Error AsioApi::BufferSize(std::size_t size)
 	{
-		if (m_State == Loaded)
+		if (m_DriverState == Loaded)
 			return NotOpen;
 
-		auto _pastState = m_State;
+		if (size == 0)
+			return InvalidBufferSize;
+
+		// The driver has to stop calling back before its buffers can be replaced
+		auto _pastState = m_DriverState;
+		if (_pastState == Running)
+			CHECK(ASIOStop(), "Failed to stop the stream.", return Fail);
 
 		// Create the buffers
 		auto _nChannels = m_Information.inputChannels + m_Information.outputChannels;
 		auto _bufferSize = size;
-		m_State = Loaded;
+		m_DriverState = Loaded;
 		ASIODisposeBuffers();
 		CHECK(ASIOCreateBuffers(m_BufferInfos, _nChannels, _bufferSize, &m_Callbacks), "Failed to create ASIO buffers: ",
 			return _error == ASE_NoMemory ? NoMemory : _error == ASE_InvalidMode ? InvalidBufferSize : NotPresent);
-		m_State = Prepared;
-		m_Information.bufferSize = _bufferSize;
-		FreeBuffers();
-		AllocateBuffers();
+		m_DeviceFrames = (int)_bufferSize;
+		m_DriverState = Prepared;
+		CollectDeviceBuffers();
+
+		// Our own buffers only get replaced when they're too small, or when the resampling stage needs a new period
+		if ((int)_bufferSize > m_MaxFrames || m_Converter)
+		{
+			m_Information.bufferSize = _bufferSize;
+			FreeBuffers();
+			AllocateBuffers();
+		}
+
+		PublishPeriod(_bufferSize, m_Information.sampleRate);
+		m_Information.parameters.bufferSize = _bufferSize;
 
 		if (_pastState == Running) {
 			auto error = ASIOStart();
 			if (error != ASE_OK)
 				return Fail;
 
-			m_State = Running;
+			m_DriverState = Running;
 		}
 
 		return NoError;
@@ -466,23 +488,22 @@ namespace Audijo
 
 	Error AsioApi::OpenControlPanel()
 	{ 
-		if (m_State == Loaded)
+		if (m_DriverState == Loaded)
 			return NotOpen;
 
 		CHECK(ASIOControlPanel(), "Failed to open control panel", return Fail);
 		return NoError;
 	}
 
-	DeviceInfo<Asio>* AsioApi::DeviceById(int id) {
-		for (auto& device : m_Devices) {
-			if (device.id == id) return &device;
-		}
-		return nullptr;
+	const DeviceInfo<Asio>* AsioApi::DeviceById(int id) const
+	{
+		return m_Devices->Find(id);
 	}
 
 	void AsioApi::SampleRateDidChange(ASIOSampleRate sRate)
 	{
-		m_AsioApi->m_Information.sampleRate = sRate;
+		// Called on a driver thread, the stream information is updated when the stream is reopened
+		m_AsioApi->Notify(SampleRateChanged, sRate);
 	};
 
 	long AsioApi::AsioMessage(long selector, long value, void* message, double* opt)
@@ -497,76 +518,89 @@ namespace Audijo
 				|| value == kAsioBufferSizeChange
 				|| value == kAsioSupportsTimeInfo
 				|| value == kAsioSupportsTimeCode
-				|| value == kAsioSupportsInputMonitor)
+				|| value == kAsioSupportsInputMonitor
+				|| value == kAsioOverload)
 				return 1L;
 			return 0L;
 		case kAsioSupportsTimeInfo: return 1L;
 		case kAsioSupportsTimeCode: return 0L;
 		case kAsioBufferSizeChange: 
 		{
-			// When the buffer size changes, free the current buffers
-			// and then allocate new buffers for the user callback
-			m_AsioApi->FreeBuffers();
-			m_AsioApi->m_Information.bufferSize = value;
-			m_AsioApi->AllocateBuffers();
+			// The buffers can't be replaced on the driver thread while the callback may use them, 
+			// the notification thread switches to the new size, see ApiBase::Dispatch
+			m_AsioApi->Notify(BufferSizeChanged, value);
 			return 1L;
 		}
 		case kAsioResetRequest:
 		{
-			// Set new buffersize
-			//long a, b, pSize, c;
-			//ASIOGetBufferSize(&a, &b, &pSize, &c);
-			//m_AsioApi->m_Parameters.bufferSize = pSize;
-
-			// Notify that we need to reset
-			m_State = Reset;
+			// The driver has to be reinitialized, which can't happen on its own thread. The
+			// driver state stays as it is, so closing still stops the driver first.
+			m_AsioApi->Notify(ResetRequested);
 			return 1L;
 		}
 		case kAsioEngineVersion: return 2L;
 		case kAsioResyncRequest: return 1L;
-		case kAsioLatenciesChanged: return 1L;
+		case kAsioLatenciesChanged:
+		{
+			m_AsioApi->Notify(LatencyChanged);
+			return 1L;
+		}
+		case kAsioOverload:
+		{
+			// The driver missed its deadline, usually because a period took too long
+			m_AsioApi->ReportXrun(LateCallback);
+			return 1L;
+		}
 		}
 		return 0;
 	};
 
-	ASIOTime* AsioApi::BufferSwitchTimeInfo(ASIOTime* params, long doubleBufferIndex, ASIOBool directProcess)
+	void AsioApi::CollectDeviceBuffers()
 	{
-		// Retrieve information from object
-		int _nInChannels      = m_AsioApi->m_Information.inputChannels;
-		int _nOutChannels     = m_AsioApi->m_Information.outputChannels;
-		int _bufferSize       = m_AsioApi->m_Information.bufferSize;
-		auto _sampleRate      = m_AsioApi->m_Information.sampleRate;
-		auto _deviceInFormat  = m_AsioApi->m_Information.deviceInFormat;
-		bool _inSwap          = m_AsioApi->m_Information.deviceInFormat & Swap;
-		auto _deviceOutFormat = m_AsioApi->m_Information.deviceOutFormat;
-		bool _outSwap         = m_AsioApi->m_Information.deviceOutFormat & Swap;
-		auto _inFormat        = m_AsioApi->m_Information.inFormat;
-		auto _outFormat       = m_AsioApi->m_Information.outFormat;
-		char** _inputs        = m_AsioApi->m_InputBuffers;
-		char** _outputs       = m_AsioApi->m_OutputBuffers;
-
-		// Prepare the input buffer
-		for (int i = 0; i < _nInChannels; i++)
+		int _nInChannels = m_Information.inputChannels;
+		int _nOutChannels = m_Information.outputChannels;
+
+		// Keep pointers to both halves of the ASIO double buffer, so the 
+		// buffer switch only has to pick the right set.
+		for (int _half = 0; _half < 2; _half++)
 		{
-			char* _temp = (char*)m_BufferInfos[i].buffers[doubleBufferIndex];
-			if (_inSwap)
-				m_AsioApi->ByteSwapBuffer(_temp, _bufferSize, _deviceInFormat);
-			m_AsioApi->ConvertBuffer(_inputs[i], _temp, _bufferSize, _inFormat, _deviceInFormat);
+			m_DeviceInputs[_half].resize(_nInChannels);
+			m_DeviceOutputs[_half].resize(_nOutChannels);
+			for (int i = 0; i < _nInChannels; i++)
+				m_DeviceInputs[_half][i] = (char*)m_BufferInfos[i].buffers[_half];
+			for (int i = 0; i < _nOutChannels; i++)
+				m_DeviceOutputs[_half][i] = (char*)m_BufferInfos[i + _nInChannels].buffers[_half];
 		}
+	}
 
-		// usercallback
-		m_AsioApi->m_Callback->Call((void**)_inputs, (void**)_outputs, CallbackInfo{
-			_nInChannels, _nOutChannels, _bufferSize, _sampleRate
-			}, m_AsioApi->m_UserData);
+	ASIOTime* AsioApi::BufferSwitchTimeInfo(ASIOTime* params, long doubleBufferIndex, ASIOBool directProcess)
+	{
+		TraceScope _trace{ "Buffer switch", doubleBufferIndex };
 
-		// Convert the output buffer
-		for (int i = 0; i < _nOutChannels; i++)
+		// The driver stamps the buffer switch on its own clock, move it onto the
+		// host clock with an offset measured at the first switch after starting.
+		double _time = -1;
+		if (params && (params->timeInfo.flags & kSystemTimeValid))
 		{
-			char* _temp = (char*)m_BufferInfos[i + _nInChannels].buffers[doubleBufferIndex];
-			m_AsioApi->ConvertBuffer(_temp, _outputs[i], _bufferSize, _deviceOutFormat, _outFormat);
-			if (_outSwap)
-				m_AsioApi->ByteSwapBuffer(_temp, _bufferSize, _deviceOutFormat);
+			auto& _stamp = params->timeInfo.systemTime;
+#if NATIVE_INT64
+			double _system = _stamp * 1e-9;
+#else
+			double _system = (_stamp.hi * 4294967296. + _stamp.lo) * 1e-9;
+#endif
+			if (!m_AsioApi->m_TimeOffsetValid)
+			{
+				m_AsioApi->m_TimeOffset = HostTime() - _system;
+				m_AsioApi->m_TimeOffsetValid = true;
+			}
+
+			_time = _system + m_AsioApi->m_TimeOffset;
 		}
+
+		// The stream information belongs to the control threads, the size of the buffers was set before ASIOStart
+		m_AsioApi->Process(m_AsioApi->m_DeviceInputs[doubleBufferIndex].data(), 
+			m_AsioApi->m_DeviceOutputs[doubleBufferIndex].data(), m_AsioApi->m_DeviceFrames, _time);
+
 		ASIOOutputReady();
 
 		return params;
@@ -575,6 +609,6 @@ namespace Audijo
 	ASIOCallbacks AsioApi::m_Callbacks = { nullptr, SampleRateDidChange, AsioMessage, BufferSwitchTimeInfo, };
 	ASIOBufferInfo* AsioApi::m_BufferInfos = nullptr;
 	AsioApi* AsioApi::m_AsioApi = nullptr;
-	AsioApi::State AsioApi::m_State = Loaded;
+	AsioApi::DriverState AsioApi::m_DriverState = Loaded;
 }
 #endif
\ No newline at end of file
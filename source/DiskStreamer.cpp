@@ -0,0 +1,358 @@
+#include "Audijo/DiskStreamer.hpp"
+#include <cstdio>
+
+namespace Audijo
+{
+	/**
+	 * 64 bit seek, files we stream are often larger than 2GB.
+	 * @param file file
+	 * @param offset byte offset from the start
+	 * @return true on success
+	 */
+	static bool Seek64(std::FILE* file, uint64_t offset)
+	{
+#ifdef _WIN32
+		return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+		return fseeko(file, offset, SEEK_SET) == 0;
+#endif
+	}
+
+	template<typename T>
+	static T ReadLE(const char* src)
+	{
+		uint64_t _value = 0;
+		for (std::size_t i = 0; i < sizeof(T); i++)
+			_value |= (uint64_t)(uint8_t)src[i] << (8 * i);
+		return (T)_value;
+	}
+
+	/**
+	 * Decode a little endian sample to float.
+	 * @param src sample bytes
+	 * @param bits bits per sample
+	 * @param floating floating point sample
+	 * @return sample
+	 */
+	static float Decode(const char* src, int bits, bool floating)
+	{
+		if (floating)
+		{
+			if (bits == 64)
+			{
+				uint64_t _bits = ReadLE<uint64_t>(src);
+				double _value;
+				std::memcpy(&_value, &_bits, sizeof(double));
+				return (float)_value;
+			}
+
+			uint32_t _bits = ReadLE<uint32_t>(src);
+			float _value;
+			std::memcpy(&_value, &_bits, sizeof(float));
+			return _value;
+		}
+
+		switch (bits)
+		{
+		case 16: return (int16_t)ReadLE<uint16_t>(src) / 32768.f;
+		case 24: return (ReadLE<uint16_t>(src) | (int8_t)src[2] * 65536) / 8388608.f; // Only 3 bytes, the last sample of a block ends the buffer
+		case 32: return (int32_t)ReadLE<uint32_t>(src) / 2147483648.f;
+		default: return 0;
+		}
+	}
+
+	/*
+	 * Block cache
+	 */
+
+	BlockCache::BlockCache(std::size_t capacity)
+		: m_Capacity(std::max<std::size_t>(capacity, 1))
+	{}
+
+	BlockCache::Block BlockCache::Find(uint64_t file, uint64_t offset)
+	{
+		std::lock_guard _lock{ m_Mutex };
+		auto _it = m_Index.find(Key{ file, offset });
+		if (_it == m_Index.end())
+			return nullptr;
+
+		// Move to the front, it's the most recently used now
+		m_Blocks.splice(m_Blocks.begin(), m_Blocks, _it->second);
+		return _it->second->second;
+	}
+
+	void BlockCache::Insert(uint64_t file, uint64_t offset, Block block)
+	{
+		std::lock_guard _lock{ m_Mutex };
+		Key _key{ file, offset };
+		if (m_Index.contains(_key))
+			return;
+
+		if (m_Blocks.size() >= m_Capacity)
+		{
+			m_Index.erase(m_Blocks.back().first);
+			m_Blocks.pop_back();
+		}
+
+		m_Blocks.emplace_front(_key, std::move(block));
+		m_Index[_key] = m_Blocks.begin();
+	}
+
+	/*
+	 * Track
+	 */
+
+	StreamingTrack::StreamingTrack(uint64_t file, int prefetchFrames)
+		: m_FileId(file), m_Capacity(std::max(prefetchFrames, 1))
+	{}
+
+	StreamingTrack::~StreamingTrack()
+	{
+		if (m_File)
+			std::fclose(m_File);
+	}
+
+	bool StreamingTrack::Open(const std::string& path)
+	{
+		m_File = std::fopen(path.c_str(), "rb");
+		if (!m_File)
+		{
+			LOGL("Unable to open " << path);
+			return false;
+		}
+
+		char _header[12];
+		if (std::fread(_header, 1, 12, m_File) != 12 || std::memcmp(_header + 8, "WAVE", 4) != 0
+			|| (std::memcmp(_header, "RIFF", 4) != 0 && std::memcmp(_header, "RF64", 4) != 0))
+		{
+			LOGL(path << " is not a WAV file.");
+			return false;
+		}
+
+		// Walk the chunks until we find the data
+		uint64_t _offset = 12;
+		uint64_t _ds64DataSize = 0;
+		int _formatTag = 0;
+		while (true)
+		{
+			char _chunk[8];
+			if (!Seek64(m_File, _offset) || std::fread(_chunk, 1, 8, m_File) != 8)
+			{
+				LOGL(path << " has no data chunk.");
+				return false;
+			}
+
+			uint64_t _size = ReadLE<uint32_t>(_chunk + 4);
+			if (std::memcmp(_chunk, "ds64", 4) == 0)
+			{
+				char _ds64[16];
+				if (std::fread(_ds64, 1, 16, m_File) == 16)
+					_ds64DataSize = ReadLE<uint64_t>(_ds64 + 8);
+			}
+			else if (std::memcmp(_chunk, "fmt ", 4) == 0)
+			{
+				char _fmt[40]{};
+				std::fread(_fmt, 1, std::min<uint64_t>(_size, 40), m_File);
+				_formatTag = ReadLE<uint16_t>(_fmt);
+				m_Channels = ReadLE<uint16_t>(_fmt + 2);
+				m_SampleRate = ReadLE<uint32_t>(_fmt + 4);
+				m_Bits = ReadLE<uint16_t>(_fmt + 14);
+
+				// Extensible format, the actual format tag is the start of the sub format guid
+				if (_formatTag == 0xFFFE && _size >= 26)
+					_formatTag = ReadLE<uint16_t>(_fmt + 24);
+			}
+			else if (std::memcmp(_chunk, "data", 4) == 0)
+			{
+				m_DataOffset = _offset + 8;
+				if (_size == 0xFFFFFFFF && _ds64DataSize)
+					_size = _ds64DataSize;
+
+				m_Floating = _formatTag == 3;
+				m_FrameBytes = m_Channels * m_Bits / 8;
+				if (m_Channels == 0 || (_formatTag != 1 && _formatTag != 3) || (m_Floating && m_Bits != 32 && m_Bits != 64)
+					|| (!m_Floating && m_Bits != 16 && m_Bits != 24 && m_Bits != 32))
+				{
+					LOGL(path << " has an unsupported sample format.");
+					return false;
+				}
+
+				m_Frames = _size / m_FrameBytes;
+				break;
+			}
+
+			// Chunks are padded to an even size
+			_offset += 8 + _size + (_size & 1);
+		}
+
+		m_Ring.resize(m_Capacity * m_Channels);
+		return true;
+	}
+
+	void StreamingTrack::Seek(uint64_t frame)
+	{
+		m_SeekTarget.store(frame, std::memory_order_relaxed);
+		m_SeekRequest.fetch_add(1, std::memory_order_release);
+	}
+
+	void StreamingTrack::HandleSeek()
+	{
+		uint32_t _request = m_SeekRequest.load(std::memory_order_acquire);
+		if (_request == m_SeekHandled)
+			return;
+
+		m_SeekHandled = _request;
+		uint64_t _target = std::min(m_SeekTarget.load(std::memory_order_relaxed), m_Frames);
+		uint64_t _position = m_ReadPosition.load(std::memory_order_relaxed);
+
+		// Already prefetched, we can simply skip ahead in the ring
+		bool _prefetched = !m_Restart.load(std::memory_order_acquire)
+			&& _target >= _position && _target < m_WritePosition.load(std::memory_order_acquire);
+
+		m_ReadPosition.store(_target, std::memory_order_release);
+		if (!_prefetched)
+			m_Restart.store(_target | RestartFlag, std::memory_order_release);
+	}
+
+	bool StreamingTrack::NeedsFill() const
+	{
+		if (m_Restart.load(std::memory_order_relaxed))
+			return true;
+
+		// Top up once the ring is half empty
+		uint64_t _write = m_WritePosition.load(std::memory_order_relaxed);
+		uint64_t _read = m_ReadPosition.load(std::memory_order_relaxed);
+		return _write < m_Frames && _write - _read < m_Capacity / 2;
+	}
+
+	void StreamingTrack::Fill(BlockCache& cache)
+	{
+		// Restart the prefetch where the reader jumped to
+		uint64_t _restart = m_Restart.load(std::memory_order_acquire);
+		while (_restart)
+		{
+			m_WritePosition.store(_restart & ~RestartFlag, std::memory_order_relaxed);
+			if (m_Restart.compare_exchange_strong(_restart, 0, std::memory_order_release))
+				break;
+		}
+
+		uint64_t _write = m_WritePosition.load(std::memory_order_relaxed);
+		uint64_t _end = std::min(m_ReadPosition.load(std::memory_order_acquire) + m_Capacity, m_Frames);
+		while (_write < _end && !m_Restart.load(std::memory_order_relaxed))
+		{
+			// Get the block containing the write position, from the cache if possible
+			uint64_t _blockOffset = m_DataOffset + (_write / BlockFrames) * BlockFrames * m_FrameBytes;
+			auto _block = cache.Find(m_FileId, _blockOffset);
+			if (_block)
+				m_CacheHits.fetch_add(1, std::memory_order_relaxed);
+			else
+			{
+				m_CacheMisses.fetch_add(1, std::memory_order_relaxed);
+				auto _data = std::make_shared<std::vector<char>>((std::size_t)BlockFrames * m_FrameBytes);
+				if (!Seek64(m_File, _blockOffset))
+					return;
+
+				_data->resize(std::fread(_data->data(), 1, _data->size(), m_File));
+				_block = _data;
+				cache.Insert(m_FileId, _blockOffset, _block);
+			}
+
+			// Decode the frames we need from this block into the ring
+			uint64_t _first = _write % BlockFrames;
+			uint64_t _count = std::min<uint64_t>(std::min<uint64_t>(BlockFrames - _first, _end - _write),
+				_block->size() / m_FrameBytes - std::min<uint64_t>(_first, _block->size() / m_FrameBytes));
+			if (_count == 0)
+				return; // File is shorter than its header claims
+
+			const char* _src = _block->data() + _first * m_FrameBytes;
+			for (uint64_t i = 0; i < _count; i++)
+			{
+				float* _frame = &m_Ring[((_write + i) % m_Capacity) * m_Channels];
+				for (int j = 0; j < m_Channels; j++, _src += m_Bits / 8)
+					_frame[j] = Decode(_src, m_Bits, m_Floating);
+			}
+
+			_write += _count;
+			m_WritePosition.store(_write, std::memory_order_release);
+		}
+	}
+
+	TrackStatistics StreamingTrack::Statistics() const
+	{
+		return TrackStatistics{ m_Underruns, m_UnderrunFrames, m_CacheHits, m_CacheMisses };
+	}
+
+	/*
+	 * Streamer
+	 */
+
+	DiskStreamer::DiskStreamer(int ioThreads, std::size_t cacheBlocks, int prefetchFrames)
+		: m_PrefetchFrames(prefetchFrames), m_Cache(cacheBlocks), m_Pool(ioThreads)
+	{
+		m_Dispatcher = std::thread{ [this]() { Dispatch(); } };
+	}
+
+	DiskStreamer::~DiskStreamer()
+	{
+		m_Running = false;
+		m_Dispatcher.join();
+	}
+
+	StreamingTrack* DiskStreamer::Add(const std::string& path)
+	{
+		std::lock_guard _lock{ m_Mutex };
+		auto _file = m_Files.try_emplace(path, m_Files.size()).first->second;
+		std::unique_ptr<StreamingTrack> _track{ new StreamingTrack{ _file, m_PrefetchFrames } };
+		if (!_track->Open(path))
+			return nullptr;
+
+		return m_Tracks.emplace_back(std::move(_track)).get();
+	}
+
+	void DiskStreamer::Remove(StreamingTrack* track)
+	{
+		std::unique_ptr<StreamingTrack> _track;
+		{
+			std::lock_guard _lock{ m_Mutex };
+			auto _it = std::find_if(m_Tracks.begin(), m_Tracks.end(), [&](auto& t) { return t.get() == track; });
+			if (_it == m_Tracks.end())
+				return;
+
+			_track = std::move(*_it);
+			m_Tracks.erase(_it);
+		}
+
+		// An I/O thread might still be filling it
+		while (_track->m_Scheduled.load())
+			std::this_thread::yield();
+	}
+
+	std::size_t DiskStreamer::Tracks() const
+	{
+		std::lock_guard _lock{ m_Mutex };
+		return m_Tracks.size();
+	}
+
+	void DiskStreamer::Dispatch()
+	{
+		while (m_Running)
+		{
+			// Queue a fill for every track that is running low, one at a time per track
+			// so each track's file is only ever used by a single I/O thread.
+			{
+				std::lock_guard _lock{ m_Mutex };
+				for (auto& _track : m_Tracks)
+					if (!_track->m_Scheduled.load() && _track->NeedsFill())
+					{
+						_track->m_Scheduled = true;
+						m_Pool.Submit([this, _track = _track.get()]() {
+							_track->Fill(m_Cache);
+							_track->m_Scheduled = false;
+						});
+					}
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}
+}
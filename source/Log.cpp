@@ -0,0 +1,130 @@
+#include "Audijo/Log.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Everything shared by the logging threads and the background thread.
+	 */
+	struct LogState
+	{
+		MessageQueue<LogRecord> records{ Logger::Capacity };
+		std::atomic<uint64_t> dropped = 0;
+
+		std::mutex mutex; // Guards the sink and the thread
+		std::function<void(LogLevel, const std::string&)> sink = [](LogLevel, const std::string& message) {
+			std::cout << message << std::endl;
+		};
+
+		std::thread thread;
+		std::condition_variable wake;
+		bool running = false;
+
+		~LogState()
+		{
+			{
+				std::lock_guard _lock{ mutex };
+				running = false;
+			}
+
+			wake.notify_one();
+			if (thread.joinable())
+				thread.join();
+		}
+	};
+
+	static LogState& State()
+	{
+		static LogState _state;
+		return _state;
+	}
+
+	/**
+	 * Write every record that's waiting to the sink, called with the mutex locked.
+	 */
+	static void Drain(LogState& state)
+	{
+		LogRecord _record;
+		while (state.records.Pop(_record))
+			state.sink(_record.level, Logger::Format(_record));
+
+		if (uint64_t _dropped = state.dropped.exchange(0, std::memory_order_relaxed))
+			state.sink(LogWarning, std::to_string(_dropped) + " log records were dropped.");
+	}
+
+	void Logger::Start()
+	{
+		auto& _state = State();
+		std::lock_guard _lock{ _state.mutex };
+		if (_state.running)
+			return;
+
+		_state.running = true;
+		_state.thread = std::thread{ [&_state]() {
+			std::unique_lock _lock{ _state.mutex };
+			while (_state.running)
+			{
+				_state.wake.wait_for(_lock, std::chrono::milliseconds(10));
+				Drain(_state);
+			}
+			Drain(_state);
+		} };
+	}
+
+	void Logger::Sink(std::function<void(LogLevel, const std::string&)> sink)
+	{
+		auto& _state = State();
+		std::lock_guard _lock{ _state.mutex };
+		_state.sink = std::move(sink);
+	}
+
+	void Logger::Write(LogLevel level, const std::string& message)
+	{
+		auto& _state = State();
+		std::lock_guard _lock{ _state.mutex };
+		Drain(_state);
+		_state.sink(level, message);
+	}
+
+	void Logger::Flush()
+	{
+		auto& _state = State();
+		std::lock_guard _lock{ _state.mutex };
+		Drain(_state);
+	}
+
+	void Logger::Push(const LogRecord& record)
+	{
+		auto& _state = State();
+		if (!_state.records.Push(record))
+			_state.dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	std::string Logger::Format(const LogRecord& record)
+	{
+		std::string _message;
+		int _next = 0;
+		for (const char* _c = record.format; *_c; _c++)
+		{
+			bool _hex = std::strncmp(_c, "{x}", 3) == 0;
+			if ((std::strncmp(_c, "{}", 2) != 0 && !_hex) || _next >= record.count)
+			{
+				_message += *_c;
+				continue;
+			}
+
+			auto& _argument = record.arguments[_next++];
+			char _buffer[32];
+			switch (_argument.type)
+			{
+			case LogArgument::Integer:  std::snprintf(_buffer, sizeof(_buffer), _hex ? "0x%llx" : "%lld", (long long)_argument.integer); break;
+			case LogArgument::Unsigned: std::snprintf(_buffer, sizeof(_buffer), _hex ? "0x%llx" : "%llu", (unsigned long long)_argument.natural); break;
+			case LogArgument::Floating: std::snprintf(_buffer, sizeof(_buffer), "%g", _argument.floating); break;
+			case LogArgument::String:   _buffer[0] = '\0'; _message += _argument.string ? _argument.string : "(null)"; break;
+			}
+
+			_message += _buffer;
+			_c += _hex ? 2 : 1;
+		}
+		return _message;
+	}
+}
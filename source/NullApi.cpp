@@ -0,0 +1,339 @@
+#ifdef AUDIJO_NULL
+#include "Audijo/NullApi.hpp"
+
+namespace Audijo
+{
+	NullApi::NullApi(bool)
+		: ApiBase()
+	{
+		// The built-in devices are always there, they get the ids of their DeviceId, so there is nothing to load
+		std::vector<double> _sampleRates{ std::begin(m_SampleRates), std::end(m_SampleRates) };
+		m_Registry.Set("Null", DeviceInfo<Null>{ DeviceInfo<>{ DuplexDevice, "Null", Channels, Channels, _sampleRates, true, Null } });
+		m_Registry.Set("Null Input", DeviceInfo<Null>{ DeviceInfo<>{ InputDevice, "Null Input", Channels, 0, _sampleRates, false, Null } });
+		m_Registry.Set("Null Output", DeviceInfo<Null>{ DeviceInfo<>{ OutputDevice, "Null Output", 0, Channels, _sampleRates, false, Null } });
+		Devices(true);
+	}
+
+	NullApi::~NullApi()
+	{
+		StopExecutor();
+		StopNotifications();
+		Close();
+	}
+
+	const std::vector<DeviceInfo<Null>>& NullApi::Devices(bool reload)
+	{
+		// Nothing to probe, plugged devices are in the registry right away
+		if (reload)
+			m_Devices = m_Registry.Read();
+
+		return m_Devices->devices;
+	}
+
+	Error NullApi::Open(const StreamParameters& settings)
+	{
+		if (State() != Closed)
+			return AlreadyOpen;
+
+		m_Information = settings;
+
+		// The duplex device is the default device
+		if (m_Information.input == Default)
+			m_Information.input = DuplexDevice;
+		if (m_Information.output == Default)
+			m_Information.output = DuplexDevice;
+
+		if (m_Information.input == NoDevice && m_Information.output == NoDevice)
+			return NotPresent;
+
+		// Wait for the capabilities of devices that are still being probed
+		auto _devices = m_Registry.Read();
+		for (int _id : { m_Information.input, m_Information.output })
+			if (auto _device = _devices->Find(_id); _device && !_device->probed)
+			{
+				m_Prober.Finished().wait();
+				_devices = m_Registry.Read();
+				break;
+			}
+
+		auto _inDevice = m_Information.input == NoDevice ? nullptr : _devices->Find(m_Information.input);
+		auto _outDevice = m_Information.output == NoDevice ? nullptr : _devices->Find(m_Information.output);
+		if ((m_Information.input != NoDevice && (!_inDevice || _inDevice->inputChannels == 0))
+			|| (m_Information.output != NoDevice && (!_outDevice || _outDevice->outputChannels == 0)))
+			return NotPresent;
+
+		if (m_Information.bufferSize == Default)
+			m_Information.bufferSize = 512;
+		else if (m_Information.bufferSize <= 0)
+			return InvalidBufferSize;
+
+		if (m_Information.sampleRate == (double)Default)
+			m_Information.sampleRate = 48000;
+		else if (m_Information.sampleRate <= 0)
+			return InvalidSampleRate;
+
+		// If callback has been set, deduce format type
+		if (m_Callback)
+		{
+			m_Information.inFormat = (SampleFormat)m_Callback->InFormat();
+			m_Information.outFormat = (SampleFormat)m_Callback->OutFormat();
+		}
+		else
+		{
+			LOGL("Failed to deduce sample format, no callback was set.");
+			return NoCallback;
+		}
+
+		m_Information.inputChannels = _inDevice ? _inDevice->inputChannels : 0;
+		m_Information.outputChannels = _outDevice ? _outDevice->outputChannels : 0;
+		m_Information.deviceInFormat = Float32;
+		m_Information.deviceOutFormat = Float32;
+
+		AllocateBuffers();
+		AllocateDeviceBuffers();
+
+		State(Opened);
+		return NoError;
+	}
+
+	Error NullApi::Start()
+	{
+		if (auto _error = BeginStart())
+			return _error;
+
+		// Input and output on their own clocks, the capture thread feeds the audio thread through the bridge
+		m_Bridge.reset();
+		int _input = m_Information.input;
+		int _output = m_Information.output;
+		if (_input != NoDevice && _output != NoDevice && _input != _output)
+		{
+			int _bufferSize = m_Information.bufferSize;
+			m_Bridge = std::make_unique<DuplexBridge>(m_Information.inputChannels, 3 * _bufferSize, _bufferSize, m_Information.sampleRate);
+			m_CaptureThread = std::thread{ [this]() { Capture(); } };
+		}
+
+		// Only running once the thread exists, so a Stop always has a thread to join
+		m_ThreadConfigured = false;
+		m_Simulated = -1;
+		m_AudioThread = std::thread{ [this]() { Run(); } };
+		Transition(Starting, Running);
+		return NoError;
+	}
+
+	Error NullApi::Stop()
+	{
+		if (auto _error = BeginStop())
+			return _error;
+
+		m_Wake.Notify();
+		m_AudioThread.join();
+
+		if (m_CaptureThread.joinable())
+		{
+			m_CaptureWake.Notify();
+			m_CaptureThread.join();
+		}
+
+		Transition(Stopping, Opened);
+		return NoError;
+	}
+
+	Error NullApi::Close()
+	{
+		if (State() == Running)
+			Stop();
+
+		if (State() == Closed)
+			return NotOpen;
+
+		StopRecording();
+		FreeBuffers();
+		m_Bridge.reset();
+
+		// Reset information
+		m_Information = StreamInformation{};
+		State(Closed);
+		return NoError;
+	}
+
+	Error NullApi::SampleRate(double srate)
+	{
+		if (State() == Closed)
+			return NotOpen;
+
+		// The bridge was set up for the rate the devices started at
+		if (State() != Opened && m_Bridge)
+			return AlreadyRunning;
+
+		if (srate <= 0)
+			return InvalidSampleRate;
+
+		// Takes effect at the next period
+		PublishPeriod(m_Information.bufferSize, srate);
+		m_Information.parameters.sampleRate = srate;
+		return NoError;
+	}
+
+	Error NullApi::BufferSize(std::size_t size)
+	{
+		if (State() == Closed)
+			return NotOpen;
+
+		if (State() != Opened && m_Bridge)
+			return AlreadyRunning;
+
+		if (size == 0)
+			return InvalidBufferSize;
+
+		// Growing past the allocated buffers is only possible while stopped
+		if (size > (std::size_t)m_MaxFrames)
+		{
+			if (State() != Opened)
+				return InvalidBufferSize;
+
+			m_Information.bufferSize = size;
+			FreeBuffers();
+			AllocateBuffers();
+			AllocateDeviceBuffers();
+		}
+
+		// Takes effect at the next period
+		PublishPeriod(size, m_Information.sampleRate);
+		m_Information.parameters.bufferSize = size;
+		return NoError;
+	}
+
+	Error NullApi::ClockSkew(int id, double ppm)
+	{
+		if (id < 0 || id >= DeviceAmount)
+			return NotPresent;
+
+		m_Skew[id].store(ppm, std::memory_order_relaxed);
+		return NoError;
+	}
+
+	Error NullApi::Simulate(NotificationType type, double value)
+	{
+		if (State() != Running)
+			return NotRunning;
+
+		m_SimulatedValue.store(value, std::memory_order_relaxed);
+		m_Simulated.store(type, std::memory_order_release);
+		return NoError;
+	}
+
+	int NullApi::Plug(const std::string& name, int inputs, int outputs)
+	{
+		if (auto _device = m_Registry.Read()->FindKey(name); _device && _device->id < DeviceAmount)
+			return NoDevice;
+
+		std::vector<double> _sampleRates{ std::begin(m_SampleRates), std::end(m_SampleRates) };
+		double _delay = m_ProbeDelay;
+		if (_delay <= 0)
+			return m_Registry.Set(name, DeviceInfo<Null>{ DeviceInfo<>{ NoDevice, name, inputs, outputs, _sampleRates, false, Null } });
+
+		// Listed right away, the capabilities are only known once the probe is done
+		int _id = m_Registry.Set(name, DeviceInfo<Null>{ DeviceInfo<>{ NoDevice, name, 0, 0, {}, false, Null, false } });
+		m_Prober.Submit(name, [=](DeviceInfo<Null>& device) {
+			std::this_thread::sleep_for(std::chrono::duration<double>{ _delay });
+			device.inputChannels = inputs;
+			device.outputChannels = outputs;
+			device.sampleRates = _sampleRates;
+			return true;
+		});
+		return _id;
+	}
+
+	Error NullApi::Unplug(int id)
+	{
+		if (!m_Registry.Remove(id))
+			return NotPresent;
+
+		// Like a device that disappears, the stream stops processing
+		if (State() == Running && (id == m_Information.input || id == m_Information.output))
+			Simulate(DeviceLost, id);
+
+		return NoError;
+	}
+
+	std::chrono::steady_clock::duration NullApi::Period(int id, int frames, double sampleRate) const
+	{
+		double _rate = sampleRate * (1 + (id >= 0 && id < DeviceAmount ? m_Skew[id].load(std::memory_order_relaxed) : 0) * 1e-6);
+		return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>{ frames / _rate });
+	}
+
+	void NullApi::AllocateDeviceBuffers()
+	{
+		int _nInChannels = m_Information.inputChannels;
+		int _nOutChannels = m_Information.outputChannels;
+		std::size_t _stride = m_MaxFrames * sizeof(float);
+
+		// Input stays silent, output is discarded
+		m_DeviceMemory.assign(_stride * (_nInChannels + _nOutChannels), 0);
+		m_DeviceInputs.resize(_nInChannels);
+		m_DeviceOutputs.resize(_nOutChannels);
+		for (int i = 0; i < _nInChannels; i++)
+			m_DeviceInputs[i] = m_DeviceMemory.data() + i * _stride;
+		for (int i = 0; i < _nOutChannels; i++)
+			m_DeviceOutputs[i] = m_DeviceMemory.data() + (_nInChannels + i) * _stride;
+
+		// Silent input of the input device when it runs on its own clock
+		m_CaptureMemory.assign(m_Information.bufferSize, 0);
+		m_CaptureInputs.assign(_nInChannels, m_CaptureMemory.data());
+	}
+
+	void NullApi::Run()
+	{
+		ApplyThreadConfiguration();
+
+		// Periods follow the clock of the output device, if there is one
+		int _device = m_Information.output != NoDevice ? m_Information.output : m_Information.input;
+		auto _next = std::chrono::steady_clock::now();
+
+		while (State() != Stopping)
+		{
+			// A new buffer size or sample rate applies from this period on
+			UpdatePeriod();
+			int _frames = m_BufferSize;
+
+			if (m_Bridge && !m_Bridge->Read((float**)m_DeviceInputs.data(), _frames))
+				ReportXrun(InputUnderrun, _frames);
+
+			if (int _type = m_Simulated.exchange(-1, std::memory_order_acquire); _type != -1)
+			{
+				Notify((NotificationType)_type, m_SimulatedValue.load(std::memory_order_relaxed));
+				if (_type == DeviceLost || _type == StreamFailed)
+					break;
+			}
+
+			Process(m_DeviceInputs.data(), m_DeviceOutputs.data(), _frames);
+
+			// Pace the periods like a device would, Stop wakes us up right away
+			_next += Period(_device, _frames, m_SampleRate);
+			TraceBegin("Wait");
+			m_Wake.WaitUntil(_next);
+			TraceEnd();
+		}
+	}
+
+	void NullApi::Capture()
+	{
+		TraceThread("Capture");
+		auto _period = Period(m_Information.input, m_Information.bufferSize, m_Information.sampleRate);
+		auto _next = std::chrono::steady_clock::now();
+
+		while (State() != Stopping)
+		{
+			// Input that didn't fit in the bridge is lost
+			auto _overruns = m_Bridge->Overruns();
+			m_Bridge->Write(m_CaptureInputs.data(), m_Information.bufferSize);
+			if (m_Bridge->Overruns() != _overruns)
+				ReportXrun(InputOverrun);
+
+			_next += _period;
+			m_CaptureWake.WaitUntil(_next);
+		}
+	}
+}
+#endif
@@ -0,0 +1,720 @@
+#ifdef AUDIJO_PIPEWIRE
+#include "Audijo/PipeWireApi.hpp"
+#include <cstring>
+
+namespace Audijo
+{
+#define CHECK(x, msg, type) if ((x) < 0) { LOGL(msg); type; }
+
+	/**
+	 * Planar spa format equivalent to a sample format, planar formats hand us a
+	 * separate buffer per channel, exactly like the callback buffers.
+	 * @param format sample format
+	 * @return spa audio format
+	 */
+	static spa_audio_format ToSpaFormat(SampleFormat format)
+	{
+		switch (format)
+		{
+		case Int8: return SPA_AUDIO_FORMAT_S8P;
+		case Int16: return SPA_AUDIO_FORMAT_S16P;
+		case Int32: return SPA_AUDIO_FORMAT_S32P;
+		case Float64: return SPA_AUDIO_FORMAT_F64P;
+		default: return SPA_AUDIO_FORMAT_F32P;
+		}
+	}
+
+	/**
+	 * Sample format equivalent to a negotiated spa format.
+	 * @param format spa audio format
+	 * @return sample format, or None if not supported
+	 */
+	static SampleFormat FromSpaFormat(uint32_t format)
+	{
+		switch (format)
+		{
+		case SPA_AUDIO_FORMAT_S8P: return Int8;
+		case SPA_AUDIO_FORMAT_S16P: return Int16;
+		case SPA_AUDIO_FORMAT_S32P: return Int32;
+		case SPA_AUDIO_FORMAT_F32P: return Float32;
+		case SPA_AUDIO_FORMAT_F64P: return Float64;
+		default: return None;
+		}
+	}
+
+	/**
+	 * Node information collected from the registry during device enumeration.
+	 */
+	struct PipeWireNode
+	{
+		uint32_t id;
+		std::string nodeName;
+		std::string name;
+		int inputChannels;
+		int outputChannels;
+		double sampleRate;
+		int priority;
+	};
+
+	struct PipeWireEnumeration
+	{
+		pw_thread_loop* loop;
+		std::vector<PipeWireNode> nodes;
+		int seq = 0;
+		bool done = false;
+	};
+
+	static void RegistryGlobal(void* data, uint32_t id, uint32_t permissions, const char* type, uint32_t version, const spa_dict* props)
+	{
+		auto _enumeration = (PipeWireEnumeration*)data;
+		if (props == nullptr || std::strcmp(type, PW_TYPE_INTERFACE_Node) != 0)
+			return;
+
+		// Only audio sinks and sources are devices
+		const char* _class = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
+		if (_class == nullptr)
+			return;
+
+		bool _sink = std::strncmp(_class, "Audio/Sink", 10) == 0;
+		bool _source = std::strncmp(_class, "Audio/Source", 12) == 0;
+		bool _duplex = std::strncmp(_class, "Audio/Duplex", 12) == 0;
+		if (!_sink && !_source && !_duplex)
+			return;
+
+		const char* _nodeName = spa_dict_lookup(props, PW_KEY_NODE_NAME);
+		const char* _description = spa_dict_lookup(props, PW_KEY_NODE_DESCRIPTION);
+		const char* _channels = spa_dict_lookup(props, "audio.channels");
+		const char* _rate = spa_dict_lookup(props, "audio.rate");
+		const char* _priority = spa_dict_lookup(props, PW_KEY_PRIORITY_SESSION);
+		if (_nodeName == nullptr)
+			return;
+
+		// Nodes that don't report their layout are most likely stereo
+		int _nChannels = _channels ? std::atoi(_channels) : 2;
+		_enumeration->nodes.push_back(PipeWireNode{
+			id, _nodeName, _description ? _description : _nodeName,
+			_source || _duplex ? _nChannels : 0,
+			_sink || _duplex ? _nChannels : 0,
+			_rate ? std::atof(_rate) : 48000.,
+			_priority ? std::atoi(_priority) : 0 });
+	}
+
+	static void CoreDone(void* data, uint32_t id, int seq)
+	{
+		auto _enumeration = (PipeWireEnumeration*)data;
+		if (id == PW_ID_CORE && seq == _enumeration->seq)
+		{
+			_enumeration->done = true;
+			pw_thread_loop_signal(_enumeration->loop, false);
+		}
+	}
+
+	static const pw_registry_events RegistryEvents{ .version = PW_VERSION_REGISTRY_EVENTS, .global = RegistryGlobal };
+	static const pw_core_events CoreEvents{ .version = PW_VERSION_CORE_EVENTS, .done = CoreDone };
+
+	PipeWireApi::PipeWireApi(bool loadDevices)
+		: ApiBase()
+	{
+		pw_init(nullptr, nullptr);
+
+		// The graph decides the quantum, the stream follows it
+		m_FollowsDevicePeriod = true;
+
+		// Run the PipeWire main loop on its own thread, the realtime processing
+		// happens on PipeWire's data thread.
+		m_Loop = pw_thread_loop_new("Audijo", nullptr);
+		m_Context = pw_context_new(pw_thread_loop_get_loop(m_Loop), nullptr, 0);
+		CHECK(pw_thread_loop_start(m_Loop), "Unable to start the PipeWire loop.", return);
+
+		pw_thread_loop_lock(m_Loop);
+		m_Core = pw_context_connect(m_Context, nullptr, 0);
+		pw_thread_loop_unlock(m_Loop);
+
+		if (!m_Core)
+		{
+			LOGL("Unable to connect to the PipeWire daemon.");
+			return;
+		}
+
+		if (loadDevices) {
+			// Load devices once at the start
+			Devices(true);
+		}
+	}
+
+	PipeWireApi::~PipeWireApi()
+	{
+		StopExecutor();
+		StopNotifications();
+		Close();
+
+		if (m_Core)
+		{
+			pw_thread_loop_lock(m_Loop);
+			pw_core_disconnect(m_Core);
+			pw_thread_loop_unlock(m_Loop);
+		}
+
+		pw_thread_loop_stop(m_Loop);
+		pw_context_destroy(m_Context);
+		pw_thread_loop_destroy(m_Loop);
+		pw_deinit();
+	}
+
+	const std::vector<DeviceInfo<PipeWire>>& PipeWireApi::Devices(bool reload)
+	{
+		if (!reload || !m_Core)
+			return m_Devices->devices;
+
+		// Collect all nodes from the registry, the sync makes sure
+		// all globals have been announced before we continue.
+		PipeWireEnumeration _enumeration{ m_Loop };
+		spa_hook _registryListener{};
+		spa_hook _coreListener{};
+
+		pw_thread_loop_lock(m_Loop);
+		pw_registry* _registry = pw_core_get_registry(m_Core, PW_VERSION_REGISTRY, 0);
+		pw_registry_add_listener(_registry, &_registryListener, &RegistryEvents, &_enumeration);
+		pw_core_add_listener(m_Core, &_coreListener, &CoreEvents, &_enumeration);
+		_enumeration.seq = pw_core_sync(m_Core, PW_ID_CORE, 0);
+		while (!_enumeration.done)
+			pw_thread_loop_wait(m_Loop);
+		spa_hook_remove(&_coreListener);
+		spa_hook_remove(&_registryListener);
+		pw_proxy_destroy((pw_proxy*)_registry);
+		pw_thread_loop_unlock(m_Loop);
+
+		// The default device is the one the session manager prioritizes
+		int _defaultIn = -1, _defaultOut = -1;
+		for (int i = 0; i < (int)_enumeration.nodes.size(); i++)
+		{
+			auto& _node = _enumeration.nodes[i];
+			if (_node.inputChannels > 0 && (_defaultIn == -1 || _node.priority > _enumeration.nodes[_defaultIn].priority))
+				_defaultIn = i;
+			if (_node.outputChannels > 0 && (_defaultOut == -1 || _node.priority > _enumeration.nodes[_defaultOut].priority))
+				_defaultOut = i;
+		}
+
+		std::vector<std::pair<std::string, DeviceInfo<PipeWire>>> _devices;
+		for (int i = 0; i < (int)_enumeration.nodes.size(); i++)
+		{
+			auto& _node = _enumeration.nodes[i];
+			bool _default = i == _defaultIn || i == _defaultOut;
+
+			// PipeWire resamples to the graph rate, so list the node rate first
+			std::vector<double> _srates{ _node.sampleRate };
+			for (auto& _srate : m_SampleRates)
+				if (_srate != _node.sampleRate)
+					_srates.push_back(_srate);
+
+			DeviceInfo<PipeWire> _device{ { NoDevice, _node.name, _node.inputChannels, _node.outputChannels, _srates, _default, PipeWire } };
+			_device.nodeName = _node.nodeName;
+			_device.node = _node.id;
+			_devices.emplace_back(_node.nodeName, std::move(_device));
+		}
+
+		// Node ids change when a device comes back, the node name doesn't, so it keeps its device id
+		m_Registry.Update(std::move(_devices));
+		m_Devices = m_Registry.Read();
+		return m_Devices->devices;
+	}
+
+	StreamInformation PipeWireApi::Information() const
+	{
+		// The loop thread keeps the negotiated formats up to date
+		StreamInformation _information = ApiBase::Information();
+		if (_information.state != Closed)
+		{
+			_information.deviceInFormat = m_DeviceInFormat.load(std::memory_order_relaxed);
+			_information.deviceOutFormat = m_DeviceOutFormat.load(std::memory_order_relaxed);
+		}
+		return _information;
+	}
+
+	Error PipeWireApi::Open(const StreamParameters& settings)
+	{
+		if (State() != Closed)
+			return AlreadyOpen;
+
+		if (!m_Core)
+			return Fail;
+
+		m_Information = settings;
+
+		// Check device ids
+		if (m_Information.input == Default)
+			for (auto& i : m_Devices->devices)
+				if (i.defaultDevice && i.inputChannels > 0)
+					m_Information.input = i.id;
+		if (m_Information.output == Default)
+			for (auto& i : m_Devices->devices)
+				if (i.defaultDevice && i.outputChannels > 0)
+					m_Information.output = i.id;
+
+		auto _inDevice = m_Information.input == NoDevice ? nullptr : DeviceById(m_Information.input);
+		auto _outDevice = m_Information.output == NoDevice ? nullptr : DeviceById(m_Information.output);
+		if ((m_Information.input != NoDevice && _inDevice == nullptr) || (m_Information.output != NoDevice && _outDevice == nullptr))
+			return NotPresent;
+
+		// Set channel count
+		m_Information.inputChannels = _inDevice ? _inDevice->inputChannels : 0;
+		m_Information.outputChannels = _outDevice ? _outDevice->outputChannels : 0;
+
+		// The graph decides the quantum, the first period will report the actual size
+		if (m_Information.bufferSize == Default)
+			m_Information.bufferSize = 1024;
+
+		if (m_Information.bufferSize <= 0 || m_Information.bufferSize > MaxQuantum)
+			return InvalidBufferSize;
+
+		// If no samplerate, use the rate of the device
+		auto& _device = _outDevice ? *_outDevice : *_inDevice;
+		if (m_Information.sampleRate == (double)Default)
+			m_Information.sampleRate = _device.sampleRates[0];
+
+		// Any other rate has to be resampled by PipeWire
+		else if (m_Information.sampleRate != _device.sampleRates[0] && !m_Information.resampling)
+		{
+			LOGL("Invalid sample rate selected");
+			return InvalidSampleRate;
+		}
+
+		// If callback has been set, deduce format type
+		if (m_Callback)
+		{
+			m_Information.inFormat = (SampleFormat)m_Callback->InFormat();
+			m_Information.outFormat = (SampleFormat)m_Callback->OutFormat();
+		}
+		else
+		{
+			LOGL("Failed to deduce sample format, no callback was set.");
+			return NoCallback;
+		}
+
+		// We negotiate the planar version of the callback format, so PipeWire converts
+		// in its own graph and the callback runs directly on the stream buffers.
+		m_Information.deviceInFormat = m_Information.inFormat;
+		m_Information.deviceOutFormat = m_Information.outFormat;
+		m_DeviceInFormat.store(m_Information.inFormat, std::memory_order_relaxed);
+		m_DeviceOutFormat.store(m_Information.outFormat, std::memory_order_relaxed);
+
+		// Allocate the user callback buffers
+		AllocateBuffers(MaxQuantum);
+		m_DeviceInputs.assign(m_Information.inputChannels, nullptr);
+		m_DeviceOutputs.assign(m_Information.outputChannels, nullptr);
+		m_CapturedFrames = 0;
+		m_Quantum = m_Information.bufferSize;
+		m_PlaybackPosition = nullptr;
+		m_CaptureBuffers.clear();
+		if (_inDevice && _outDevice)
+			for (int i = 0; i < m_Information.inputChannels; i++)
+				m_CaptureBuffers.emplace_back(MaxQuantum * (m_Information.deviceInFormat & Bytes));
+
+		pw_thread_loop_lock(m_Loop);
+		if (_inDevice)
+			m_CaptureStream = CreateStream(true, *_inDevice);
+		if (_outDevice)
+			m_PlaybackStream = CreateStream(false, *_outDevice);
+		pw_thread_loop_unlock(m_Loop);
+
+		if ((_inDevice && !m_CaptureStream) || (_outDevice && !m_PlaybackStream))
+		{
+			Close();
+			return Fail;
+		}
+
+		State(Opened);
+		return NoError;
+	}
+
+	Error PipeWireApi::Start()
+	{
+		if (auto _error = BeginStart())
+			return _error;
+
+		// The data thread is PipeWire's, it is configured at the first period
+		m_ThreadConfigured = false;
+
+		pw_thread_loop_lock(m_Loop);
+		if (m_CaptureStream)
+			pw_stream_set_active(m_CaptureStream, true);
+		if (m_PlaybackStream)
+			pw_stream_set_active(m_PlaybackStream, true);
+		pw_thread_loop_unlock(m_Loop);
+
+		Transition(Starting, Running);
+		return NoError;
+	}
+
+	Error PipeWireApi::Stop()
+	{
+		if (auto _error = BeginStop())
+			return _error;
+
+		pw_thread_loop_lock(m_Loop);
+		if (m_CaptureStream)
+			pw_stream_set_active(m_CaptureStream, false);
+		if (m_PlaybackStream)
+			pw_stream_set_active(m_PlaybackStream, false);
+		pw_thread_loop_unlock(m_Loop);
+
+		// The data thread isn't ours, make sure it left the last period
+		Quiesce();
+
+		Transition(Stopping, Opened);
+		return NoError;
+	}
+
+	Error PipeWireApi::Close()
+	{
+		if (State() == Running)
+			Stop();
+
+		StopRecording();
+
+		// Destroying the streams also disconnects them from the graph
+		pw_thread_loop_lock(m_Loop);
+		if (m_CaptureStream)
+			pw_stream_destroy(m_CaptureStream);
+		if (m_PlaybackStream)
+			pw_stream_destroy(m_PlaybackStream);
+		m_CaptureStream = nullptr;
+		m_PlaybackStream = nullptr;
+		pw_thread_loop_unlock(m_Loop);
+
+		// Also cleans up after an Open that failed halfway
+		bool _wasOpen = State() != Closed;
+		FreeBuffers();
+
+		// Reset information
+		m_Information = StreamInformation{};
+		State(Closed);
+		return _wasOpen ? NoError : NotOpen;
+	}
+
+	Error PipeWireApi::SampleRate(double)
+	{
+		if (State() == Closed)
+			return NotOpen;
+
+		// The rate is part of the negotiated format
+		return Fail;
+	}
+
+	Error PipeWireApi::BufferSize(std::size_t size)
+	{
+		if (State() == Closed)
+			return NotOpen;
+
+		if (size == 0 || size > MaxQuantum)
+			return InvalidBufferSize;
+
+		// Request a new quantum from the graph, the process callback
+		// reports the new size once the graph has switched.
+		char _latency[32];
+		std::snprintf(_latency, sizeof(_latency), "%zu/%d", size, (int)m_Information.sampleRate);
+		spa_dict_item _items[]{ { PW_KEY_NODE_LATENCY, _latency } };
+		spa_dict _dict{};
+		_dict.n_items = 1;
+		_dict.items = _items;
+
+		pw_thread_loop_lock(m_Loop);
+		if (m_CaptureStream)
+			pw_stream_update_properties(m_CaptureStream, &_dict);
+		if (m_PlaybackStream)
+			pw_stream_update_properties(m_PlaybackStream, &_dict);
+		pw_thread_loop_unlock(m_Loop);
+
+		// The graph already runs at this size, the data thread posted the change
+		if ((int)size == m_Quantum.load(std::memory_order_relaxed))
+			PublishPeriod(size, m_Information.sampleRate);
+		return NoError;
+	}
+
+	const DeviceInfo<PipeWire>* PipeWireApi::DeviceById(int id) const
+	{
+		return m_Devices->Find(id);
+	}
+
+	pw_stream* PipeWireApi::CreateStream(bool input, const DeviceInfo<PipeWire>& device)
+	{
+		int _sampleRate = m_Information.sampleRate;
+		pw_properties* _props = pw_properties_new(
+			PW_KEY_MEDIA_TYPE, "Audio",
+			PW_KEY_MEDIA_CATEGORY, input ? "Capture" : "Playback",
+			PW_KEY_MEDIA_ROLE, "Production",
+			PW_KEY_TARGET_OBJECT, device.nodeName.c_str(),
+			nullptr);
+
+		// Ask the graph to run at our quantum and rate
+		pw_properties_setf(_props, PW_KEY_NODE_LATENCY, "%d/%d", m_Information.bufferSize, _sampleRate);
+		pw_properties_setf(_props, PW_KEY_NODE_RATE, "1/%d", _sampleRate);
+
+		pw_stream* _stream = pw_stream_new(m_Core, input ? "Audijo Capture" : "Audijo Playback", _props);
+		if (!_stream)
+		{
+			LOGL("Unable to create the PipeWire stream.");
+			return nullptr;
+		}
+
+		if (input)
+			pw_stream_add_listener(_stream, &m_CaptureListener, &m_CaptureEvents, this);
+		else
+			pw_stream_add_listener(_stream, &m_PlaybackListener, &m_PlaybackEvents, this);
+
+		// Offer only the planar callback format at the device channel count
+		spa_audio_info_raw _raw{};
+		_raw.format = ToSpaFormat(input ? m_Information.inFormat : m_Information.outFormat);
+		_raw.channels = input ? m_Information.inputChannels : m_Information.outputChannels;
+		_raw.rate = _sampleRate;
+		if (_raw.channels == 1)
+			_raw.position[0] = SPA_AUDIO_CHANNEL_MONO;
+		else if (_raw.channels == 2)
+			_raw.position[0] = SPA_AUDIO_CHANNEL_FL, _raw.position[1] = SPA_AUDIO_CHANNEL_FR;
+		else
+			_raw.flags = SPA_AUDIO_FLAG_UNPOSITIONED;
+
+		uint8_t _buffer[1024];
+		spa_pod_builder _builder{};
+		spa_pod_builder_init(&_builder, _buffer, sizeof(_buffer));
+		const spa_pod* _params[1]{ spa_format_audio_raw_build(&_builder, SPA_PARAM_EnumFormat, &_raw) };
+
+		// Connect inactive, Start() activates the stream
+		CHECK(pw_stream_connect(_stream, input ? PW_DIRECTION_INPUT : PW_DIRECTION_OUTPUT, PW_ID_ANY,
+			(pw_stream_flags)(PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS | PW_STREAM_FLAG_INACTIVE),
+			_params, 1), "Unable to connect the PipeWire stream.", pw_stream_destroy(_stream); return nullptr);
+
+		return _stream;
+	}
+
+	void PipeWireApi::FormatChanged(bool input, const spa_pod* param)
+	{
+		spa_audio_info_raw _raw{};
+		if (param == nullptr || spa_format_audio_raw_parse(param, &_raw) < 0)
+			return;
+
+		// Store the negotiated format, when it equals the callback format the
+		// stream buffers are handed to the callback without conversion.
+		auto _format = FromSpaFormat(_raw.format);
+		if (_format == None)
+		{
+			LOGW("Negotiated an unsupported sample format.");
+			return;
+		}
+
+		// The stream information keeps the offered format, the data thread reads it without the loop
+		// lock. Any other format stops the callback until the stream is reopened.
+		auto& _current = input ? m_DeviceInFormat : m_DeviceOutFormat;
+		auto _offered = input ? m_Information.deviceInFormat : m_Information.deviceOutFormat;
+		if (_current.exchange(_format, std::memory_order_relaxed) != _format && _format != _offered)
+			Notify(FormatChanged);
+	}
+
+	bool PipeWireApi::Negotiated() const
+	{
+		return m_DeviceInFormat.load(std::memory_order_relaxed) == m_Information.deviceInFormat
+			&& m_DeviceOutFormat.load(std::memory_order_relaxed) == m_Information.deviceOutFormat;
+	}
+
+	void PipeWireApi::StreamStateChanged(void* data, pw_stream_state old, pw_stream_state state, const char* error)
+	{
+		auto _api = (PipeWireApi*)data;
+		if (state == PW_STREAM_STATE_ERROR)
+		{
+			LOGL("PipeWire stream error: " << (error ? error : "unknown"));
+			_api->Notify(StreamFailed);
+		}
+
+		// The node we were linked to went away
+		else if (state == PW_STREAM_STATE_UNCONNECTED && _api->State() == Running)
+			_api->Notify(DeviceLost);
+	}
+
+	void PipeWireApi::CaptureParamChanged(void* data, uint32_t id, const spa_pod* param)
+	{
+		if (id == SPA_PARAM_Format)
+			((PipeWireApi*)data)->FormatChanged(true, param);
+	}
+
+	void PipeWireApi::PlaybackParamChanged(void* data, uint32_t id, const spa_pod* param)
+	{
+		if (id == SPA_PARAM_Format)
+			((PipeWireApi*)data)->FormatChanged(false, param);
+	}
+
+	double PipeWireApi::CycleTime(pw_stream* stream)
+	{
+		pw_time _time{};
+		if (pw_stream_get_time_n(stream, &_time, sizeof(_time)) < 0 || _time.now == 0)
+			return -1;
+
+		return _time.now * 1e-9;
+	}
+
+	void PipeWireApi::CaptureProcess(void* data)
+	{
+		auto _api = (PipeWireApi*)data;
+		pw_buffer* _buffer = pw_stream_dequeue_buffer(_api->m_CaptureStream);
+		if (_buffer == nullptr)
+			return;
+
+		// Waiting for the reopen after a renegotiation
+		if (!_api->Negotiated())
+		{
+			pw_stream_queue_buffer(_api->m_CaptureStream, _buffer);
+			return;
+		}
+
+		int _nInChannels = _api->m_Information.inputChannels;
+		int _bytes = _api->m_Information.deviceInFormat & Bytes;
+		spa_buffer* _spa = _buffer->buffer;
+
+		// Collect the planar channel buffers
+		int _frames = MaxQuantum;
+		for (int i = 0; i < _nInChannels; i++)
+		{
+			if (i >= _spa->n_datas || _spa->datas[i].data == nullptr)
+			{
+				pw_stream_queue_buffer(_api->m_CaptureStream, _buffer);
+				return;
+			}
+
+			auto& _data = _spa->datas[i];
+			uint32_t _offset = std::min(_data.chunk->offset, _data.maxsize);
+			uint32_t _size = std::min(_data.chunk->size, _data.maxsize - _offset);
+			_api->m_DeviceInputs[i] = (char*)_data.data + _offset;
+			_frames = std::min<int>(_frames, _size / _bytes);
+		}
+
+		// Duplex, leave the period for the playback stream
+		if (_api->m_PlaybackStream)
+		{
+			for (int i = 0; i < _nInChannels; i++)
+				std::memcpy(_api->m_CaptureBuffers[i].data(), _api->m_DeviceInputs[i], _frames * _bytes);
+
+			// The playback stream didn't pick up the last period
+			if (int _lost = _api->m_CapturedFrames.exchange(_frames, std::memory_order_acq_rel))
+				_api->ReportXrun(InputOverrun, _lost);
+		}
+
+		// Otherwise process it right away
+		else if (_frames > 0)
+		{
+			_api->QuantumChanged(_frames);
+			_api->Process(_api->m_DeviceInputs.data(), _api->m_DeviceOutputs.data(), _frames, _api->CycleTime(_api->m_CaptureStream));
+		}
+
+		pw_stream_queue_buffer(_api->m_CaptureStream, _buffer);
+	}
+
+	void PipeWireApi::PlaybackProcess(void* data)
+	{
+		auto _api = (PipeWireApi*)data;
+		pw_buffer* _buffer = pw_stream_dequeue_buffer(_api->m_PlaybackStream);
+		if (_buffer == nullptr)
+		{
+			// Out of buffers, the graph plays silence this cycle
+			_api->ReportXrun(OutputUnderrun);
+			return;
+		}
+
+		// Waiting for the reopen after a renegotiation, queue the buffer empty
+		if (!_api->Negotiated())
+		{
+			for (uint32_t i = 0; i < _buffer->buffer->n_datas; i++)
+				_buffer->buffer->datas[i].chunk->size = 0;
+			pw_stream_queue_buffer(_api->m_PlaybackStream, _buffer);
+			return;
+		}
+
+		int _nInChannels = _api->m_Information.inputChannels;
+		int _nOutChannels = _api->m_Information.outputChannels;
+		int _bytes = _api->m_Information.deviceOutFormat & Bytes;
+		spa_buffer* _spa = _buffer->buffer;
+
+		int _capacity = MaxQuantum;
+		for (int i = 0; i < _nOutChannels; i++)
+		{
+			if (i >= _spa->n_datas || _spa->datas[i].data == nullptr)
+			{
+				pw_stream_queue_buffer(_api->m_PlaybackStream, _buffer);
+				return;
+			}
+
+			_api->m_DeviceOutputs[i] = (char*)_spa->datas[i].data;
+			_capacity = std::min<int>(_capacity, _spa->datas[i].maxsize / _bytes);
+		}
+
+		int _frames = _api->PlaybackFrames(_buffer, _capacity);
+		_api->QuantumChanged(_frames);
+
+		// Pick up the captured period in a duplex stream, anything
+		// the capture stream did not deliver is silence.
+		char** _inputs = _api->m_DeviceInputs.data();
+		if (_api->m_CaptureStream)
+		{
+			int _inBytes = _api->m_Information.deviceInFormat & Bytes;
+			int _captured = _api->m_CapturedFrames.exchange(0, std::memory_order_acquire);
+			if (_captured < _frames && _api->Position() > 0)
+				_api->ReportXrun(InputUnderrun, _frames - _captured);
+			for (int i = 0; i < _nInChannels; i++)
+			{
+				auto& _capture = _api->m_CaptureBuffers[i];
+				if (_captured < _frames)
+					std::fill(_capture.begin() + _captured * _inBytes, _capture.begin() + _frames * _inBytes, 0);
+				_inputs[i] = _capture.data();
+			}
+		}
+
+		_api->Process(_inputs, _api->m_DeviceOutputs.data(), _frames, _api->CycleTime(_api->m_PlaybackStream));
+
+		for (int i = 0; i < _nOutChannels; i++)
+		{
+			auto _chunk = _spa->datas[i].chunk;
+			_chunk->offset = 0;
+			_chunk->stride = _bytes;
+			_chunk->size = _frames * _bytes;
+		}
+
+		pw_stream_queue_buffer(_api->m_PlaybackStream, _buffer);
+	}
+
+	int PipeWireApi::PlaybackFrames(pw_buffer* buffer, int capacity) const
+	{
+		// Use the size the graph requested, this is the quantum
+		int _frames = (int)buffer->requested;
+
+		// Older versions don't request a size, then the quantum comes from the position of the graph
+		if (_frames == 0)
+			if (auto _position = m_PlaybackPosition.load(std::memory_order_acquire))
+				_frames = (int)_position->clock.duration;
+
+		// Otherwise keep the quantum of the last cycle
+		if (_frames <= 0)
+			_frames = m_Quantum.load(std::memory_order_relaxed);
+
+		return std::clamp(_frames, 1, capacity);
+	}
+
+	void PipeWireApi::QuantumChanged(int frames)
+	{
+		if (frames == m_Quantum.load(std::memory_order_relaxed))
+			return;
+
+		m_Quantum.store(frames, std::memory_order_relaxed);
+		Notify(BufferSizeChanged, frames);
+	}
+
+	void PipeWireApi::PlaybackIoChanged(void* data, uint32_t id, void* area, uint32_t)
+	{
+		if (id == SPA_IO_Position)
+			((PipeWireApi*)data)->m_PlaybackPosition.store((spa_io_position*)area, std::memory_order_release);
+	}
+
+	const pw_stream_events PipeWireApi::m_CaptureEvents{
+		.version = PW_VERSION_STREAM_EVENTS, .state_changed = StreamStateChanged, .param_changed = CaptureParamChanged, .process = CaptureProcess };
+
+	const pw_stream_events PipeWireApi::m_PlaybackEvents{
+		.version = PW_VERSION_STREAM_EVENTS, .state_changed = StreamStateChanged, .io_changed = PlaybackIoChanged, .param_changed = PlaybackParamChanged, .process = PlaybackProcess };
+}
+#endif
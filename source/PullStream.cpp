@@ -0,0 +1,83 @@
+#include "Audijo/PullStream.hpp"
+
+namespace Audijo
+{
+	void PullStreamBase::Running(bool running)
+	{
+		if (m_Running.exchange(running) && !running)
+			Interrupt();
+	}
+
+	void PullStreamBase::Interrupt()
+	{
+		m_Sequence.fetch_add(1, std::memory_order_release);
+		m_Sequence.notify_all();
+	}
+
+	void PullStreamBase::Suspend(Direction direction, std::size_t frames, std::coroutine_handle<> handle)
+	{
+		{
+			std::lock_guard _lock{ m_WakerMutex };
+			if (!m_WakerRunning)
+			{
+				m_WakerRunning = true;
+				m_Waker = std::thread{ [this]() { Waker(); } };
+			}
+		}
+
+		m_SuspendedFrames[direction].store(frames, std::memory_order_relaxed);
+		m_Suspended[direction].store(handle.address(), std::memory_order_release);
+		Interrupt();
+	}
+
+	void PullStreamBase::StopWaker()
+	{
+		{
+			std::lock_guard _lock{ m_WakerMutex };
+			m_WakerRunning = false;
+		}
+
+		Interrupt();
+		if (m_Waker.joinable())
+			m_Waker.join();
+	}
+
+	void PullStreamBase::Waker()
+	{
+		while (true)
+		{
+			uint32_t _sequence = m_Sequence.load(std::memory_order_acquire);
+
+			// Only ask the audio thread for a wake while a coroutine waits on a period, Suspend
+			// wakes us itself, so an idle waker doesn't cost it a system call every period
+			bool _suspended = false;
+			for (int i = 0; i < Directions; i++)
+				_suspended |= m_Suspended[i].load(std::memory_order_acquire) != nullptr;
+			if (_suspended)
+			{
+				m_Waiting.store(true, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+
+			if (!m_WakerRunning)
+				return;
+
+			// A resumed coroutine might suspend again right away, so look again before waiting
+			bool _resumed = false;
+			for (int i = 0; i < Directions; i++)
+			{
+				auto _direction = (Direction)i;
+				void* _address = m_Suspended[i].load(std::memory_order_acquire);
+				if (_address && Ready(_direction, m_SuspendedFrames[i].load(std::memory_order_relaxed)))
+				{
+					m_Suspended[i].store(nullptr, std::memory_order_relaxed);
+					std::coroutine_handle<>::from_address(_address).resume();
+					_resumed = true;
+				}
+			}
+
+			if (!_resumed)
+				m_Sequence.wait(_sequence, std::memory_order_acquire);
+		}
+	}
+}
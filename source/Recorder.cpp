@@ -0,0 +1,201 @@
+#include "Audijo/Recorder.hpp"
+#include <cstdio>
+
+namespace Audijo
+{
+	/**
+	 * Write a little endian value to a byte buffer.
+	 * @param dest destination
+	 * @param value value
+	 * @return pointer past the written value
+	 */
+	template<typename T>
+	static char* WriteLE(char* dest, T value)
+	{
+		for (std::size_t i = 0; i < sizeof(T); i++)
+			*dest++ = (char)((uint64_t)value >> (8 * i));
+		return dest;
+	}
+
+	static char* WriteTag(char* dest, const char* tag)
+	{
+		std::memcpy(dest, tag, 4);
+		return dest + 4;
+	}
+
+	Recorder::Recorder(const std::string& path, int channels, int maxFrames, double sampleRate)
+		: m_Path(path), m_Channels(channels), m_MaxFrames(maxFrames), m_SampleRate(sampleRate)
+	{
+		// Enough blocks to hold about 2 seconds, so the writer can survive slow disk writes
+		int _blocks = std::max(8, (int)std::ceil(2 * sampleRate / std::max(maxFrames, 1)));
+		m_Samples.resize((std::size_t)_blocks * channels * maxFrames);
+		for (int i = 0; i < _blocks; i++)
+			m_Blocks.push_back(Block{ m_Samples.data() + (std::size_t)i * channels * maxFrames, maxFrames, 0 });
+	}
+
+	Recorder::~Recorder()
+	{
+		Stop();
+	}
+
+	bool Recorder::Start()
+	{
+		m_File = std::fopen(m_Path.c_str(), "wb");
+		if (!m_File)
+		{
+			LOGL("Unable to open " << m_Path << " for recording.");
+			return false;
+		}
+
+		// We always write in large chunks, so skip the stdio buffer
+		std::setvbuf(m_File, nullptr, _IONBF, 0);
+		m_Chunk = new (std::align_val_t{ ChunkAlignment }) char[ChunkSize];
+		m_ChunkFill = 0;
+		m_DataBytes = 0;
+
+		// Placeholder header, the sizes are filled in when the recording stops
+		WriteHeader();
+
+		m_Running = true;
+		m_Writer = std::thread{ [this]() { Write(); } };
+		return true;
+	}
+
+	void Recorder::Stop()
+	{
+		if (!m_Running.exchange(false))
+			return;
+
+		m_Writer.join();
+
+		// Finish the file
+		Flush(true);
+		WriteHeader();
+		std::fclose(m_File);
+		m_File = nullptr;
+		operator delete[](m_Chunk, std::align_val_t{ ChunkAlignment });
+		m_Chunk = nullptr;
+	}
+
+	Recorder::Block* Recorder::Acquire()
+	{
+		std::size_t _write = m_Write.load(std::memory_order_relaxed);
+		if (_write - m_Read.load(std::memory_order_acquire) >= m_Blocks.size())
+		{
+			m_Dropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		return &m_Blocks[_write % m_Blocks.size()];
+	}
+
+	void Recorder::Commit(int frames)
+	{
+		std::size_t _write = m_Write.load(std::memory_order_relaxed);
+		m_Blocks[_write % m_Blocks.size()].frames = std::min(frames, m_MaxFrames);
+		m_Write.store(_write + 1, std::memory_order_release);
+	}
+
+	RecordingInformation Recorder::Information() const
+	{
+		return RecordingInformation{ m_Running, m_Path, m_Channels, m_Frames, m_Dropped };
+	}
+
+	void Recorder::Write()
+	{
+		std::size_t _frameBytes = m_Channels * sizeof(float);
+		while (true)
+		{
+			// Read the running flag before draining, so the last blocks are never missed
+			bool _running = m_Running.load();
+			std::size_t _read = m_Read.load(std::memory_order_relaxed);
+			std::size_t _write = m_Write.load(std::memory_order_acquire);
+
+			if (_read == _write)
+			{
+				if (!_running)
+					return;
+
+				// Polling keeps the audio thread free from any wake-up calls
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				continue;
+			}
+
+			// Interleave the block into the chunk, writing the chunk whenever it's full
+			auto& _block = m_Blocks[_read % m_Blocks.size()];
+			for (int i = 0; i < _block.frames; i++)
+			{
+				if (m_ChunkFill + _frameBytes > ChunkSize)
+					Flush();
+
+				float* _frame = (float*)(m_Chunk + m_ChunkFill);
+				for (int j = 0; j < m_Channels; j++)
+					_frame[j] = _block.Channel(j)[i];
+				m_ChunkFill += _frameBytes;
+			}
+
+			m_Frames.fetch_add(_block.frames, std::memory_order_relaxed);
+			m_Read.store(_read + 1, std::memory_order_release);
+		}
+	}
+
+	void Recorder::Flush(bool all)
+	{
+		std::size_t _bytes = all ? m_ChunkFill : m_ChunkFill / ChunkAlignment * ChunkAlignment;
+		if (_bytes == 0)
+			return;
+
+		if (std::fwrite(m_Chunk, 1, _bytes, m_File) != _bytes)
+			LOGL("Failed to write to " << m_Path);
+
+		m_DataBytes += _bytes;
+		m_ChunkFill -= _bytes;
+		std::memmove(m_Chunk, m_Chunk + _bytes, m_ChunkFill);
+	}
+
+	void Recorder::WriteHeader()
+	{
+		// RF64 when the sizes don't fit in the 32 bit RIFF fields, the JUNK chunk
+		// reserves the space for the ds64 chunk so the data never has to move.
+		bool _rf64 = m_DataBytes + HeaderSize - 8 > 0xFFFFFFFF;
+		uint64_t _riffSize = m_DataBytes + HeaderSize - 8;
+		uint64_t _sampleCount = m_DataBytes / (m_Channels * sizeof(float));
+		uint16_t _blockAlign = m_Channels * sizeof(float);
+
+		char _header[HeaderSize];
+		char* _ptr = _header;
+		_ptr = WriteTag(_ptr, _rf64 ? "RF64" : "RIFF");
+		_ptr = WriteLE<uint32_t>(_ptr, _rf64 ? 0xFFFFFFFF : (uint32_t)_riffSize);
+		_ptr = WriteTag(_ptr, "WAVE");
+
+		_ptr = WriteTag(_ptr, _rf64 ? "ds64" : "JUNK");
+		_ptr = WriteLE<uint32_t>(_ptr, 28);
+		_ptr = WriteLE<uint64_t>(_ptr, _rf64 ? _riffSize : 0);
+		_ptr = WriteLE<uint64_t>(_ptr, _rf64 ? m_DataBytes : 0);
+		_ptr = WriteLE<uint64_t>(_ptr, _rf64 ? _sampleCount : 0);
+		_ptr = WriteLE<uint32_t>(_ptr, 0); // No table
+
+		_ptr = WriteTag(_ptr, "fmt ");
+		_ptr = WriteLE<uint32_t>(_ptr, 16);
+		_ptr = WriteLE<uint16_t>(_ptr, 3); // IEEE float
+		_ptr = WriteLE<uint16_t>(_ptr, m_Channels);
+		_ptr = WriteLE<uint32_t>(_ptr, (uint32_t)m_SampleRate);
+		_ptr = WriteLE<uint32_t>(_ptr, (uint32_t)m_SampleRate * _blockAlign);
+		_ptr = WriteLE<uint16_t>(_ptr, _blockAlign);
+		_ptr = WriteLE<uint16_t>(_ptr, 32);
+
+		// Pads the header up to the alignment, so the samples start on a disk sector
+		std::size_t _padding = HeaderSize - (_ptr - _header) - 16;
+		_ptr = WriteTag(_ptr, "JUNK");
+		_ptr = WriteLE<uint32_t>(_ptr, (uint32_t)_padding);
+		std::memset(_ptr, 0, _padding);
+		_ptr += _padding;
+
+		_ptr = WriteTag(_ptr, "data");
+		_ptr = WriteLE<uint32_t>(_ptr, _rf64 ? 0xFFFFFFFF : (uint32_t)m_DataBytes);
+
+		std::fseek(m_File, 0, SEEK_SET);
+		std::fwrite(_header, 1, HeaderSize, m_File);
+		std::fseek(m_File, 0, SEEK_END);
+	}
+}
@@ -0,0 +1,533 @@
+#include "Audijo/Resampler.hpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AUDIJO_AVX2_TARGET
+#else
+#define AUDIJO_AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#define AUDIJO_AVX2
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define AUDIJO_SSE
+#endif
+
+namespace Audijo
+{
+	/**
+	 * Dot product of a block of input samples with a row of filter taps, with the
+	 * instructions every cpu of the target architecture has.
+	 * @tparam N amount of taps, a multiple of 16
+	 */
+	template<int N>
+	static inline float DotBaseline(const float* samples, const float* taps)
+	{
+#if defined(AUDIJO_SSE)
+		__m128 _sum0 = _mm_setzero_ps();
+		__m128 _sum1 = _mm_setzero_ps();
+		for (int k = 0; k < N; k += 8)
+		{
+			_sum0 = _mm_add_ps(_sum0, _mm_mul_ps(_mm_loadu_ps(samples + k), _mm_loadu_ps(taps + k)));
+			_sum1 = _mm_add_ps(_sum1, _mm_mul_ps(_mm_loadu_ps(samples + k + 4), _mm_loadu_ps(taps + k + 4)));
+		}
+		__m128 _sum = _mm_add_ps(_sum0, _sum1);
+		_sum = _mm_add_ps(_sum, _mm_movehl_ps(_sum, _sum));
+		_sum = _mm_add_ss(_sum, _mm_shuffle_ps(_sum, _sum, 1));
+		return _mm_cvtss_f32(_sum);
+#else
+		float _sum = 0;
+		for (int k = 0; k < N; k++)
+			_sum += samples[k] * taps[k];
+		return _sum;
+#endif
+	}
+
+#if defined(AUDIJO_AVX2)
+	/**
+	 * Dot product with AVX2 and FMA, compiled for those whatever the target of the build. Only
+	 * call it when the cpu has them, see s_Avx2.
+	 * @tparam N amount of taps, a multiple of 16
+	 */
+	template<int N>
+	AUDIJO_AVX2_TARGET static float DotAvx2(const float* samples, const float* taps)
+	{
+		__m256 _sum0 = _mm256_setzero_ps();
+		__m256 _sum1 = _mm256_setzero_ps();
+		for (int k = 0; k < N; k += 16)
+		{
+			_sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(samples + k), _mm256_loadu_ps(taps + k), _sum0);
+			_sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(samples + k + 8), _mm256_loadu_ps(taps + k + 8), _sum1);
+		}
+		__m256 _sum8 = _mm256_add_ps(_sum0, _sum1);
+		__m128 _sum = _mm_add_ps(_mm256_castps256_ps128(_sum8), _mm256_extractf128_ps(_sum8, 1));
+		_sum = _mm_add_ps(_sum, _mm_movehl_ps(_sum, _sum));
+		_sum = _mm_add_ss(_sum, _mm_shuffle_ps(_sum, _sum, 1));
+		return _mm_cvtss_f32(_sum);
+	}
+
+	/**
+	 * Check whether the cpu, and the os, support AVX2 and FMA.
+	 * @return true if DotAvx2 can run
+	 */
+	static bool SupportsAvx2()
+	{
+#ifdef _MSC_VER
+		int _info[4];
+		__cpuid(_info, 0);
+		if (_info[0] < 7)
+			return false;
+
+		// FMA, and the os saves the AVX registers
+		__cpuid(_info, 1);
+		if ((_info[2] & (1 << 12)) == 0 || (_info[2] & (1 << 27)) == 0 || (_info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+			return false;
+
+		__cpuidex(_info, 7, 0);
+		return (_info[1] & (1 << 5)) != 0;
+#else
+		// Runs during static initialization, maybe before the cpu model was filled in
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	}
+
+	// Checked once when the library loads, the audio thread only reads it
+	static const bool s_Avx2 = SupportsAvx2();
+#endif
+
+	/**
+	 * Dot product of a block of input samples with a row of filter taps.
+	 * @tparam N amount of taps, a multiple of 16
+	 */
+	template<int N>
+	static inline float Dot(const float* samples, const float* taps)
+	{
+#if defined(AUDIJO_AVX2)
+		if (s_Avx2)
+			return DotAvx2<N>(samples, taps);
+#endif
+		return DotBaseline<N>(samples, taps);
+	}
+
+	/**
+	 * Fill a table of windowed-sinc filters, row p is shifted by p / divisions of a sample.
+	 * @param table rows * taps values
+	 * @param rows amount of rows
+	 * @param divisions amount of rows per sample
+	 * @param taps length of the filter
+	 * @param cutoff cutoff in cycles per input sample
+	 */
+	static void WindowedSinc(float* table, int rows, int divisions, int taps, double cutoff)
+	{
+		int _half = taps / 2;
+		for (int p = 0; p < rows; p++)
+		{
+			float* _row = &table[p * taps];
+			double _sum = 0;
+			for (int k = 0; k < taps; k++)
+			{
+				// Distance of this tap to the center, the center lies between tap half - 1 and half
+				double _x = k - (_half - 1) - (double)p / divisions;
+				double _arg = 2 * std::numbers::pi * cutoff * _x;
+				double _sinc = _x == 0 ? 1 : std::sin(_arg) / _arg;
+
+				// Blackman-Harris window over the length of the filter
+				double _w = std::numbers::pi * _x / _half;
+				double _window = std::abs(_x) >= _half ? 0 :
+					0.35875 + 0.48829 * std::cos(_w) + 0.14128 * std::cos(2 * _w) + 0.01168 * std::cos(3 * _w);
+
+				_row[k] = _sinc * _window;
+				_sum += _row[k];
+			}
+
+			// Unity gain at DC for every phase
+			for (int k = 0; k < taps; k++)
+				_row[k] /= _sum;
+		}
+	}
+
+	AsyncResampler::AsyncResampler(int channels, int maxFrames, double nominal)
+		: m_Channels(channels), m_MaxFrames(maxFrames), m_Table((Phases + 1) * Taps),
+		m_History(channels * (Taps + maxFrames)), m_Step(1. / nominal)
+	{
+		// Cutoff just below the lowest of both nyquist frequencies, in cycles per input sample
+		WindowedSinc(m_Table.data(), Phases + 1, Phases, Taps, 0.45 * std::min(1., nominal));
+		Reset();
+	}
+
+	void AsyncResampler::Reset()
+	{
+		// Start with a history of silence, so output starts right away
+		std::fill(m_History.begin(), m_History.end(), 0.f);
+		m_Count = Taps - 1;
+		m_Position = 0;
+	}
+
+	int AsyncResampler::Process(const float* const* input, int frames, float** output, int capacity)
+	{
+		int _stride = Taps + m_MaxFrames;
+		frames = std::min(frames, m_MaxFrames);
+		for (int c = 0; c < m_Channels; c++)
+			std::memcpy(&m_History[c * _stride + m_Count], input[c], frames * sizeof(float));
+		m_Count += frames;
+
+		int _frames = 0;
+		while (_frames < capacity)
+		{
+			int _index = (int)m_Position;
+			if (_index + Taps > m_Count)
+				break;
+
+			double _phase = (m_Position - _index) * Phases;
+			int _row = (int)_phase;
+			float _mix = (float)(_phase - _row);
+			const float* _taps0 = &m_Table[_row * Taps];
+			const float* _taps1 = _taps0 + Taps;
+
+			for (int c = 0; c < m_Channels; c++)
+			{
+				const float* _samples = &m_History[c * _stride + _index];
+				float _a = Dot<Taps>(_samples, _taps0);
+				float _b = Dot<Taps>(_samples, _taps1);
+				output[c][_frames] = _a + _mix * (_b - _a);
+			}
+
+			m_Position += m_Step;
+			_frames++;
+		}
+
+		// Drop the input no output needs anymore
+		int _consumed = std::min((int)m_Position, m_Count);
+		if (_consumed > 0)
+		{
+			for (int c = 0; c < m_Channels; c++)
+				std::memmove(&m_History[c * _stride], &m_History[c * _stride + _consumed], (m_Count - _consumed) * sizeof(float));
+			m_Count -= _consumed;
+			m_Position -= _consumed;
+		}
+
+		return _frames;
+	}
+
+	/**
+	 * Get the polyphase table of a ratio, computed once and shared while any resampler uses it.
+	 * @param phases amount of phases
+	 * @param cutoff cutoff in cycles per input sample
+	 * @return table
+	 */
+	static std::shared_ptr<const std::vector<float>> PolyphaseTable(int phases, double cutoff)
+	{
+		static std::mutex _mutex;
+		static std::map<std::pair<int, double>, std::weak_ptr<const std::vector<float>>> _tables;
+
+		std::lock_guard _lock{ _mutex };
+		auto& _entry = _tables[{ phases, cutoff }];
+		if (auto _table = _entry.lock())
+			return _table;
+
+		auto _table = std::make_shared<std::vector<float>>(phases * PolyphaseResampler::Taps);
+		WindowedSinc(_table->data(), phases, phases, PolyphaseResampler::Taps, cutoff);
+		_entry = _table;
+		return _table;
+	}
+
+	bool PolyphaseResampler::Supports(double inRate, double outRate)
+	{
+		if (inRate <= 0 || outRate <= 0 || inRate != std::floor(inRate) || outRate != std::floor(outRate))
+			return false;
+
+		int64_t _in = (int64_t)inRate;
+		int64_t _out = (int64_t)outRate;
+		return _out / std::gcd(_in, _out) <= MaxPhases;
+	}
+
+	PolyphaseResampler::PolyphaseResampler(int channels, int maxFrames, double inRate, double outRate)
+		: m_Channels(channels), m_MaxFrames(maxFrames), m_History(channels * (Taps + maxFrames))
+	{
+		int64_t _in = (int64_t)inRate;
+		int64_t _out = (int64_t)outRate;
+		int64_t _gcd = std::gcd(_in, _out);
+		m_Phases = (int)(_out / _gcd);
+		m_Step = (int)(_in / _gcd);
+
+		// Cutoff just below the lowest of both nyquist frequencies, in cycles per input sample
+		m_Table = PolyphaseTable(m_Phases, 0.44 * std::min(1., (double)m_Phases / m_Step));
+		Reset();
+	}
+
+	void PolyphaseResampler::Reset()
+	{
+		std::fill(m_History.begin(), m_History.end(), 0.f);
+		m_Count = Taps - 1;
+		m_Index = 0;
+		m_Phase = 0;
+	}
+
+	int PolyphaseResampler::Process(const float* const* input, int frames, float** output, int capacity)
+	{
+		int _stride = Taps + m_MaxFrames;
+		frames = std::min(frames, m_MaxFrames);
+		for (int c = 0; c < m_Channels; c++)
+			std::memcpy(&m_History[c * _stride + m_Count], input[c], frames * sizeof(float));
+		m_Count += frames;
+
+		const float* _table = m_Table->data();
+		int _frames = 0;
+		while (_frames < capacity && m_Index + Taps <= m_Count)
+		{
+			const float* _taps = &_table[m_Phase * Taps];
+			for (int c = 0; c < m_Channels; c++)
+				output[c][_frames] = Dot<Taps>(&m_History[c * _stride + m_Index], _taps);
+
+			// Advance by the input rate in phases, whole samples move the index
+			m_Phase += m_Step;
+			m_Index += m_Phase / m_Phases;
+			m_Phase %= m_Phases;
+			_frames++;
+		}
+
+		// Drop the input no output needs anymore
+		int _consumed = std::min(m_Index, m_Count);
+		if (_consumed > 0)
+		{
+			for (int c = 0; c < m_Channels; c++)
+				std::memmove(&m_History[c * _stride], &m_History[c * _stride + _consumed], (m_Count - _consumed) * sizeof(float));
+			m_Count -= _consumed;
+			m_Index -= _consumed;
+		}
+
+		return _frames;
+	}
+
+	/**
+	 * Create the resampler for a fixed conversion, exact phases when possible.
+	 */
+	static std::unique_ptr<ResamplerBase> CreateResampler(int channels, int maxFrames, double inRate, double outRate)
+	{
+		if (PolyphaseResampler::Supports(inRate, outRate))
+			return std::make_unique<PolyphaseResampler>(channels, maxFrames, inRate, outRate);
+
+		auto _resampler = std::make_unique<AsyncResampler>(channels, maxFrames, outRate / inRate);
+		_resampler->Ratio(outRate / inRate);
+		return _resampler;
+	}
+
+	RateConverter::RateConverter(int inputs, int outputs, double deviceRate, double streamRate, int period, int maxFrames)
+		: m_InputChannels(inputs), m_OutputChannels(outputs), m_DeviceRate(deviceRate), m_StreamRate(streamRate), m_Period(period)
+	{
+		if (inputs > 0)
+		{
+			m_InputResampler = CreateResampler(inputs, maxFrames, deviceRate, streamRate);
+			m_InputCapacity = 2 * (period + m_InputResampler->MaxOutput(maxFrames));
+		}
+
+		if (outputs > 0)
+		{
+			m_OutputResampler = CreateResampler(outputs, period, streamRate, deviceRate);
+			m_OutputCapacity = 2 * (maxFrames + m_OutputResampler->MaxOutput(period));
+		}
+
+		// One block per direction and side, plus both queues
+		m_Memory.assign(inputs * (maxFrames + period + m_InputCapacity) + outputs * (maxFrames + period + m_OutputCapacity), 0);
+		float* _memory = m_Memory.data();
+		auto _take = [&](std::vector<float*>& channels, int count, int frames) {
+			channels.resize(count);
+			for (auto& _channel : channels)
+				_channel = _memory, _memory += frames;
+		};
+
+		_take(m_DeviceInputs, inputs, maxFrames);
+		_take(m_Inputs, inputs, period);
+		_take(m_InputQueue, inputs, m_InputCapacity);
+		_take(m_DeviceOutputs, outputs, maxFrames);
+		_take(m_Outputs, outputs, period);
+		_take(m_OutputQueue, outputs, m_OutputCapacity);
+		m_Tails.resize(std::max(inputs, outputs));
+
+		// Periods run when the output needs them, the input queue starts a period
+		// ahead so the first one already has its input.
+		if (outputs > 0)
+			m_InputCount = period;
+	}
+
+	void RateConverter::Write(int frames)
+	{
+		if (!m_InputResampler)
+			return;
+
+		for (int c = 0; c < m_InputChannels; c++)
+			m_Tails[c] = m_InputQueue[c] + m_InputCount;
+		m_InputCount += m_InputResampler->Process(m_DeviceInputs.data(), frames, m_Tails.data(), m_InputCapacity - m_InputCount);
+	}
+
+	bool RateConverter::Pending(int frames) const
+	{
+		if (m_OutputResampler)
+			return m_OutputCount < frames;
+
+		return m_InputCount >= m_Period;
+	}
+
+	void RateConverter::BeginPeriod()
+	{
+		int _frames = std::min(m_InputCount, m_Period);
+		for (int c = 0; c < m_InputChannels; c++)
+		{
+			std::memcpy(m_Inputs[c], m_InputQueue[c], _frames * sizeof(float));
+			std::fill(m_Inputs[c] + _frames, m_Inputs[c] + m_Period, 0.f);
+			std::memmove(m_InputQueue[c], m_InputQueue[c] + _frames, (m_InputCount - _frames) * sizeof(float));
+		}
+		m_InputCount -= _frames;
+	}
+
+	void RateConverter::EndPeriod()
+	{
+		if (!m_OutputResampler)
+			return;
+
+		for (int c = 0; c < m_OutputChannels; c++)
+			m_Tails[c] = m_OutputQueue[c] + m_OutputCount;
+		m_OutputCount += m_OutputResampler->Process(m_Outputs.data(), m_Period, m_Tails.data(), m_OutputCapacity - m_OutputCount);
+	}
+
+	void RateConverter::Read(int frames)
+	{
+		int _frames = std::min(m_OutputCount, frames);
+		for (int c = 0; c < m_OutputChannels; c++)
+		{
+			std::memcpy(m_DeviceOutputs[c], m_OutputQueue[c], _frames * sizeof(float));
+			std::fill(m_DeviceOutputs[c] + _frames, m_DeviceOutputs[c] + frames, 0.f);
+			std::memmove(m_OutputQueue[c], m_OutputQueue[c] + _frames, (m_OutputCount - _frames) * sizeof(float));
+		}
+		m_OutputCount -= _frames;
+	}
+
+	double RateConverter::Delay() const
+	{
+		double _delay = 0;
+		if (m_InputResampler)
+			_delay += m_InputResampler->Delay() / m_DeviceRate;
+		if (m_OutputResampler)
+			_delay += m_OutputResampler->Delay() / m_StreamRate;
+		if (m_InputResampler && m_OutputResampler)
+			_delay += m_Period / m_StreamRate;
+		return _delay;
+	}
+
+	DuplexBridge::DuplexBridge(int channels, int latency, int maxFrames, double rate, double nominal)
+		: m_Channels(channels), m_Latency(std::max(latency, 1)), m_MaxFrames(maxFrames), m_Rate(rate), m_Nominal(nominal),
+		m_Resampler(channels, maxFrames, nominal), m_Ratio(nominal)
+	{
+		int _maxOutput = m_Resampler.MaxOutput(maxFrames);
+
+		// Room for a few times the latency, so only a stalled consumer can fill it up
+		std::size_t _size = 2;
+		while (_size < 4 * (std::size_t)(m_Latency + _maxOutput))
+			_size <<= 1;
+
+		m_Ring.resize(_size * channels);
+		m_Mask = _size - 1;
+
+		m_Scratch.resize(_maxOutput * channels);
+		m_Channel.resize(channels);
+		m_Input.resize(channels);
+		for (int c = 0; c < channels; c++)
+			m_Channel[c] = &m_Scratch[c * _maxOutput];
+	}
+
+	void DuplexBridge::Write(const float* const* input, int frames, double time)
+	{
+		if (time < 0)
+			time = HostTime();
+
+		// Control loop on the smoothed fill level error in seconds, critically damped. The proportional
+		// term pulls the level back, the integral term settles at the actual drift between the clocks.
+		// It only runs once the consumer reads, while the ring fills up there is nothing to follow.
+		double _readTime = m_ReadTime.load(std::memory_order_relaxed);
+		if (_readTime >= 0)
+		{
+			// The consumer takes whole blocks, count what it used since its last read as gone already
+			double _fill = Available();
+			_fill -= std::clamp((time - _readTime) * m_Rate, 0., (double)m_ReadFrames.load(std::memory_order_relaxed));
+
+			double _duration = frames / (m_Rate / m_Nominal);
+			m_Fill = m_Fill < 0 ? _fill : m_Fill + std::min(_duration / Smoothing, 1.) * (_fill - m_Fill);
+			double _error = (m_Fill - m_Latency) / m_Rate;
+			m_Integral = std::clamp(m_Integral + Integral * _duration * _error, -MaxCorrection, MaxCorrection);
+			double _correction = std::clamp(Proportional * _error + m_Integral, -MaxCorrection, MaxCorrection);
+			double _ratio = m_Nominal * (1 - _correction);
+			m_Resampler.Ratio(_ratio);
+			m_Ratio.store(_ratio, std::memory_order_relaxed);
+		}
+
+		for (int _offset = 0; _offset < frames; _offset += m_MaxFrames)
+		{
+			int _count = std::min(frames - _offset, m_MaxFrames);
+			for (int c = 0; c < m_Channels; c++)
+				m_Input[c] = input[c] + _offset;
+
+			int _frames = m_Resampler.Process(m_Input.data(), _count, m_Channel.data(), m_Resampler.MaxOutput(_count));
+
+			std::size_t _write = m_Write.load(std::memory_order_relaxed);
+			std::size_t _space = m_Mask + 1 - (_write - m_Read.load(std::memory_order_acquire));
+			if ((std::size_t)_frames > _space)
+			{
+				m_Overruns.fetch_add(1, std::memory_order_relaxed);
+				_frames = _space;
+			}
+
+			for (int i = 0; i < _frames; i++)
+			{
+				float* _frame = &m_Ring[((_write + i) & m_Mask) * m_Channels];
+				for (int c = 0; c < m_Channels; c++)
+					_frame[c] = m_Channel[c][i];
+			}
+
+			m_Write.store(_write + _frames, std::memory_order_release);
+		}
+	}
+
+	bool DuplexBridge::Read(float** output, int frames, double time)
+	{
+		std::size_t _read = m_Read.load(std::memory_order_relaxed);
+		int _available = (int)(m_Write.load(std::memory_order_acquire) - _read);
+
+		// Wait until the ring is at its latency before reading, also after running empty. The fill level
+		// the control loop sees is what's left after a read, so wait for the latency plus this read.
+		if (!m_Primed && _available < m_Latency + frames)
+		{
+			for (int c = 0; c < m_Channels; c++)
+				std::fill_n(output[c], frames, 0.f);
+			return true;
+		}
+
+		m_Primed = true;
+		m_ReadTime.store(time < 0 ? HostTime() : time, std::memory_order_relaxed);
+		m_ReadFrames.store(frames, std::memory_order_relaxed);
+
+		int _frames = std::min(frames, _available);
+		for (int i = 0; i < _frames; i++)
+		{
+			const float* _frame = &m_Ring[((_read + i) & m_Mask) * m_Channels];
+			for (int c = 0; c < m_Channels; c++)
+				output[c][i] = _frame[c];
+		}
+
+		m_Read.store(_read + _frames, std::memory_order_release);
+
+		if (_frames == frames)
+			return true;
+
+		for (int c = 0; c < m_Channels; c++)
+			std::fill(output[c] + _frames, output[c] + frames, 0.f);
+
+		// Prime again, the control loop waits for that so it doesn't wind up on the empty ring
+		m_Underruns.fetch_add(1, std::memory_order_relaxed);
+		m_ReadTime.store(-1, std::memory_order_relaxed);
+		m_Primed = false;
+		return false;
+	}
+}
@@ -0,0 +1,530 @@
+#ifdef AUDIJO_SHAREDMEMORY
+#include "Audijo/SharedMemoryApi.hpp"
+#include <filesystem>
+
+namespace Audijo
+{
+	/**
+	 * Layout of the start of a segment, the period ring follows after it. Only lock-free atomics are
+	 * used, those are address free so they work across processes mapping the segment at different addresses.
+	 */
+	struct SharedMemoryHeader
+	{
+		constexpr static uint32_t Magic = 0x4A445541; // 'AUDJ'
+		constexpr static uint32_t Version = 1;
+
+		std::atomic<uint32_t> magic;
+		uint32_t version;
+		int32_t channels;
+		int32_t bufferSize;
+		int32_t periods;
+		int32_t format;
+		double sampleRate;
+		uint64_t stride; // Bytes between two channel buffers, cache line aligned
+
+		// Producer side, on its own cache line
+		alignas(64) std::atomic<uint64_t> writeIndex; // Periods produced
+		std::atomic<uint32_t> dataFutex;              // Bumped every time a period is produced
+		std::atomic<uint32_t> dataWaiting;            // Consumer is sleeping on the data futex
+		std::atomic<int32_t> producer;                // Pid of the attached producer
+
+		// Consumer side, on its own cache line
+		alignas(64) std::atomic<uint64_t> readIndex;  // Periods consumed
+		std::atomic<uint32_t> spaceFutex;             // Bumped every time a period is consumed
+		std::atomic<uint32_t> spaceWaiting;           // Producer is sleeping on the space futex
+		std::atomic<int32_t> consumer;                // Pid of the attached consumer
+	};
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free);
+
+	constexpr static std::size_t CacheLine = 64;
+	constexpr static std::size_t Align(std::size_t size) { return (size + CacheLine - 1) & ~(CacheLine - 1); }
+	constexpr static const char* SegmentPrefix = "audijo-";
+
+	/**
+	 * Sleep on a futex, with a short timeout so a stopping stream
+	 * is never held up by a peer that went away.
+	 * @param futex futex word
+	 * @param value value the futex word had when we decided to sleep
+	 * @return true if nobody woke us before the timeout
+	 */
+	static bool FutexWait(std::atomic<uint32_t>& futex, uint32_t value)
+	{
+		timespec _timeout{ 0, 50'000'000 };
+		return syscall(SYS_futex, (uint32_t*)&futex, FUTEX_WAIT, value, &_timeout, nullptr, 0) == -1 && errno == ETIMEDOUT;
+	}
+
+	/**
+	 * Bump a futex and only wake the other side if it is actually sleeping,
+	 * so no syscall is made when both sides keep up.
+	 * @param futex futex word
+	 * @param waiting waiting flag of the other side
+	 */
+	static void FutexWake(std::atomic<uint32_t>& futex, std::atomic<uint32_t>& waiting)
+	{
+		futex.fetch_add(1);
+		if (waiting.load())
+			syscall(SYS_futex, (uint32_t*)&futex, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+	}
+
+	/**
+	 * Wake everyone waiting on a futex, regardless of the waiting flags.
+	 * @param futex futex word
+	 */
+	static void FutexWakeAll(std::atomic<uint32_t>& futex)
+	{
+		futex.fetch_add(1);
+		syscall(SYS_futex, (uint32_t*)&futex, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+	}
+
+	/**
+	 * Wait until ready() returns true, or the futex timed out.
+	 * @param futex futex word
+	 * @param waiting our waiting flag
+	 * @param ready condition
+	 * @param timedOut set when the other side didn't bump the futex in time
+	 * @return ready()
+	 */
+	template<typename Ready>
+	static bool Wait(std::atomic<uint32_t>& futex, std::atomic<uint32_t>& waiting, Ready ready, bool& timedOut)
+	{
+		if (ready())
+			return true;
+
+		uint32_t _value = futex.load();
+		waiting.store(1);
+		if (!ready())
+			timedOut = FutexWait(futex, _value);
+		waiting.store(0);
+		return ready();
+	}
+
+	/**
+	 * Attach this process to one side of a segment.
+	 * @param owner producer or consumer pid
+	 * @return true if attached
+	 */
+	static bool Attach(std::atomic<int32_t>& owner)
+	{
+		// Take over the side if the process that attached before is gone
+		int32_t _current = owner.load();
+		if (_current != 0 && (kill(_current, 0) == 0 || errno == EPERM))
+			return false;
+
+		return owner.compare_exchange_strong(_current, getpid());
+	}
+
+	static void Detach(std::atomic<int32_t>& owner)
+	{
+		int32_t _pid = getpid();
+		owner.compare_exchange_strong(_pid, 0);
+	}
+
+	char* SharedMemoryApi::Segment::Channel(uint64_t period, int channel) const
+	{
+		return data + ((period % header->periods) * header->channels + channel) * header->stride;
+	}
+
+	SharedMemoryApi::SharedMemoryApi(bool loadDevices)
+		: ApiBase()
+	{
+		if (loadDevices) {
+			// Load devices once at the start
+			Devices(true);
+		}
+	}
+
+	SharedMemoryApi::~SharedMemoryApi()
+	{
+		StopExecutor();
+		StopNotifications();
+		Close();
+	}
+
+	const std::vector<DeviceInfo<SharedMemory>>& SharedMemoryApi::Devices(bool reload)
+	{
+		if (!reload)
+			return m_Devices->devices;
+
+		// Segments live in /dev/shm, find all with our prefix
+		std::vector<std::string> _names;
+		std::error_code _error;
+		for (auto& _entry : std::filesystem::directory_iterator("/dev/shm", _error))
+		{
+			auto _name = _entry.path().filename().string();
+			if (_name.starts_with(SegmentPrefix))
+				_names.push_back(_name.substr(std::strlen(SegmentPrefix)));
+		}
+		std::sort(_names.begin(), _names.end());
+
+		std::vector<std::pair<std::string, DeviceInfo<SharedMemory>>> _devices;
+		for (auto& _name : _names)
+		{
+			Segment _segment;
+			if (Map(_name, _segment) != NoError)
+				continue;
+
+			auto _header = _segment.header;
+			std::vector<double> _srates{ _header->sampleRate };
+
+			// A segment can be used as input or as output, there's no default segment
+			DeviceInfo<SharedMemory> _device{ { NoDevice, _name, _header->channels, _header->channels, _srates, false, SharedMemory } };
+			_device.segment = _name;
+			_device.bufferSize = _header->bufferSize;
+			_device.periods = _header->periods;
+			_device.format = (SampleFormat)_header->format;
+			Unmap(_segment);
+
+			_devices.emplace_back(_name, std::move(_device));
+		}
+
+		// The registry keeps the id of a segment, also when others are created or removed
+		m_Registry.Update(std::move(_devices));
+		m_Devices = m_Registry.Read();
+		return m_Devices->devices;
+	}
+
+	Error SharedMemoryApi::Create(const std::string& name, int channels, int bufferSize, double sampleRate, int periods, SampleFormat format)
+	{
+		if (channels <= 0 || periods <= 0)
+			return Fail;
+
+		if (bufferSize <= 0)
+			return InvalidBufferSize;
+
+		std::size_t _stride = Align(bufferSize * (format & Bytes));
+		std::size_t _size = Align(sizeof(SharedMemoryHeader)) + _stride * channels * periods;
+
+		std::string _path = "/" + std::string{ SegmentPrefix } + name;
+		int _fd = shm_open(_path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+		if (_fd == -1)
+		{
+			int _error = errno;
+			LOGL("Unable to create segment " << name << ": " << std::strerror(_error));
+			return _error == EEXIST ? AlreadyOpen : Fail;
+		}
+
+		if (ftruncate(_fd, _size) == -1)
+		{
+			LOGL("Unable to allocate segment " << name << ": " << std::strerror(errno));
+			close(_fd);
+			shm_unlink(_path.c_str());
+			return NoMemory;
+		}
+
+		void* _memory = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+		close(_fd);
+		if (_memory == MAP_FAILED)
+		{
+			shm_unlink(_path.c_str());
+			return NoMemory;
+		}
+
+		// The memory is zeroed, so all atomics start at 0. Publish the magic
+		// last, so other processes never map a half initialized segment.
+		auto _header = new (_memory) SharedMemoryHeader{};
+		_header->version = SharedMemoryHeader::Version;
+		_header->channels = channels;
+		_header->bufferSize = bufferSize;
+		_header->periods = periods;
+		_header->format = format;
+		_header->sampleRate = sampleRate;
+		_header->stride = _stride;
+		_header->magic.store(SharedMemoryHeader::Magic, std::memory_order_release);
+		munmap(_memory, _size);
+
+		Devices(true);
+		return NoError;
+	}
+
+	Error SharedMemoryApi::Remove(const std::string& name)
+	{
+		std::string _path = "/" + std::string{ SegmentPrefix } + name;
+		if (shm_unlink(_path.c_str()) == -1)
+			return NotPresent;
+
+		Devices(true);
+		return NoError;
+	}
+
+	Error SharedMemoryApi::Open(const StreamParameters& settings)
+	{
+		if (State() != Closed)
+			return AlreadyOpen;
+
+		m_Information = settings;
+
+		// There's no default segment
+		if (m_Information.input == Default)
+			m_Information.input = NoDevice;
+		if (m_Information.output == Default)
+			m_Information.output = NoDevice;
+
+		auto _inDevice = m_Information.input == NoDevice ? nullptr : DeviceById(m_Information.input);
+		auto _outDevice = m_Information.output == NoDevice ? nullptr : DeviceById(m_Information.output);
+		if (!_inDevice && !_outDevice)
+			return NotPresent;
+
+		if ((m_Information.input != NoDevice && !_inDevice) || (m_Information.output != NoDevice && !_outDevice))
+			return NotPresent;
+
+		// Both sides of a duplex stream run at the same period
+		if (_inDevice && _outDevice && (_inDevice->bufferSize != _outDevice->bufferSize
+			|| _inDevice->sampleRates[0] != _outDevice->sampleRates[0]))
+		{
+			LOGL("The input and output segment should have the same buffer size and sample rate.");
+			return InvalidDuplex;
+		}
+
+		// Period size and rate are a property of the segment
+		auto& _device = _inDevice ? *_inDevice : *_outDevice;
+		if (m_Information.bufferSize == Default)
+			m_Information.bufferSize = _device.bufferSize;
+		else if (m_Information.bufferSize != _device.bufferSize)
+			return InvalidBufferSize;
+
+		// Another rate goes through the resampling stage, if allowed
+		if (m_Information.sampleRate == (double)Default)
+			m_Information.sampleRate = _device.sampleRates[0];
+		else if (m_Information.sampleRate != _device.sampleRates[0] && !m_Information.resampling)
+			return InvalidSampleRate;
+		else if (m_Information.sampleRate != _device.sampleRates[0])
+			m_Information.deviceSampleRate = _device.sampleRates[0];
+
+		// If callback has been set, deduce format type
+		if (m_Callback)
+		{
+			m_Information.inFormat = (SampleFormat)m_Callback->InFormat();
+			m_Information.outFormat = (SampleFormat)m_Callback->OutFormat();
+		}
+		else
+		{
+			LOGL("Failed to deduce sample format, no callback was set.");
+			return NoCallback;
+		}
+
+		// Map the segments and attach as consumer or producer
+		if (_inDevice)
+		{
+			if (auto _error = Map(_inDevice->segment, m_Input))
+				return _error;
+
+			if (!Attach(m_Input.header->consumer))
+			{
+				LOGL("Segment " << _inDevice->segment << " already has a consumer.");
+				Unmap(m_Input);
+				return Fail;
+			}
+
+			// Skip periods that were left in the ring before we attached
+			m_Input.header->readIndex.store(m_Input.header->writeIndex.load());
+			m_Information.inputChannels = _inDevice->inputChannels;
+			m_Information.deviceInFormat = _inDevice->format;
+		}
+
+		if (_outDevice)
+		{
+			if (auto _error = Map(_outDevice->segment, m_Output))
+			{
+				Close();
+				return _error;
+			}
+
+			if (!Attach(m_Output.header->producer))
+			{
+				LOGL("Segment " << _outDevice->segment << " already has a producer.");
+				Close();
+				return Fail;
+			}
+
+			m_Information.outputChannels = _outDevice->outputChannels;
+			m_Information.deviceOutFormat = _outDevice->format;
+		}
+
+		// Allocate the user callback buffers
+		AllocateBuffers();
+		m_DeviceInputs.assign(m_Information.inputChannels, nullptr);
+		m_DeviceOutputs.assign(m_Information.outputChannels, nullptr);
+
+		State(Opened);
+		return NoError;
+	}
+
+	Error SharedMemoryApi::Start()
+	{
+		if (auto _error = BeginStart())
+			return _error;
+
+		// Only running once the thread exists, so a Stop always has a thread to join
+		m_ThreadConfigured = false;
+		m_AudioThread = std::thread{ [this]() { Run(); } };
+		Transition(Starting, Running);
+		return NoError;
+	}
+
+	Error SharedMemoryApi::Stop()
+	{
+		if (auto _error = BeginStop())
+			return _error;
+
+		// Wake the audio thread if it's waiting on the other side, only it waits on these
+		if (m_Input.header)
+			FutexWakeAll(m_Input.header->dataFutex);
+		if (m_Output.header)
+			FutexWakeAll(m_Output.header->spaceFutex);
+
+		try
+		{
+			m_AudioThread.join();
+		}
+		catch (const std::system_error& e)
+		{
+			LOGW(e.what());
+		}
+
+		Transition(Stopping, Opened);
+		return NoError;
+	}
+
+	Error SharedMemoryApi::Close()
+	{
+		if (State() == Running)
+			Stop();
+
+		StopRecording();
+
+		// Also cleans up after an Open that failed halfway
+		bool _wasOpen = State() != Closed;
+		if (m_Input.header)
+			Detach(m_Input.header->consumer);
+		if (m_Output.header)
+			Detach(m_Output.header->producer);
+		Unmap(m_Input);
+		Unmap(m_Output);
+		FreeBuffers();
+
+		// Reset information
+		m_Information = StreamInformation{};
+		State(Closed);
+		return _wasOpen ? NoError : NotOpen;
+	}
+
+	Error SharedMemoryApi::SampleRate(double)
+	{
+		if (State() == Closed)
+			return NotOpen;
+
+		// The rate is a property of the segment
+		return Fail;
+	}
+
+	const DeviceInfo<SharedMemory>* SharedMemoryApi::DeviceById(int id) const
+	{
+		return m_Devices->Find(id);
+	}
+
+	Error SharedMemoryApi::Map(const std::string& name, Segment& segment)
+	{
+		std::string _path = "/" + std::string{ SegmentPrefix } + name;
+		int _fd = shm_open(_path.c_str(), O_RDWR, 0);
+		if (_fd == -1)
+			return NotPresent;
+
+		struct stat _stat;
+		if (fstat(_fd, &_stat) == -1 || (std::size_t)_stat.st_size < sizeof(SharedMemoryHeader))
+		{
+			close(_fd);
+			return NotPresent;
+		}
+
+		void* _memory = mmap(nullptr, _stat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+		close(_fd);
+		if (_memory == MAP_FAILED)
+			return NoMemory;
+
+		// Make sure the segment is fully initialized and made by a compatible version
+		auto _header = (SharedMemoryHeader*)_memory;
+		if (_header->magic.load(std::memory_order_acquire) != SharedMemoryHeader::Magic
+			|| _header->version != SharedMemoryHeader::Version
+			|| (std::size_t)_stat.st_size < Align(sizeof(SharedMemoryHeader)) + _header->stride * _header->channels * _header->periods)
+		{
+			munmap(_memory, _stat.st_size);
+			return NotPresent;
+		}
+
+		segment.header = _header;
+		segment.data = (char*)_memory + Align(sizeof(SharedMemoryHeader));
+		segment.size = _stat.st_size;
+		return NoError;
+	}
+
+	void SharedMemoryApi::Unmap(Segment& segment)
+	{
+		if (segment.header)
+			munmap(segment.header, segment.size);
+		segment = Segment{};
+	}
+
+	void SharedMemoryApi::Run()
+	{
+		ApplyThreadConfiguration();
+
+		int _nInChannels = m_Information.inputChannels;
+		int _nOutChannels = m_Information.outputChannels;
+		int _bufferSize = m_Information.bufferSize;
+		auto _input = m_Input.header;
+		auto _output = m_Output.header;
+
+		while (State() != Stopping)
+		{
+			// Wait for a period in the input ring and for space in the output ring, Stop wakes us up too
+			TraceBegin("Wait");
+			bool _inputLate = false, _outputLate = false;
+			bool _ready = (!_input || Wait(_input->dataFutex, _input->dataWaiting, [&]() { return State() == Stopping
+					|| _input->writeIndex.load(std::memory_order_acquire) != _input->readIndex.load(std::memory_order_relaxed); }, _inputLate))
+				&& (!_output || Wait(_output->spaceFutex, _output->spaceWaiting, [&]() { return State() == Stopping
+					|| _output->writeIndex.load(std::memory_order_relaxed) - _output->readIndex.load(std::memory_order_acquire) < (uint64_t)_output->periods; }, _outputLate));
+			TraceEnd();
+
+			// The peer stalled or died. Its input never reached us, and the output ring stays
+			// full, so nothing we produce gets played until it comes back.
+			if (!_ready && State() != Stopping)
+			{
+				if (_inputLate)
+					ReportXrun(InputOverrun, _bufferSize);
+				if (_outputLate)
+					ReportXrun(OutputUnderrun, _bufferSize);
+			}
+
+			if (!_ready)
+				continue;
+
+			if (State() == Stopping)
+				break;
+
+			// The callback works on the period in the ring itself
+			uint64_t _read = _input ? _input->readIndex.load(std::memory_order_relaxed) : 0;
+			uint64_t _write = _output ? _output->writeIndex.load(std::memory_order_relaxed) : 0;
+			for (int i = 0; i < _nInChannels; i++)
+				m_DeviceInputs[i] = m_Input.Channel(_read, i);
+			for (int i = 0; i < _nOutChannels; i++)
+				m_DeviceOutputs[i] = m_Output.Channel(_write, i);
+
+			Process(m_DeviceInputs.data(), m_DeviceOutputs.data(), _bufferSize);
+
+			// Hand the periods over to the other side
+			if (_input)
+			{
+				_input->readIndex.store(_read + 1, std::memory_order_release);
+				FutexWake(_input->spaceFutex, _input->spaceWaiting);
+			}
+
+			if (_output)
+			{
+				_output->writeIndex.store(_write + 1, std::memory_order_release);
+				FutexWake(_output->dataFutex, _output->dataWaiting);
+			}
+		}
+	}
+}
+#endif
@@ -0,0 +1,83 @@
+#include "Audijo/Statistics.hpp"
+
+namespace Audijo
+{
+	Histogram::Histogram(double min, double max)
+		: m_Min(min), m_Scale(Divisions), m_Size((int)std::ceil(std::log2(max / min) * Divisions) + 1),
+		m_Buckets(std::make_unique<std::atomic<uint64_t>[]>(m_Size))
+	{
+		Clear();
+	}
+
+	void Histogram::Add(double value)
+	{
+		// Single writer, plain stores are enough for readers to see consistent values
+		int _bucket = value <= m_Min ? 0 : std::min((int)(std::log2(value / m_Min) * m_Scale) + 1, m_Size - 1);
+		auto _increment = [](std::atomic<uint64_t>& counter) {
+			counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		};
+
+		uint64_t _count = m_Count.load(std::memory_order_relaxed);
+		if (_count == 0 || value < m_Smallest.load(std::memory_order_relaxed))
+			m_Smallest.store(value, std::memory_order_relaxed);
+		if (_count == 0 || value > m_Largest.load(std::memory_order_relaxed))
+			m_Largest.store(value, std::memory_order_relaxed);
+		m_Sum.store(m_Sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		_increment(m_Buckets[_bucket]);
+
+		// Published last, a snapshot never counts more values than it sees in the buckets
+		m_Count.store(_count + 1, std::memory_order_release);
+	}
+
+	void Histogram::Clear()
+	{
+		m_Count.store(0, std::memory_order_release);
+		for (int i = 0; i < m_Size; i++)
+			m_Buckets[i].store(0, std::memory_order_relaxed);
+		m_Sum.store(0, std::memory_order_relaxed);
+		m_Smallest.store(0, std::memory_order_relaxed);
+		m_Largest.store(0, std::memory_order_relaxed);
+	}
+
+	Measurement Histogram::Snapshot() const
+	{
+		Measurement _measurement;
+		_measurement.count = m_Count.load(std::memory_order_acquire);
+		if (_measurement.count == 0)
+			return _measurement;
+
+		_measurement.min = m_Smallest.load(std::memory_order_relaxed);
+		_measurement.max = m_Largest.load(std::memory_order_relaxed);
+		_measurement.average = m_Sum.load(std::memory_order_relaxed) / _measurement.count;
+
+		// Upper edge of the bucket the 99th percentile falls in, within what was actually seen
+		uint64_t _rank = (uint64_t)std::ceil(0.99 * _measurement.count);
+		uint64_t _seen = 0;
+		int _bucket = 0;
+		for (; _bucket < m_Size - 1; _bucket++)
+			if ((_seen += m_Buckets[_bucket].load(std::memory_order_relaxed)) >= _rank)
+				break;
+
+		double _edge = m_Min * std::exp2(_bucket / m_Scale);
+		_measurement.p99 = std::clamp(_edge, _measurement.min, _measurement.max);
+		return _measurement;
+	}
+
+	PeriodTimer::PeriodTimer()
+#ifdef AUDIJO_STATISTICS
+		// Stages from 100ns to 10s, load from 0.01% to 10000%
+		: m_Stages{ { 1e-7, 10 }, { 1e-7, 10 }, { 1e-7, 10 }, { 1e-7, 10 } }, m_Load{ 1e-2, 1e4 }
+#endif
+	{}
+
+	StreamStatistics PeriodTimer::Snapshot() const
+	{
+		StreamStatistics _statistics;
+#ifdef AUDIJO_STATISTICS
+		for (int i = 0; i < StageAmount; i++)
+			_statistics.stages[i] = m_Stages[i].Snapshot();
+		_statistics.load = m_Load.Snapshot();
+#endif
+		return _statistics;
+	}
+}
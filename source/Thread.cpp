@@ -0,0 +1,316 @@
+#include "Audijo/Thread.hpp"
+#include "Audijo/Trace.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define AUDIJO_PAUSE() _mm_pause()
+#else
+#define AUDIJO_PAUSE() std::this_thread::yield()
+#endif
+
+namespace Audijo
+{
+	/**
+	 * Touch the given amount of stack, so the pages are mapped before the audio thread needs them.
+	 * @param bytes amount of bytes
+	 */
+	static void PrefaultStack(std::size_t bytes)
+	{
+		volatile char _page[4096];
+		for (std::size_t i = 0; i < sizeof(_page); i += 64)
+			_page[i] = 0;
+
+		if (bytes > sizeof(_page))
+			PrefaultStack(bytes - sizeof(_page));
+
+		_page[0]; // Keeps the recursive call from becoming a tail call
+	}
+
+	ThreadStatus ConfigureThread(const ThreadParameters& parameters, ThreadPolicy policy, double period)
+	{
+		auto& _thread = parameters;
+		ThreadStatus _status;
+		ThreadPolicy _policy = policy;
+
+#ifdef __linux__
+		if (_policy == FifoPolicy)
+		{
+			sched_param _param{};
+			_param.sched_priority = std::clamp(_thread.priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+			_status.policy = pthread_setschedparam(pthread_self(), SCHED_FIFO, &_param) == 0 ? Applied : Failed;
+		}
+		else if (_policy == DeadlinePolicy)
+			_status.policy = ConfigureDeadline(period);
+
+		if (!_thread.affinity.empty())
+		{
+			cpu_set_t _set;
+			CPU_ZERO(&_set);
+			for (int _cpu : _thread.affinity)
+				if (_cpu >= 0 && _cpu < CPU_SETSIZE)
+					CPU_SET(_cpu, &_set);
+			_status.affinity = pthread_setaffinity_np(pthread_self(), sizeof(_set), &_set) == 0 ? Applied : Failed;
+		}
+
+		if (_thread.lockMemory)
+			_status.lockMemory = mlockall(MCL_CURRENT | MCL_FUTURE) == 0 ? Applied : Failed;
+#elif defined(_WIN32)
+		if (_policy == FifoPolicy)
+		{
+			bool _success = false;
+			HMODULE AvrtDll = LoadLibraryW(L"AVRT.dll");
+			if (AvrtDll) {
+				typedef HANDLE(__stdcall* TAvSetMmThreadCharacteristicsPtr)(LPCWSTR TaskName, LPDWORD TaskIndex);
+				DWORD taskIndex = 0;
+				TAvSetMmThreadCharacteristicsPtr AvSetMmThreadCharacteristicsPtr =
+					(TAvSetMmThreadCharacteristicsPtr)(void(*)()) GetProcAddress(AvrtDll, "AvSetMmThreadCharacteristicsW");
+				_success = AvSetMmThreadCharacteristicsPtr && AvSetMmThreadCharacteristicsPtr(L"Pro Audio", &taskIndex);
+				FreeLibrary(AvrtDll);
+			}
+			_success |= SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+			_status.policy = _success ? Applied : Failed;
+		}
+		else if (_policy == DeadlinePolicy)
+			_status.policy = ConfigureDeadline(period);
+
+		if (!_thread.affinity.empty())
+		{
+			DWORD_PTR _mask = 0;
+			for (int _cpu : _thread.affinity)
+				if (_cpu >= 0 && _cpu < sizeof(DWORD_PTR) * 8)
+					_mask |= (DWORD_PTR)1 << _cpu;
+			_status.affinity = SetThreadAffinityMask(GetCurrentThread(), _mask) != 0 ? Applied : Failed;
+		}
+
+		// Windows can only lock explicit ranges, not the whole process
+		if (_thread.lockMemory)
+			_status.lockMemory = Failed;
+#else
+		if (_policy == FifoPolicy || _policy == DeadlinePolicy)
+			_status.policy = Failed;
+		if (!_thread.affinity.empty())
+			_status.affinity = Failed;
+		if (_thread.lockMemory)
+			_status.lockMemory = Failed;
+#endif
+
+		if (_thread.prefaultStack > 0)
+		{
+			PrefaultStack(_thread.prefaultStack);
+			_status.prefaultStack = Applied;
+		}
+
+		return _status;
+	}
+
+	ThreadSetting ConfigureDeadline(double period)
+	{
+#ifdef __linux__
+		// glibc has no wrapper for sched_setattr
+		struct
+		{
+			uint32_t size;
+			uint32_t policy;
+			uint64_t flags;
+			int32_t nice;
+			uint32_t priority;
+			uint64_t runtime;
+			uint64_t deadline;
+			uint64_t period;
+		} _attr{};
+
+		// Reserve half of every period for processing
+		uint64_t _period = (uint64_t)(1e9 * period);
+		_attr.size = sizeof(_attr);
+		_attr.policy = 6; // SCHED_DEADLINE
+		_attr.runtime = _period / 2;
+		_attr.deadline = _period;
+		_attr.period = _period;
+		return _period > 0 && syscall(SYS_sched_setattr, 0, &_attr, 0) == 0 ? Applied : Failed;
+#else
+		return Failed;
+#endif
+	}
+
+
+	WorkerGroup::WorkerGroup(const std::vector<int>& cpus)
+		: m_Cpus(cpus)
+	{
+		for (std::size_t i = 0; i < cpus.size(); i++)
+			m_Threads.emplace_back([this, i]() { Work(i); });
+	}
+
+	WorkerGroup::~WorkerGroup()
+	{
+		m_Running = false;
+		m_Generation.fetch_add(1, std::memory_order_release);
+		m_Generation.notify_all();
+		for (auto& _thread : m_Threads)
+			_thread.join();
+	}
+
+	void WorkerGroup::Configure(const ThreadParameters& parameters, ThreadPolicy policy, double period)
+	{
+		m_Parameters = parameters;
+		m_Parameters.lockMemory = false; // Process wide, the audio thread already did it
+		m_Policy = policy;
+		m_Period = period;
+		m_Configuration.fetch_add(1, std::memory_order_release);
+	}
+
+	void WorkerGroup::Period(double period)
+	{
+		m_Period.store(period, std::memory_order_relaxed);
+		m_Configuration.fetch_add(1, std::memory_order_release);
+	}
+
+	void WorkerGroup::Run(Job job, void* context)
+	{
+		m_Job = job;
+		m_Context = context;
+		m_Pending.store(m_Threads.size(), std::memory_order_relaxed);
+		m_Generation.fetch_add(1, std::memory_order_release);
+		m_Generation.notify_all();
+
+		job(context, 0);
+
+		// Barrier, spin first since the workers are most likely almost done
+		TraceScope _trace{ "Join" };
+		uint32_t _pending;
+		for (int i = 0; i < SpinCount && m_Pending.load(std::memory_order_acquire) != 0; i++)
+			AUDIJO_PAUSE();
+		while ((_pending = m_Pending.load(std::memory_order_acquire)) != 0)
+			m_Pending.wait(_pending, std::memory_order_acquire);
+	}
+
+	void WorkerGroup::Work(int index)
+	{
+		uint32_t _generation = 0;
+		uint32_t _configuration = 0;
+		TraceThread("Worker");
+		while (true)
+		{
+			// Wait for the next job
+			for (int i = 0; i < SpinCount && m_Generation.load(std::memory_order_acquire) == _generation; i++)
+				AUDIJO_PAUSE();
+			while (m_Generation.load(std::memory_order_acquire) == _generation)
+				m_Generation.wait(_generation, std::memory_order_acquire);
+
+			_generation = m_Generation.load(std::memory_order_acquire);
+			if (!m_Running)
+				return;
+
+			uint32_t _latest = m_Configuration.load(std::memory_order_acquire);
+			if (_latest != _configuration)
+			{
+				_configuration = _latest;
+				ThreadParameters _parameters = m_Parameters;
+				if (m_Cpus[index] >= 0)
+					_parameters.affinity = { m_Cpus[index] };
+				ConfigureThread(_parameters, m_Policy, m_Period);
+			}
+
+			TraceBegin("Group", index + 1);
+			m_Job(m_Context, index + 1);
+			TraceEnd();
+
+			if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				m_Pending.notify_one();
+		}
+	}
+
+	Pipeline::Pipeline(int slots, Job job, void* context)
+		: m_Slots(std::max(slots, 2)), m_Job(job), m_Context(context),
+		m_States(new std::atomic<uint32_t>[m_Slots]{}), m_Queue(new int[m_Slots]{})
+	{
+		m_Thread = std::thread{ [this]() { Work(); } };
+	}
+
+	Pipeline::~Pipeline()
+	{
+		m_Running = false;
+		m_Submitted.fetch_add(1, std::memory_order_release);
+		m_Submitted.notify_one();
+		m_Thread.join();
+	}
+
+	void Pipeline::Configure(const ThreadParameters& parameters, ThreadPolicy policy, double period)
+	{
+		std::lock_guard _lock{ m_ConfigurationMutex };
+		m_Parameters = parameters;
+		m_Parameters.lockMemory = false; // Process wide, the audio thread already did it
+		m_Policy = policy;
+		m_Period = period;
+		m_Configuration.fetch_add(1, std::memory_order_release);
+	}
+
+	void Pipeline::Period(double period)
+	{
+		m_Period.store(period, std::memory_order_relaxed);
+		m_Configuration.fetch_add(1, std::memory_order_release);
+	}
+
+	bool Pipeline::Acquire(int slot)
+	{
+		uint32_t _state = m_States[slot].load(std::memory_order_acquire);
+		if (_state != Free && _state != Done)
+			return false;
+
+		m_States[slot].store(Filling, std::memory_order_relaxed);
+		return true;
+	}
+
+	void Pipeline::Submit(int slot)
+	{
+		// At most every slot is queued at once, so the queue never overwrites one the worker didn't take yet
+		uint32_t _submitted = m_Submitted.load(std::memory_order_relaxed);
+		m_Queue[_submitted % m_Slots] = slot;
+		m_States[slot].store(Queued, std::memory_order_relaxed);
+		m_Submitted.store(_submitted + 1, std::memory_order_release);
+		m_Submitted.notify_one();
+	}
+
+	bool Pipeline::Collect(int slot)
+	{
+		if (m_States[slot].load(std::memory_order_acquire) != Done)
+			return false;
+
+		m_States[slot].store(Free, std::memory_order_relaxed);
+		return true;
+	}
+
+	void Pipeline::Work()
+	{
+		uint32_t _processed = 0;
+		uint32_t _configuration = 0;
+		TraceThread("Pipeline");
+		while (true)
+		{
+			uint32_t _submitted = m_Submitted.load(std::memory_order_acquire);
+			if (!m_Running)
+				return;
+
+			if (_submitted == _processed)
+			{
+				m_Submitted.wait(_submitted, std::memory_order_acquire);
+				continue;
+			}
+
+			uint32_t _latest = m_Configuration.load(std::memory_order_acquire);
+			if (_latest != _configuration)
+			{
+				std::lock_guard _lock{ m_ConfigurationMutex };
+				_configuration = m_Configuration.load(std::memory_order_relaxed);
+				ConfigureThread(m_Parameters, m_Policy, m_Period);
+			}
+
+			int _slot = m_Queue[_processed % m_Slots];
+			TraceBegin("Pipeline", _slot);
+			m_Job(m_Context, _slot);
+			TraceEnd();
+
+			m_States[_slot].store(Done, std::memory_order_release);
+			_processed++;
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#include "Audijo/ThreadPool.hpp"
+
+namespace Audijo
+{
+	ThreadPool::ThreadPool(int threads)
+	{
+		for (int i = 0; i < threads; i++)
+			m_Threads.emplace_back([this]() { Work(); });
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard _lock{ m_Mutex };
+			m_Running = false;
+		}
+
+		// Workers finish the tasks that are left before they exit
+		m_Condition.notify_all();
+		for (auto& _thread : m_Threads)
+			_thread.join();
+	}
+
+	void ThreadPool::Enqueue(std::function<void()>&& task)
+	{
+		{
+			std::lock_guard _lock{ m_Mutex };
+			m_Tasks.push_back(std::move(task));
+		}
+		m_Condition.notify_one();
+	}
+
+	void ThreadPool::Work()
+	{
+		while (true)
+		{
+			std::function<void()> _task;
+			{
+				std::unique_lock _lock{ m_Mutex };
+				m_Condition.wait(_lock, [this]() { return !m_Tasks.empty() || !m_Running; });
+				if (m_Tasks.empty())
+					return;
+
+				_task = std::move(m_Tasks.front());
+				m_Tasks.pop_front();
+			}
+			_task();
+		}
+	}
+}
@@ -0,0 +1,230 @@
+#include "Audijo/Trace.hpp"
+
+namespace Audijo
+{
+	/**
+	 * Events of a single thread, the thread writes and the flusher reads.
+	 */
+	struct TraceBuffer
+	{
+		std::unique_ptr<TraceEvent[]> events = std::make_unique<TraceEvent[]>(Tracer::BufferSize);
+		alignas(64) std::atomic<std::size_t> write = 0;
+		alignas(64) std::atomic<std::size_t> read = 0;
+		std::atomic<uint64_t> dropped = 0;
+		std::atomic<bool> used = false;          // Owned by a running thread
+		std::atomic<const char*> name = nullptr; // Name of the owning thread
+		int id = 0;                              // Thread id in the trace
+	};
+
+	/**
+	 * Everything shared by the tracing threads and the flusher.
+	 */
+	struct TraceState
+	{
+		std::mutex mutex; // Guards everything but the contents of the buffers
+		std::vector<std::unique_ptr<TraceBuffer>> buffers;
+		int threads = 0;  // Amount of thread ids handed out
+
+		std::FILE* file = nullptr;
+		bool first = true;  // No separator before the first event
+		uint64_t start = 0; // Time of the start of the trace
+
+		std::thread flusher;
+		std::condition_variable wake;
+		bool running = false;
+
+		~TraceState();
+	};
+
+	static TraceState& State()
+	{
+		static TraceState _state;
+		return _state;
+	}
+
+	/**
+	 * Releases the buffer of a thread when it exits, so the next thread can use it.
+	 */
+	struct TraceOwner
+	{
+		TraceBuffer* buffer = nullptr;
+		~TraceOwner() { if (buffer) buffer->used.store(false, std::memory_order_release); }
+	};
+
+	static thread_local TraceOwner t_Thread;
+
+	static TraceBuffer* Acquire()
+	{
+		if (t_Thread.buffer)
+			return t_Thread.buffer;
+
+		auto& _state = State();
+		std::lock_guard _lock{ _state.mutex };
+
+		TraceBuffer* _buffer = nullptr;
+		for (auto& _candidate : _state.buffers)
+			if (!_candidate->used.exchange(true, std::memory_order_acquire))
+			{
+				_buffer = _candidate.get();
+				break;
+			}
+
+		if (!_buffer)
+		{
+			_buffer = _state.buffers.emplace_back(std::make_unique<TraceBuffer>()).get();
+			_buffer->used.store(true, std::memory_order_relaxed);
+		}
+
+		_buffer->id = ++_state.threads;
+		_buffer->name.store(nullptr, std::memory_order_relaxed);
+		t_Thread.buffer = _buffer;
+		return _buffer;
+	}
+
+	static uint64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * Write everything that was recorded to the file, called with the mutex locked.
+	 */
+	static void Flush(TraceState& state)
+	{
+		auto _separator = [&]() {
+			if (!state.first)
+				std::fputs(",\n", state.file);
+			state.first = false;
+		};
+
+		for (auto& _buffer : state.buffers)
+		{
+			std::size_t _read = _buffer->read.load(std::memory_order_relaxed);
+			std::size_t _write = _buffer->write.load(std::memory_order_acquire);
+			for (; _read != _write; _read++)
+			{
+				auto& _event = _buffer->events[_read % Tracer::BufferSize];
+
+				// Left over from before the trace started
+				if (_event.time < state.start)
+					continue;
+
+				double _time = (_event.time - state.start) * 1e-3;
+				_separator();
+				if (_event.phase == 'E')
+					std::fprintf(state.file, R"({"ph":"E","ts":%.3f,"pid":1,"tid":%d})", _time, _buffer->id);
+				else
+					std::fprintf(state.file, R"({"name":"%s","ph":"%c",%s"ts":%.3f,"pid":1,"tid":%d,"args":{"value":%lld}})",
+						_event.name, _event.phase, _event.phase == 'i' ? R"("s":"t",)" : "", _time, _buffer->id, (long long)_event.arg);
+			}
+			_buffer->read.store(_read, std::memory_order_release);
+
+			// Show where events went missing
+			if (uint64_t _dropped = _buffer->dropped.exchange(0, std::memory_order_relaxed))
+			{
+				_separator();
+				std::fprintf(state.file, R"({"name":"Dropped events","ph":"i","s":"t","ts":%.3f,"pid":1,"tid":%d,"args":{"value":%llu}})",
+					(Now() - state.start) * 1e-3, _buffer->id, (unsigned long long)_dropped);
+			}
+		}
+	}
+
+	/**
+	 * Stop the flusher and finish the file.
+	 */
+	static void Finish(TraceState& state)
+	{
+		{
+			std::lock_guard _lock{ state.mutex };
+			if (!state.running)
+				return;
+
+			state.running = false;
+		}
+
+		state.wake.notify_one();
+		state.flusher.join();
+
+		std::lock_guard _lock{ state.mutex };
+		Flush(state);
+
+		// Names of the threads
+		for (auto& _buffer : state.buffers)
+			if (auto _name = _buffer->name.load(std::memory_order_relaxed))
+			{
+				std::fputs(state.first ? "" : ",\n", state.file);
+				state.first = false;
+				std::fprintf(state.file, R"({"name":"thread_name","ph":"M","pid":1,"tid":%d,"args":{"name":"%s"}})", _buffer->id, _name);
+			}
+
+		std::fputs("\n]}\n", state.file);
+		std::fclose(state.file);
+		state.file = nullptr;
+	}
+
+	// A trace that's still running when the program exits gets finished
+	TraceState::~TraceState()
+	{
+		Finish(*this);
+	}
+
+	bool Tracer::Start(const std::string& path)
+	{
+		Stop();
+
+		auto& _state = State();
+		std::lock_guard _lock{ _state.mutex };
+		_state.file = std::fopen(path.c_str(), "wb");
+		if (!_state.file)
+			return false;
+
+		std::fputs("{\"traceEvents\":[\n", _state.file);
+		_state.first = true;
+		_state.start = Now();
+
+		// Forget what's left from an earlier trace
+		for (auto& _buffer : _state.buffers)
+		{
+			_buffer->read.store(_buffer->write.load(std::memory_order_acquire), std::memory_order_release);
+			_buffer->dropped.store(0, std::memory_order_relaxed);
+		}
+
+		_state.running = true;
+		_state.flusher = std::thread{ [&_state]() {
+			std::unique_lock _lock{ _state.mutex };
+			while (_state.running)
+			{
+				_state.wake.wait_for(_lock, std::chrono::milliseconds(20));
+				Flush(_state);
+			}
+		} };
+
+		m_Enabled.store(true, std::memory_order_relaxed);
+		return true;
+	}
+
+	void Tracer::Stop()
+	{
+		m_Enabled.store(false, std::memory_order_relaxed);
+		Finish(State());
+	}
+
+	void Tracer::Thread(const char* name)
+	{
+		Acquire()->name.store(name, std::memory_order_relaxed);
+	}
+
+	void Tracer::Write(char phase, const char* name, int64_t arg)
+	{
+		auto _buffer = Acquire();
+		std::size_t _write = _buffer->write.load(std::memory_order_relaxed);
+		if (_write - _buffer->read.load(std::memory_order_acquire) >= BufferSize)
+		{
+			_buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		_buffer->events[_write % BufferSize] = TraceEvent{ Now(), name, arg, phase };
+		_buffer->write.store(_write + 1, std::memory_order_release);
+	}
+}
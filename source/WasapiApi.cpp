@@ -5,6 +5,9 @@
 namespace Audijo
 {
 #define CHECK(x, msg, type) if (FAILED(x)) { LOGL(msg); type; }
+// CHECK for the audio thread, logs without formatting or locking and notifies that the stream stopped
+#define RTCHECK(x, msg, type) if (HRESULT _result = x; FAILED(_result)) { RTLOG(::Audijo::LogError, msg " ({x})", (uint32_t)_result); \
+	Notify(_result == AUDCLNT_E_DEVICE_INVALIDATED ? DeviceLost : StreamFailed, (uint32_t)_result); type; }
 
 	WasapiApi::WasapiApi(bool loadDevices)
 		: ApiBase()
@@ -29,52 +32,41 @@ namespace Audijo
 	const std::vector<DeviceInfo<Wasapi>>& WasapiApi::Devices(bool reload)
 	{
 		if (!reload)
-			return m_Devices;
-
-		// Make a list of all numbers from 0 to amount of current devices
-		// this is used to determine if we need to delete devices from the list after querying.
-		std::vector<int> _toDelete;
-		for (int i = m_Devices.size() - 1; i >= 0; i--)
-			_toDelete.push_back(i);
-
-		// Get default devices
-		Pointer<IMMDevice> _defaultIn;
-		Pointer<IMMDevice> _defaultOut;
-		CHECK(m_DeviceEnumerator->GetDefaultAudioEndpoint(eCapture, eConsole, &_defaultIn), "Unable to retrieve the default input device");
-		CHECK(m_DeviceEnumerator->GetDefaultAudioEndpoint(eRender, eConsole, &_defaultOut), "Unable to retrieve the default output device");
-
-		// Open the property store of the device to retrieve the name
-		Pointer<IPropertyStore> _defaultInPropertyStore;
-		Pointer<IPropertyStore> _defaultOutPropertyStore;
-		CHECK(_defaultIn->OpenPropertyStore(STGM_READ, &_defaultInPropertyStore), "Unable to open default device property store.", return m_Devices);
-		CHECK(_defaultOut->OpenPropertyStore(STGM_READ, &_defaultOutPropertyStore), "Unable to open default device property store.", return m_Devices);
-
-		// Collect the name of the default input from the property store
-		char _defaultInNameArr[64];
-		char _defaultOutNameArr[64];
-		Pointer<PROPVARIANT> _defaultInDeviceNameProp = new PROPVARIANT;
-		Pointer<PROPVARIANT> _defaultOutDeviceNameProp = new PROPVARIANT;
-		PropVariantInit(_defaultInDeviceNameProp);
-		PropVariantInit(_defaultOutDeviceNameProp);
-		CHECK(_defaultInPropertyStore->GetValue(PKEY_Device_FriendlyName, _defaultInDeviceNameProp), "Unable to retrieve default device name.", return m_Devices);
-		CHECK(_defaultOutPropertyStore->GetValue(PKEY_Device_FriendlyName, _defaultOutDeviceNameProp), "Unable to retrieve default device name.", return m_Devices);
-		wcstombs(_defaultInNameArr, _defaultInDeviceNameProp->pwszVal, 64); // Copy the wstring to the char array
-		wcstombs(_defaultOutNameArr, _defaultOutDeviceNameProp->pwszVal, 64); // Copy the wstring to the char array
-		std::string _defaultInName = _defaultInNameArr;
-		std::string _defaultOutName = _defaultOutNameArr;
+			return m_Devices->devices;
+
+		// Get the endpoint ids of the default devices, there might be none
+		std::string _defaultIn, _defaultOut;
+		{
+			Pointer<IMMDevice> _device;
+			if (!FAILED(Enumerator()->GetDefaultAudioEndpoint(eCapture, eConsole, &_device)))
+				_defaultIn = EndpointId(_device);
+		}
+		{
+			Pointer<IMMDevice> _device;
+			if (!FAILED(Enumerator()->GetDefaultAudioEndpoint(eRender, eConsole, &_device)))
+				_defaultOut = EndpointId(_device);
+		}
 
 		// Count devices
 		unsigned int _count = 0;
-		m_WasapiDevices.Release();
-		CHECK(m_DeviceEnumerator->EnumAudioEndpoints(eAll, DEVICE_STATE_ACTIVE, &m_WasapiDevices), "Unable to retrieve device collection.", return m_Devices);
-		CHECK(m_WasapiDevices->GetCount(&_count), "Unable to retrieve device count.", return m_Devices);
+		Pointer<IMMDeviceCollection> _collection;
+		CHECK(Enumerator()->EnumAudioEndpoints(eAll, DEVICE_STATE_ACTIVE, &_collection), "Unable to retrieve device collection.", return m_Devices->devices);
+		CHECK(_collection->GetCount(&_count), "Unable to retrieve device count.", return m_Devices->devices);
 		
 		// Go through all devices
+		auto _known = m_Registry.Read();
+		std::vector<std::pair<std::string, DeviceInfo<Wasapi>>> _devices;
+		std::vector<EDataFlow> _flows;
 		for (int i = 0; i < _count; i++)
 		{
 			// First get the device from the device collection
 			Pointer<IMMDevice> _dev;
-			CHECK(m_WasapiDevices->Item(i, &_dev), "Unable to retrieve device handle.", continue);
+			CHECK(_collection->Item(i, &_dev), "Unable to retrieve device handle.", continue);
+
+			// The endpoint id stays the same when the device is unplugged and plugged back in
+			std::string _endpoint = EndpointId(_dev);
+			if (_endpoint.empty())
+				continue;
 
 			// Open the property store of the device to retrieve the name
 			Pointer<IPropertyStore> _propertyStore;
@@ -88,87 +80,76 @@ namespace Audijo
 			wcstombs(_nameArr, _deviceNameProp->pwszVal, 64); // Copy the wstring to the char array
 			std::string _name = _nameArr;
 
-			// Get the audio client from the device
-			Pointer<IAudioClient> _audioClient;
-			CHECK(_dev->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void**)&_audioClient), "Unable to retrieve device audio client.", continue);
-
-			// Get the device mix format using the audio client
-			Pointer<WAVEFORMATEX> _format;
-			CHECK(_audioClient->GetMixFormat(&_format), "Unable to retrieve device mix format.", continue);
-
 			// Get the endpoint object to retrieve the device type
-			Pointer<IMMEndpoint> _endpoint;
-			CHECK(_dev->QueryInterface(__uuidof(IMMEndpoint), (void**)&_endpoint), "Unable to retrieve the endpoint object", continue);
+			Pointer<IMMEndpoint> _endpointObject;
+			CHECK(_dev->QueryInterface(__uuidof(IMMEndpoint), (void**)&_endpointObject), "Unable to retrieve the endpoint object", continue);
 			EDataFlow _deviceType;
-			CHECK(_endpoint->GetDataFlow(&_deviceType), "Unable to get the device type", continue);
+			CHECK(_endpointObject->GetDataFlow(&_deviceType), "Unable to get the device type", continue);
 
-			// Set channel count given the device type
-			int _in = 0, _out = 0;
-			switch(_deviceType) {
-			case eAll: _out = _in = _format->nChannels; break;
-			case eRender: _out = _format->nChannels; break;
-			case eCapture: _in = _format->nChannels; break;
-			}
-
-			// Is it a default device? Use device name to check
-			bool _default = (_name == _defaultInName && _in > 0) || (_name == _defaultOutName && _out > 0);
+			// Is it a default device?
+			bool _default = (_endpoint == _defaultIn && _deviceType != eRender) || (_endpoint == _defaultOut && _deviceType != eCapture);
 
-			// Wasapi only supports single sample rate
-			std::vector<double> _srates;
-			_srates.push_back(_format->nSamplesPerSec);
-
-			// Edit an existing device, or if doesn't exist, just add new device.
-			bool _found = false;
-			int _index = 0;
-			for (auto& _device : m_Devices)
+			// Activating the audio client for the mix format is slow, so that's probed in the background.
+			// Until then a device that was probed before keeps its capabilities.
+			DeviceInfo<Wasapi> _device{ { NoDevice, _name, 0, 0, {}, _default, Wasapi, false } };
+			if (auto _probed = _known->FindKey(_endpoint); _probed && _probed->probed)
 			{
-				if (_device.name == _name && _device.id == i)
-				{
-					_found = true;
-					_device.id = i;
-					_device.inputChannels = _in;
-					_device.outputChannels = _out;
-					_device.sampleRates = _srates;
-					_device.defaultDevice = _default;
-
-					// Erase from the toDelete, since we've still found the device!
-					_toDelete.erase(std::find(_toDelete.begin(), _toDelete.end(), _index));
-					break;
-				}
-				_index++;
+				_device.inputChannels = _probed->inputChannels;
+				_device.outputChannels = _probed->outputChannels;
+				_device.sampleRates = _probed->sampleRates;
+				_device.probed = true;
 			}
-
-			if (!_found)
-				m_Devices.push_back(DeviceInfo<Wasapi>{ { i, _name, _in, _out, _srates, _default, Wasapi } });
+			_device.endpoint = _endpoint;
+			_devices.emplace_back(_endpoint, std::move(_device));
+			_flows.emplace_back(_deviceType);
 		}
 
-		// Delete all devices we couldn't find again.
-		for (auto& i : _toDelete)
-			m_Devices.erase(m_Devices.begin() + i);
+		std::vector<std::string> _endpoints;
+		for (auto& [_endpoint, _device] : _devices)
+			_endpoints.push_back(_endpoint);
+
+		// Only the devices that were added, removed or changed are updated
+		m_Registry.Update(std::move(_devices));
+		m_Devices = m_Registry.Read();
 
-		return m_Devices;
+		for (std::size_t i = 0; i < _endpoints.size(); i++)
+			m_Prober.Submit(_endpoints[i], [_flow = _flows[i]](DeviceInfo<Wasapi>& device) { return Probe(device, _flow); });
+
+		return m_Devices->devices;
 	}
 
 	Error WasapiApi::Open(const StreamParameters& settings)
 	{
-		if (m_Information.state != Closed)
+		if (State() != Closed)
 			return AlreadyOpen;
 
 		m_Information = settings;
 
+		// Capabilities might still be probed in the background
+		if (std::ranges::any_of(m_Devices->devices, [](auto& device) { return !device.probed; }))
+		{
+			m_Prober.Finished().wait();
+			m_Devices = m_Registry.Read();
+		}
+
 		// Check device ids
 		if (m_Information.input == Default)
-			for (auto& i : m_Devices)
+			for (auto& i : m_Devices->devices)
 				if (i.defaultDevice && i.inputChannels > 0)
 					m_Information.input = i.id;
 		if (m_Information.output == Default)
-			for (auto& i : m_Devices)
+			for (auto& i : m_Devices->devices)
 				if (i.defaultDevice && i.outputChannels > 0)
 					m_Information.output = i.id;
 		
+		auto _inDevice = m_Information.input == NoDevice ? nullptr : m_Devices->Find(m_Information.input);
+		auto _outDevice = m_Information.output == NoDevice ? nullptr : m_Devices->Find(m_Information.output);
+		if ((m_Information.input != NoDevice && _inDevice == nullptr) || (m_Information.output != NoDevice && _outDevice == nullptr))
+			return NotPresent;
+
 		// Set channel count
-		m_Information.inputChannels = m_Information.input == NoDevice ? 0 : m_Devices[m_Information.input].inputChannels;
-		m_Information.outputChannels = m_Information.output == NoDevice ? 0 : m_Devices[m_Information.output].outputChannels;
+		m_Information.inputChannels = _inDevice ? _inDevice->inputChannels : 0;
+		m_Information.outputChannels = _outDevice ? _outDevice->outputChannels : 0;
 
 		// Default buffersize is 256 because why not lol
 		if (m_Information.bufferSize == Default)
@@ -182,6 +163,7 @@ namespace Audijo
 		int _nChannels = _nInChannels + _nOutChannels;
 		int _bufferSize = m_Information.bufferSize;
 		int _sampleRate = m_Information.sampleRate;
+		int _deviceRate = 0; // Rate the device side of the stream runs at, the output device's if there is one
 
 		if (_inDeviceId != NoDevice)
 		{
@@ -189,7 +171,7 @@ namespace Audijo
 			m_InputDevice.Release();
 			m_InputClient.Release();
 			m_CaptureClient.Release();
-			CHECK(m_WasapiDevices->Item(_inDeviceId, &m_InputDevice), "Unable to retrieve device handle.", return NotPresent);
+			CHECK(Enumerator()->GetDevice(std::wstring{ _inDevice->endpoint.begin(), _inDevice->endpoint.end() }.c_str(), &m_InputDevice), "Unable to retrieve device handle.", return NotPresent);
 			CHECK(m_InputDevice->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void**)&m_InputClient), "Unable to retrieve device audio client.", return Fail);
 			CHECK(m_InputClient->GetMixFormat(&_inFormat), "Unable to retrieve device mix format.", return Fail);
 			CHECK(m_InputClient->Initialize(AUDCLNT_SHAREMODE_SHARED, 0, 10000000, 0, _inFormat, nullptr), "Unable to initialize the input client", return Fail);
@@ -206,6 +188,8 @@ namespace Audijo
 				return InvalidSampleRate;
 			}
 
+			_deviceRate = _inFormat->nSamplesPerSec;
+
 			// Set native sample format
 			if (_inFormat->wFormatTag == WAVE_FORMAT_IEEE_FLOAT || (_inFormat->wFormatTag == WAVE_FORMAT_EXTENSIBLE &&
 				((WAVEFORMATEXTENSIBLE*)_inFormat.get())->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT))
@@ -234,7 +218,7 @@ namespace Audijo
 			Pointer<WAVEFORMATEX> _outFormat;
 			m_OutputDevice.Release();
 			m_OutputClient.Release();
-			CHECK(m_WasapiDevices->Item(_outDeviceId, &m_OutputDevice), "Unable to retrieve device handle.", return NotPresent);
+			CHECK(Enumerator()->GetDevice(std::wstring{ _outDevice->endpoint.begin(), _outDevice->endpoint.end() }.c_str(), &m_OutputDevice), "Unable to retrieve device handle.", return NotPresent);
 			CHECK(m_OutputDevice->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void**)&m_OutputClient), "Unable to retrieve device audio client.", return Fail);
 			CHECK(m_OutputClient->GetMixFormat(&_outFormat), "Unable to retrieve device mix format.", return Fail);
 	
@@ -249,6 +233,8 @@ namespace Audijo
 				return _inDeviceId != NoDevice ? InvalidDuplex : InvalidSampleRate;
 			}
 
+			_deviceRate = _outFormat->nSamplesPerSec;
+
 			// Set native sample format
 			if (_outFormat->wFormatTag == WAVE_FORMAT_IEEE_FLOAT || (_outFormat->wFormatTag == WAVE_FORMAT_EXTENSIBLE &&
 				((WAVEFORMATEXTENSIBLE*)_outFormat.get())->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT))
@@ -284,50 +270,63 @@ namespace Audijo
 			return NoCallback;
 		}
 
+		// The shared mode mix format is fixed, another rate goes through the resampling stage
+		if (_deviceRate != _sampleRate)
+			m_Information.deviceSampleRate = _deviceRate;
+
 		// Allocate the user callback buffers
 		AllocateBuffers();
 
-		m_Information.state = Opened;
+		State(Opened);
 		return NoError;
 	}
 
 	Error WasapiApi::Start()
 	{
-		if (m_Information.state == Closed)
-			return NotOpen;
+		if (auto _error = BeginStart())
+			return _error;
 
-		if (m_Information.state == Running)
-			return AlreadyRunning;
+		// Signalled by Stop, so the audio thread never has to wait for the next device event
+		m_WakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		m_ThreadConfigured = false;
+
+		// Both devices run on their own clock, the input goes through a resampling bridge that is held
+		// at the buffer size plus two capture periods, so drift between them never drops samples.
+		m_Bridge.reset();
+		if (m_InputClient && m_OutputClient)
+		{
+			Pointer<WAVEFORMATEX> _inWaveFormat;
+			Pointer<WAVEFORMATEX> _outWaveFormat;
+			REFERENCE_TIME _period = 0;
+			if (SUCCEEDED(m_InputClient->GetMixFormat(&_inWaveFormat)) && SUCCEEDED(m_OutputClient->GetMixFormat(&_outWaveFormat))
+				&& SUCCEEDED(m_InputClient->GetDevicePeriod(&_period, nullptr)))
+			{
+				int _bufferSize = m_Information.bufferSize;
+				double _inRate = _inWaveFormat->nSamplesPerSec;
+				double _outRate = _outWaveFormat->nSamplesPerSec;
+				int _capturePeriod = (int)std::ceil(_period * _inRate / 10000000.);
+				m_Bridge = std::make_unique<DuplexBridge>(m_Information.inputChannels,
+					_bufferSize + 2 * _capturePeriod, _bufferSize, _outRate, _outRate / _inRate);
+			}
+		}
 
-		m_Information.state = Running;
 		m_AudioThread = std::thread{ [this]()
 			{
 				CHECK(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED), "Failed to CoInitialize thread.", return);
 
-				HMODULE AvrtDll = LoadLibraryW(L"AVRT.dll");
-				if (AvrtDll) {
-					typedef HANDLE(__stdcall* TAvSetMmThreadCharacteristicsPtr)(LPCWSTR TaskName, LPDWORD TaskIndex);
-					DWORD taskIndex = 0;
-					TAvSetMmThreadCharacteristicsPtr AvSetMmThreadCharacteristicsPtr =
-						(TAvSetMmThreadCharacteristicsPtr)(void(*)()) GetProcAddress(AvrtDll, "AvSetMmThreadCharacteristicsW");
-					AvSetMmThreadCharacteristicsPtr(L"Pro Audio", &taskIndex);
-					FreeLibrary(AvrtDll);
-				}
+				ApplyThreadConfiguration(FifoPolicy);
 
 				int _nInChannels = m_Information.inputChannels;
 				int _nOutChannels = m_Information.outputChannels;
 				int _bufferSize = m_Information.bufferSize;
-				auto _sampleRate = m_Information.sampleRate;
 				auto _deviceInFormat = m_Information.deviceInFormat;
 				auto _deviceOutFormat = m_Information.deviceOutFormat;
-				auto _inFormat = m_Information.inFormat;
-				auto _outFormat = m_Information.outFormat;
-				char** _inputs = m_InputBuffers;
-				char** _outputs = m_OutputBuffers;
 
 				auto _captureEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
 				auto _renderEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
-				HANDLE _events[2]{ _captureEvent, _renderEvent };
+				HANDLE _events[3]{ _captureEvent, _renderEvent, m_WakeEvent };
+				HANDLE _captureEvents[2]{ _captureEvent, m_WakeEvent };
+				HANDLE _renderEvents[2]{ _renderEvent, m_WakeEvent };
 
 				unsigned int _inputFramesAvailable = 0;
 				unsigned int _outputFramesAvailable = 0;
@@ -336,6 +335,7 @@ namespace Audijo
 				BYTE* _streamBuffer = nullptr;
 				bool _pulled = false;
 				bool _pushed = false;
+				bool _rendered = false; // Output reached the device, before that an empty device isn't an underrun
 
 				// Initialize input device
 				if (m_InputClient)
@@ -371,6 +371,14 @@ namespace Audijo
 				RingBuffer<char> _inRingBuffer{ (_bufferSize + _inputFramesAvailable) * _nInChannels * (_deviceInFormat & Bytes) };
 				RingBuffer<char> _outRingBuffer{ (_bufferSize + _outputFramesAvailable) * _nOutChannels * (_deviceOutFormat & Bytes) };
 
+				// Float buffers for the bridge, large enough for a whole capture buffer
+				int _captureFrames = std::max<int>(_inputFramesAvailable, _bufferSize);
+				std::vector<char> _captureBuff(_captureFrames * (_deviceInFormat & Bytes));
+				std::vector<std::vector<float>> _bridgeBuff(_nInChannels, std::vector<float>(_captureFrames));
+				std::vector<float*> _bridgeChannels(_nInChannels);
+				for (int i = 0; i < _nInChannels; i++)
+					_bridgeChannels[i] = _bridgeBuff[i].data();
+
 				// Create temporary buffers
 				char** _tempInBuff = new char* [_nInChannels];
 				for (int i = 0; i < _nInChannels; i++)
@@ -381,13 +389,24 @@ namespace Audijo
 					_tempOutBuff[i] = new char[_bufferSize * (_deviceOutFormat & Bytes)];
 
 				// Start loop
-				while (m_Information.state == Running)
+				while (State() != Stopping)
 				{
 					// If not pulled from input buffer
 					if (!_pulled)
 					{
+						// Input arrives through the bridge, it always has a full buffer on the output clock
+						if (m_Bridge)
+						{
+							if (!m_Bridge->Read(_bridgeChannels.data(), _bufferSize))
+								ReportXrun(InputUnderrun, _bufferSize);
+							for (int j = 0; j < _nInChannels; j++)
+								ConvertBuffer(_tempInBuff[j], (char*)_bridgeChannels[j], _bufferSize, _deviceInFormat, Float32);
+
+							_pulled = true;
+						}
+
 						// If there is an input device, pull from ring buffer
-						if (m_InputClient)
+						else if (m_InputClient)
 						{
 							// Only pull if the ring buffer contains enough samples to fill the user buffer
 							if (_inRingBuffer.Size() >= _bufferSize * _nInChannels * (_deviceInFormat & Bytes))
@@ -398,10 +417,6 @@ namespace Audijo
 										for (int k = 0; k < (_deviceInFormat & Bytes); k++)
 											_tempInBuff[j][i * (_deviceInFormat & Bytes) + k] = _inRingBuffer.Dequeue();
 
-								// Convert to the right format
-								for (int j = 0; j < _nInChannels; j++)
-									ConvertBuffer(_inputs[j], _tempInBuff[j], _bufferSize, _inFormat, _deviceInFormat);
-
 								_pulled = true;
 							}
 						}
@@ -410,10 +425,10 @@ namespace Audijo
 						else
 							_pulled = true;
 						
-						// If data pull from input ring buffer was successful, we can call the callback with the data. 
+						// If data pull from input ring buffer was successful, we can process the period, 
+						// this leaves the output in the device format in the temporary output buffers.
 						if (_pulled)
-							m_Callback->Call((void**)_inputs, (void**)_outputs, 
-								CallbackInfo{ _nInChannels, _nOutChannels, _bufferSize, _sampleRate }, m_UserData);
+							Process(_tempInBuff, _tempOutBuff, _bufferSize);
 					}
 
 					// If we've pull, it means the callback was called, so we need to handle the user output buffer
@@ -421,11 +436,7 @@ namespace Audijo
 					{
 						if (_outRingBuffer.Space() >= _bufferSize * _nOutChannels * (_deviceOutFormat & Bytes))
 						{
-							// First convert to the right format
-							for (int j = 0; j < _nOutChannels; j++)
-								ConvertBuffer(_tempOutBuff[j], _outputs[j], _bufferSize, _deviceOutFormat, _outFormat);
-
-							// Then add it to the output ring buffer
+							// Add it to the output ring buffer
 							for (int i = 0; i < _bufferSize; i++)
 								for (int j = 0; j < _nOutChannels; j++)
 									for (int k = 0; k < (_deviceOutFormat & Bytes); k++)
@@ -443,62 +454,103 @@ namespace Audijo
 
 					// Wait for one of the events, if duplex.
 					DWORD _handled;
+					TraceBegin("Wait");
 					if (m_InputClient && m_OutputClient)
-						_handled = WaitForMultipleObjects(2, _events, false, INFINITE);
+						_handled = WaitForMultipleObjects(3, _events, false, INFINITE);
 
 					// Wait only for input
 					else if (m_InputClient && !_pulled)
-						_handled = WaitForSingleObject(_captureEvent, INFINITE);
+						_handled = WaitForMultipleObjects(2, _captureEvents, false, INFINITE);
 
 					// Or wait only for output
 					else if (m_OutputClient && _pulled && !_pushed)
-						_handled = WaitForSingleObject(_renderEvent, INFINITE);
+						_handled = WaitForMultipleObjects(2, _renderEvents, false, INFINITE);
+					TraceEnd();
+
+					// Woken up by Stop
+					if (State() == Stopping)
+						break;
 
 					// If there is an input device, we'll get data from its buffer into the input ring buffer
 					if (m_InputClient && (!m_OutputClient || _handled == WAIT_OBJECT_0))
 					{
+						TraceScope _trace{ "Capture", _inputFramesAvailable };
 						// Get the buffer from the device
-						CHECK(m_CaptureClient->GetBuffer(&_streamBuffer, &_inputFramesAvailable, &_flags, nullptr, nullptr), "Failed to retrieve input buffer.", goto Cleanup);
+						RTCHECK(m_CaptureClient->GetBuffer(&_streamBuffer, &_inputFramesAvailable, &_flags, nullptr, nullptr), "Failed to retrieve input buffer.", goto Cleanup);
+
+						// The device lost input because we didn't take it in time
+						if (_flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY)
+							ReportXrun(InputOverrun);
+
+						// Deinterleave and convert to float for the bridge, it takes everything
+						if (m_Bridge)
+						{
+							int _bytes = _deviceInFormat & Bytes;
+							int _frames = std::min<int>(_inputFramesAvailable, _captureFrames);
+							for (int j = 0; j < _nInChannels; j++)
+							{
+								for (int i = 0; i < _frames; i++)
+									std::memcpy(&_captureBuff[i * _bytes], &_streamBuffer[(i * _nInChannels + j) * _bytes], _bytes);
+								ConvertBuffer((char*)_bridgeChannels[j], _captureBuff.data(), _frames, Float32, _deviceInFormat);
+							}
+
+							auto _overruns = m_Bridge->Overruns();
+							m_Bridge->Write(_bridgeChannels.data(), _frames);
+							if (m_Bridge->Overruns() != _overruns)
+								ReportXrun(InputOverrun);
+							RTCHECK(m_CaptureClient->ReleaseBuffer(_inputFramesAvailable), "Unable to release capture buffer", goto Cleanup);
+						}
 
 						// If there is enough space in the input ring buffer, we'll enqueue it.
-						if (_inRingBuffer.Space() >= _inputFramesAvailable * _nInChannels * (_deviceInFormat & Bytes))
+						else if (_inRingBuffer.Space() >= _inputFramesAvailable * _nInChannels * (_deviceInFormat & Bytes))
 						{
-							// Add the input data to the input ring buffer
+							// Add the input data to the input ring buffer, it fits
 							for (int i = 0; i < _inputFramesAvailable * _nInChannels * (_deviceInFormat & Bytes); i++)
 								_inRingBuffer.Enqueue(_streamBuffer[i]);
 
-							CHECK(m_CaptureClient->ReleaseBuffer(_inputFramesAvailable), "Unable to release capture buffer", goto Cleanup);
+							RTCHECK(m_CaptureClient->ReleaseBuffer(_inputFramesAvailable), "Unable to release capture buffer", goto Cleanup);
 						}
 
-						// Otherwise let wasapi know we haven't handled the buffer
+						// Otherwise let wasapi know we haven't handled the buffer, it keeps it until
+						// the next event but the device buffer is filling up behind it
 						else
-							CHECK(m_CaptureClient->ReleaseBuffer(0), "Unable to release capture buffer", goto Cleanup);
+						{
+							ReportXrun(InputOverrun, _inputFramesAvailable);
+							RTCHECK(m_CaptureClient->ReleaseBuffer(0), "Unable to release capture buffer", goto Cleanup);
+						}
 					}
 
 					// If there is an output device, we can push our ringbuffer to the device.
 					if (m_OutputClient && (!m_InputClient || _handled == WAIT_OBJECT_0 + 1))
 					{
+						TraceScope _trace{ "Render" };
 						// Calculate the amount of frames available to write to.
-						CHECK(m_OutputClient->GetBufferSize(&_outputFramesAvailable), "Unable to retrieve output buffer size", goto Cleanup);
-						CHECK(m_OutputClient->GetCurrentPadding(&_framePadding), "Unable to retrieve output frame padding", goto Cleanup);
+						RTCHECK(m_OutputClient->GetBufferSize(&_outputFramesAvailable), "Unable to retrieve output buffer size", goto Cleanup);
+						RTCHECK(m_OutputClient->GetCurrentPadding(&_framePadding), "Unable to retrieve output frame padding", goto Cleanup);
 						_outputFramesAvailable -= _framePadding;
 
 						// If we have enough data to write to the device from the output ring buffer
 						if (_outputFramesAvailable != 0 && _outRingBuffer.Size() >= _outputFramesAvailable * _nOutChannels * (_deviceOutFormat & Bytes))
 						{
 							// Get the buffer
-							CHECK(m_RenderClient->GetBuffer(_outputFramesAvailable, &_streamBuffer), "Failed to retrieve output buffer.", goto Cleanup);
+							RTCHECK(m_RenderClient->GetBuffer(_outputFramesAvailable, &_streamBuffer), "Failed to retrieve output buffer.", goto Cleanup);
 
 							// Put data in the output device buffer
 							for (int i = 0; i < _outputFramesAvailable * _nOutChannels * (_deviceOutFormat & Bytes); i++)
 								_streamBuffer[i] = _outRingBuffer.Dequeue();
 							
-							CHECK(m_RenderClient->ReleaseBuffer(_outputFramesAvailable, 0), "Unable to release capture buffer", goto Cleanup);
+							RTCHECK(m_RenderClient->ReleaseBuffer(_outputFramesAvailable, 0), "Unable to release render buffer", goto Cleanup);
+							_rendered = true;
 						}
 
-						// Otherwise let wasapi know we haven't handled the buffer
+						// Otherwise let wasapi know we haven't handled the buffer, if the device
+						// already played everything it had, it's playing silence now
 						else
-							CHECK(m_RenderClient->ReleaseBuffer(0, 0), "Unable to release capture buffer", goto Cleanup);
+						{
+							if (_rendered && _framePadding == 0)
+								ReportXrun(OutputUnderrun, _outputFramesAvailable);
+							RTCHECK(m_RenderClient->ReleaseBuffer(0, 0), "Unable to release render buffer", goto Cleanup);
+						}
 					}
 
 					// If data has been pushed, let the device know we can pull again.
@@ -520,36 +572,42 @@ namespace Audijo
 			}
 		};
 
+		// Only running once the thread exists, so a Stop always has a thread to join
+		Transition(Starting, Running);
 		return NoError;
 	};
 
 	Error WasapiApi::Stop()
 	{
-		if (m_Information.state == Closed)
-			return NotOpen;
-
-		if (m_Information.state != Running)
-			return NotRunning;
+		if (auto _error = BeginStop())
+			return _error;
 
-		m_Information.state = Opened;
+		SetEvent(m_WakeEvent);
 		try
 		{
 			m_AudioThread.join();
 		}
 		catch (const std::system_error& e)
 		{
-			LOGL(e.what());
+			LOGW(e.what());
 		}
+
+		CloseHandle(m_WakeEvent);
+		m_WakeEvent = nullptr;
+		Transition(Stopping, Opened);
 		return NoError;
 	};
 
 	Error WasapiApi::Close()
 	{
-		if (m_Information.state == Closed)
+		if (State() == Closed)
 			return NotOpen;
 
-		if (m_Information.state == Running)
+		if (State() == Running)
 			Stop();
+
+		StopRecording();
+		m_Bridge.reset();
 		
 		// Reset information
 		m_Information = StreamInformation{};
@@ -560,15 +618,94 @@ namespace Audijo
 		m_OutputClient.Release(); 
 		m_CaptureClient.Release();
 		m_RenderClient.Release(); 
-		m_Information.state = Closed;
+		State(Closed);
+		return NoError;
 	};
 
 	Error WasapiApi::SampleRate(double srate)
 	{
-		if (m_Information.state == Closed)
+		if (State() == Closed)
 			return NotOpen;
 
 		return Fail;
 	};
+
+	/**
+	 * Device enumerator created on an executor thread, released when the thread exits.
+	 */
+	struct ExecutorEnumerator
+	{
+		IMMDeviceEnumerator* enumerator = nullptr;
+		~ExecutorEnumerator() { if (enumerator) enumerator->Release(); }
+	};
+
+	static thread_local ExecutorEnumerator t_ExecutorEnumerator;
+
+	void WasapiApi::ControlThread()
+	{
+		// The executor thread lives as long as the stream, it stays in the apartment until it exits
+		thread_local bool _initialized = !FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+		(void)_initialized;
+
+		if (!t_ExecutorEnumerator.enumerator)
+			CHECK(CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, __uuidof(IMMDeviceEnumerator), 
+				(void**)&t_ExecutorEnumerator.enumerator), "Unable to create device enumerator.", return);
+	}
+
+	IMMDeviceEnumerator* WasapiApi::Enumerator()
+	{
+		// Only executor threads have one
+		return t_ExecutorEnumerator.enumerator ? t_ExecutorEnumerator.enumerator : m_DeviceEnumerator.get();
+	}
+
+	bool WasapiApi::Probe(DeviceInfo<Wasapi>& device, EDataFlow flow)
+	{
+		// Runs on a pool thread, which joins the multithreaded apartment for the duration of the probe
+		HRESULT _initialized = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+		bool _probed = [&]() {
+			Pointer<IMMDeviceEnumerator> _enumerator;
+			CHECK(CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, __uuidof(IMMDeviceEnumerator), (void**)&_enumerator), "Unable to create device enumerator.", return false);
+
+			Pointer<IMMDevice> _dev;
+			CHECK(_enumerator->GetDevice(std::wstring{ device.endpoint.begin(), device.endpoint.end() }.c_str(), &_dev), "Unable to retrieve device handle.", return false);
+
+			// Get the audio client from the device
+			Pointer<IAudioClient> _audioClient;
+			CHECK(_dev->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void**)&_audioClient), "Unable to retrieve device audio client.", return false);
+
+			// Get the device mix format using the audio client
+			Pointer<WAVEFORMATEX> _format;
+			CHECK(_audioClient->GetMixFormat(&_format), "Unable to retrieve device mix format.", return false);
+
+			// Set channel count given the device type
+			switch (flow) {
+			case eAll: device.outputChannels = device.inputChannels = _format->nChannels; break;
+			case eRender: device.outputChannels = _format->nChannels; break;
+			case eCapture: device.inputChannels = _format->nChannels; break;
+			}
+
+			// Wasapi only supports single sample rate
+			device.sampleRates = { (double)_format->nSamplesPerSec };
+			return true;
+		}();
+
+		if (SUCCEEDED(_initialized))
+			CoUninitialize();
+
+		return _probed;
+	}
+
+	std::string WasapiApi::EndpointId(IMMDevice* device)
+	{
+		LPWSTR _id = nullptr;
+		if (FAILED(device->GetId(&_id)))
+			return {};
+
+		// Endpoint ids are ascii, the registry keys on narrow strings
+		std::wstring_view _wide{ _id };
+		std::string _endpoint{ _wide.begin(), _wide.end() };
+		CoTaskMemFree(_id);
+		return _endpoint;
+	}
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "Audijo/AggregateStream.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+int main()
+{
+	// Two members whose clocks drift away from the master in opposite directions, with other buffer sizes.
+	// The bridges hold a few periods, large ones so scheduling delays of a loaded machine don't run them empty.
+	constexpr double SampleRate = 48000;
+	constexpr double Skews[]{ 0, 300, -200 };
+	constexpr int BufferSizes[]{ 1024, 768, 2048 };
+	constexpr double Duration = 3;
+
+	Stream<Null> _streams[3];
+	AggregateStream _aggregate;
+	for (int i = 0; i < 3; i++)
+	{
+		StreamParameters _parameters;
+		_parameters.input = NullApi::DuplexDevice;
+		_parameters.output = NullApi::DuplexDevice;
+		_parameters.bufferSize = BufferSizes[i];
+		_parameters.sampleRate = SampleRate;
+		_streams[i].ClockSkew(NullApi::DuplexDevice, Skews[i]);
+		EXPECT(_aggregate.Add(_streams[i], _parameters) == NoError);
+	}
+
+	std::atomic<int> _periods = 0;
+	_aggregate.Callback([&](Buffer<float>& input, Buffer<float>& output, CallbackInfo) {
+		for (int c = 0; c < output.Channels(); c++)
+			std::copy_n(input.data()[c % input.Channels()], output.Frames(), output.data()[c]);
+		_periods++;
+	});
+
+	if (!EXPECT(_aggregate.Open() == NoError) || !EXPECT(_aggregate.Start() == NoError))
+		return Test::Result();
+
+	std::this_thread::sleep_for(std::chrono::duration<double>{ Duration });
+	auto _information = _aggregate.Information();
+	int _inputs = _streams[0].Information().inputChannels;
+	_aggregate.Close();
+
+	if (!EXPECT(_information.members.size() == 3))
+		return Test::Result();
+
+	EXPECT(_information.inputChannels == 3 * _inputs);
+	EXPECT(_periods > (Duration - 0.5) * SampleRate / BufferSizes[0]);
+	for (int i = 0; i < 3; i++)
+	{
+		auto& _member = _information.members[i];
+		std::printf("member %d, %+.0f ppm: ratio %.6f, %llu underruns, %llu overruns\n", i, Skews[i], _member.ratio,
+			(unsigned long long)_member.underruns, (unsigned long long)_member.overruns);
+
+		// Still settling on the drift, but not held at the largest correction of the bridge
+		EXPECT(std::abs(_member.ratio - 1) < 0.0099);
+		EXPECT(_member.underruns == 0);
+		EXPECT(_member.overruns == 0);
+	}
+
+	return Test::Result();
+}
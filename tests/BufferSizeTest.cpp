@@ -0,0 +1,97 @@
+#include "Audijo/Audijo.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+// Allocations made by the audio thread once it ran its first period
+static thread_local bool t_AudioThread = false;
+static std::atomic<uint64_t> s_AudioAllocations = 0;
+
+static void* Allocate(std::size_t size, std::size_t alignment = 0)
+{
+	if (t_AudioThread)
+		s_AudioAllocations++;
+
+	void* _memory = alignment ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment) : std::malloc(size ? size : 1);
+	if (!_memory)
+		throw std::bad_alloc{};
+	return _memory;
+}
+
+void* operator new(std::size_t size) { return Allocate(size); }
+void* operator new[](std::size_t size) { return Allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return Allocate(size, (std::size_t)alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return Allocate(size, (std::size_t)alignment); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+
+int main()
+{
+	// A control thread asks for the next size as soon as a period started, so it switches every period
+	constexpr int Sizes[]{ 64, 1024, 128, 512, 256, 1000, 37 };
+	constexpr int Periods = 400;
+
+	Stream<Null> _stream;
+	std::atomic<int> _periods = 0;
+	std::atomic<int> _changes = 0;
+	std::atomic<int> _errors = 0;
+	int _lastSize = 0;
+	uint64_t _nextPosition = 0;
+	float* _outputs = nullptr;
+	_stream.Callback([&](Buffer<float>&, Buffer<float>& output, CallbackInfo info) {
+		t_AudioThread = true;
+
+		// Every size is one that was asked for, the frame clock never restarts and the buffers never move
+		_errors += std::find(std::begin(Sizes), std::end(Sizes), info.bufferSize) == std::end(Sizes);
+		_errors += output.Frames() != info.bufferSize;
+		_errors += _periods > 0 && (info.position != _nextPosition || output.data()[0] != _outputs);
+		_changes += _periods > 0 && info.bufferSize != _lastSize;
+		_nextPosition = info.position + info.bufferSize;
+		_outputs = output.data()[0];
+		_lastSize = info.bufferSize;
+
+		for (int c = 0; c < output.Channels(); c++)
+			std::fill_n(output.data()[c], output.Frames(), 0.f);
+
+		_periods++;
+		_periods.notify_one();
+	});
+
+	std::atomic<int> _notifications = 0;
+	_stream.Listener([&](const Notification&) { _notifications++; });
+
+	StreamParameters _parameters;
+	_parameters.input = NoDevice;
+	_parameters.output = NullApi::DuplexDevice;
+	_parameters.bufferSize = Sizes[0];
+	_parameters.maxBufferSize = 1024;
+	_parameters.sampleRate = 192000;
+	if (!EXPECT(_stream.Open(_parameters) == NoError) || !EXPECT(_stream.Start() == NoError))
+		return Test::Result();
+
+	int _failedChanges = 0;
+	for (int i = 1, _seen = 0; _seen < Periods; i++)
+	{
+		_periods.wait(_seen);
+		_seen = _periods.load();
+		_failedChanges += _stream.SetBufferSize(Sizes[i % std::size(Sizes)]) != NoError;
+	}
+
+	EXPECT(_stream.Information().state == Running);
+	_stream.Close();
+
+	std::printf("%d periods, %d size changes, %llu audio thread allocations\n", _periods.load(), _changes.load(),
+		(unsigned long long)s_AudioAllocations.load());
+	EXPECT(_errors == 0);
+	EXPECT(_failedChanges == 0);
+	EXPECT(_notifications == 0);
+	EXPECT(s_AudioAllocations == 0);
+	EXPECT(_changes >= Periods / 2);
+	return Test::Result();
+}
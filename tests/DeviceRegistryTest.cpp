@@ -0,0 +1,177 @@
+#include "Audijo/DeviceRegistry.hpp"
+#include "MockEnumerator.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+using Registry = DeviceRegistry<DeviceInfo<>>;
+
+/**
+ * Whether the changes of an update are exactly the expected ones, in any order.
+ * @param changes changes of the update
+ * @param expected expected type and key of every change
+ * @return true if they match
+ */
+static bool Changes(std::vector<DeviceChange> changes, std::vector<std::pair<DeviceChange::Type, std::string>> expected)
+{
+	if (changes.size() != expected.size())
+		return false;
+
+	for (auto& _change : changes)
+		if (std::find(expected.begin(), expected.end(), std::pair{ _change.type, _change.key }) == expected.end())
+			return false;
+	return true;
+}
+
+/**
+ * Unplugging and plugging devices back in, in every order, keeps the id of their key.
+ */
+static void StableIds()
+{
+	Registry _registry;
+	Test::MockEnumerator _system;
+	_system.Plug("{speakers}", "Speakers", 0, 2);
+	_system.Plug("{microphone}", "Microphone", 1, 0);
+	_system.Plug("{headset}", "Headset", 1, 2);
+	EXPECT(Changes(_registry.Update(_system.Enumerate()), { { DeviceChange::Added, "{speakers}" },
+		{ DeviceChange::Added, "{microphone}" }, { DeviceChange::Added, "{headset}" } }));
+
+	auto _before = _registry.Read();
+	int _speakers = _before->FindKey("{speakers}")->id;
+	int _microphone = _before->FindKey("{microphone}")->id;
+	int _headset = _before->FindKey("{headset}")->id;
+	EXPECT(_speakers != _microphone && _microphone != _headset && _speakers != _headset);
+
+	// A rescan that finds the same devices changes nothing
+	EXPECT(_registry.Update(_system.Enumerate()).empty());
+	EXPECT(_registry.Read() == _before);
+
+	_system.Unplug("{microphone}");
+	EXPECT(Changes(_registry.Update(_system.Enumerate()), { { DeviceChange::Removed, "{microphone}" } }));
+	EXPECT(_registry.Read()->Find(_microphone) == nullptr);
+	EXPECT(_registry.Read()->FindKey("{headset}")->id == _headset);
+
+	// A new device never gets the id of one that's gone
+	_system.Plug("{interface}", "Interface", 8, 8);
+	EXPECT(Changes(_registry.Update(_system.Enumerate()), { { DeviceChange::Added, "{interface}" } }));
+	int _interface = _registry.Read()->FindKey("{interface}")->id;
+	EXPECT(_interface != _speakers && _interface != _microphone && _interface != _headset);
+
+	// Plugged back in, in another usb port so it's listed last, with the same key
+	_system.Unplug("{speakers}");
+	_registry.Update(_system.Enumerate());
+	_system.Plug("{microphone}", "Microphone", 1, 0);
+	_system.Plug("{speakers}", "Speakers", 0, 2);
+	EXPECT(Changes(_registry.Update(_system.Enumerate()), { { DeviceChange::Added, "{microphone}" }, { DeviceChange::Added, "{speakers}" } }));
+
+	auto _after = _registry.Read();
+	EXPECT(_after->FindKey("{speakers}")->id == _speakers);
+	EXPECT(_after->FindKey("{microphone}")->id == _microphone);
+	EXPECT(_after->FindKey("{headset}")->id == _headset);
+	EXPECT(_after->FindKey("{interface}")->id == _interface);
+	EXPECT(_after->FindName("Microphone") == _after->Find(_microphone));
+	EXPECT(_after->version > _before->version);
+
+	// The old snapshot didn't change while the devices did
+	EXPECT(_before->devices.size() == 3);
+	EXPECT(_before->Find(_microphone) && _before->Find(_microphone)->name == "Microphone");
+	EXPECT(_before->Find(_interface) == nullptr);
+
+	// Changing a device keeps its id, removing it by hand keeps the id for when it comes back
+	_system.Change("{headset}", 2, 2);
+	EXPECT(Changes(_registry.Update(_system.Enumerate()), { { DeviceChange::Changed, "{headset}" } }));
+	EXPECT(_registry.Read()->Find(_headset)->inputChannels == 2);
+	EXPECT(_registry.Remove(_headset));
+	EXPECT(!_registry.Remove(_headset));
+	EXPECT(_registry.Set("{headset}", DeviceInfo<>{ NoDevice, "Headset", 1, 2, {}, false }) == _headset);
+}
+
+/**
+ * Readers on several threads only ever see complete updates while a hot-plug thread keeps updating.
+ */
+static void ConsistentSnapshots()
+{
+	// In generation g, device k is plugged in unless (k + g) % 3 == 0, and every device has g channels
+	constexpr int Devices = 16;
+	constexpr int Generations = 2000;
+	constexpr int Readers = 3;
+	auto _plugged = [](int k, int g) { return (k + g) % 3 != 0; };
+	auto _key = [](int k) { return "{device " + std::to_string(k) + "}"; };
+
+	Registry _registry;
+	Test::MockEnumerator _system;
+	std::atomic<bool> _done = false;
+	std::thread _hotPlug{ [&]() {
+		for (int g = 1; g <= Generations; g++)
+		{
+			for (int k = 0; k < Devices; k++)
+				if (_plugged(k, g))
+					_system.Plug(_key(k), "Device " + std::to_string(k), g, g);
+				else
+					_system.Unplug(_key(k));
+			_registry.Update(_system.Enumerate());
+		}
+		_done = true;
+	} };
+
+	std::atomic<int> _errors = 0;
+	std::atomic<int> _reads = 0;
+	std::vector<std::thread> _readers;
+	for (int r = 0; r < Readers; r++)
+		_readers.emplace_back([&]() {
+			std::map<std::string, int> _ids;
+			uint64_t _version = 0;
+			while (!_done)
+			{
+				auto _snapshot = _registry.Read();
+				if (_snapshot->devices.empty())
+					continue;
+
+				// Versions never go back
+				_errors += _snapshot->version < _version;
+				_version = _snapshot->version;
+
+				// Every device is from the same generation, and exactly the devices of that generation are there
+				int g = _snapshot->devices.front().inputChannels;
+				int _expected = 0;
+				for (int k = 0; k < Devices; k++)
+					if (_plugged(k, g))
+						_expected++, _errors += _snapshot->FindKey(_key(k)) == nullptr;
+				_errors += (int)_snapshot->devices.size() != _expected;
+
+				for (std::size_t i = 0; i < _snapshot->devices.size(); i++)
+				{
+					auto& _device = _snapshot->devices[i];
+					_errors += _device.inputChannels != g || _device.outputChannels != g;
+					_errors += i > 0 && _snapshot->devices[i - 1].id >= _device.id;
+					_errors += _snapshot->Find(_device.id) != &_device || _snapshot->FindKey(_snapshot->keys[i]) != &_device;
+
+					// A key keeps its id
+					auto [_it, _added] = _ids.try_emplace(_snapshot->keys[i], _device.id);
+					_errors += _it->second != _device.id;
+				}
+
+				// The snapshot doesn't change while it's held
+				auto _copy = _snapshot->devices;
+				std::this_thread::yield();
+				_errors += _copy != _snapshot->devices;
+				_reads++;
+			}
+		});
+
+	_hotPlug.join();
+	for (auto& _reader : _readers)
+		_reader.join();
+
+	std::printf("%d generations, %d consistent reads\n", Generations, _reads.load());
+	EXPECT(_errors == 0);
+	EXPECT(_reads > 0);
+	EXPECT(_registry.Read()->version == Generations);
+}
+
+int main()
+{
+	StableIds();
+	ConsistentSnapshots();
+	return Test::Result();
+}
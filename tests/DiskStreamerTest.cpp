@@ -0,0 +1,88 @@
+#include "Audijo/DiskStreamer.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+/**
+ * Sample of the test file, spans the whole 24 bit range and both signs.
+ * @param frame frame
+ * @param channel channel
+ * @return sample as a 24 bit integer
+ */
+static int32_t Sample(int frame, int channel)
+{
+	int32_t _value = (int32_t)((frame * 99991u) % (1u << 24)) - (1 << 23);
+	return channel == 0 ? _value : -_value - 1;
+}
+
+/**
+ * Write a 24 bit PCM WAV file.
+ * @param path file path
+ * @param channels amount of channels
+ * @param frames amount of frames
+ * @return true on success
+ */
+static bool Write24(const char* path, int channels, int frames)
+{
+	std::FILE* _file = std::fopen(path, "wb");
+	if (!_file)
+		return false;
+
+	auto _write = [&](uint32_t value, int bytes) { for (int i = 0; i < bytes; i++) std::fputc((value >> (8 * i)) & 0xFF, _file); };
+	uint32_t _data = (uint32_t)(frames * channels * 3);
+	std::fwrite("RIFF", 1, 4, _file); _write(36 + _data, 4); std::fwrite("WAVE", 1, 4, _file);
+	std::fwrite("fmt ", 1, 4, _file); _write(16, 4);
+	_write(1, 2); _write(channels, 2); _write(48000, 4); _write(48000 * channels * 3, 4); _write(channels * 3, 2); _write(24, 2);
+	std::fwrite("data", 1, 4, _file); _write(_data, 4);
+	for (int i = 0; i < frames; i++)
+		for (int j = 0; j < channels; j++)
+			_write((uint32_t)Sample(i, j), 3);
+
+	return std::fclose(_file) == 0;
+}
+
+int main()
+{
+	// Ends a little into the second block, so the last sample of both blocks ends a read
+	constexpr int Channels = 2;
+	constexpr int Frames = 16384 + 37;
+	constexpr const char* Path = "DiskStreamerTest24.wav";
+	if (!EXPECT(Write24(Path, Channels, Frames)))
+		return Test::Result();
+
+	{
+		DiskStreamer _streamer{ 1, 16, 1 << 15 };
+		auto _track = _streamer.Add(Path);
+		if (!EXPECT(_track != nullptr))
+			return Test::Result();
+
+		EXPECT(_track->Channels() == Channels);
+		EXPECT(_track->Frames() == Frames);
+
+		std::vector<float> _memory(Channels * 512);
+		float* _channels[Channels]{ _memory.data(), _memory.data() + 512 };
+		Buffer<float> _buffer{ _channels, Channels, 512 };
+
+		int _mismatches = 0;
+		uint64_t _position = 0;
+		auto _deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (_position < Frames && std::chrono::steady_clock::now() < _deadline)
+		{
+			int _read = _track->Read(_buffer);
+			for (int i = 0; i < _read; i++)
+				for (int j = 0; j < Channels; j++)
+					if (_channels[j][i] != Sample((int)_position + i, j) / 8388608.f)
+						_mismatches++;
+
+			_position += _read;
+			if (_read == 0)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		EXPECT(_position == Frames);
+		EXPECT(_mismatches == 0);
+	}
+
+	std::remove(Path);
+	return Test::Result();
+}
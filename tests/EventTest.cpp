@@ -0,0 +1,93 @@
+#include "Audijo/Audijo.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+struct Payload
+{
+	int thread;
+	int index;
+};
+
+int main()
+{
+	// Threads schedule interleaved frames a few periods ahead of the stream, fewer than can wait at
+	// once. Some of them still get there too late when a thread isn't scheduled in time.
+	constexpr int Threads = 4;
+	constexpr int Events = 2000;
+	constexpr int Spacing = 4;
+	constexpr int Lookahead = 768;
+
+	Stream<Null> _stream;
+	std::atomic<int> _delivered = 0;
+	int _errors = 0;
+	int _late = 0;
+	int _periods = 0;
+	int _next[Threads + 1]{};
+	_stream.Callback([&](Buffer<float>&, Buffer<float>& output, CallbackInfo info) {
+		int _offset = 0;
+		for (auto& _event : info.events)
+		{
+			// Ordered by frame, on the frame when it's not late yet, otherwise at the start of the period
+			auto _payload = _event.As<Payload>();
+			_errors += _event.offset < _offset || _event.offset >= info.bufferSize;
+			_errors += _event.frame >= info.position ? info.position + _event.offset != _event.frame : _event.offset != 0;
+			_late += _event.frame < info.position;
+			_offset = _event.offset;
+
+			// A thread schedules in order of frame, so its events arrive in order
+			_errors += _payload.index != _next[_payload.thread]++;
+			_errors += _event.type != (uint32_t)_payload.thread;
+			_delivered++;
+		}
+
+		for (int c = 0; c < output.Channels(); c++)
+			std::fill_n(output.data()[c], output.Frames(), 0.f);
+		_periods++;
+	});
+
+	StreamParameters _parameters;
+	_parameters.input = NoDevice;
+	_parameters.output = NullApi::DuplexDevice;
+	_parameters.bufferSize = 256;
+	_parameters.sampleRate = 48000;
+	if (!EXPECT(_stream.Open(_parameters) == NoError) || !EXPECT(_stream.Start() == NoError))
+		return Test::Result();
+
+	uint64_t _start = _stream.Position() + Lookahead;
+	std::vector<std::thread> _threads;
+	for (int t = 0; t < Threads; t++)
+		_threads.emplace_back([&, t]() {
+			for (int i = 0; i < Events; i++)
+			{
+				uint64_t _frame = _start + i * Spacing + t;
+				while (_frame > _stream.Position() + Lookahead)
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				while (!_stream.Schedule(_frame, t, Payload{ t, i }))
+					std::this_thread::yield();
+			}
+		});
+
+	for (auto& _thread : _threads)
+		_thread.join();
+
+	// Frame 0 is well in the past by now
+	auto _until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (_delivered < Threads * Events && std::chrono::steady_clock::now() < _until)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	EXPECT(_stream.Schedule(0, Threads, Payload{ Threads, 0 }));
+	while (_delivered < Threads * Events + 1 && std::chrono::steady_clock::now() < _until)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	_stream.Close();
+
+	std::printf("%d events in %d periods, %d late\n", _delivered.load(), _periods, _late);
+	EXPECT(_delivered == Threads * Events + 1);
+	EXPECT(_errors == 0);
+	EXPECT(_late >= 1);
+	EXPECT(_late < Threads * Events / 2);
+	EXPECT(_next[Threads] == 1);
+	for (int t = 0; t < Threads; t++)
+		EXPECT(_next[t] == Events);
+	return Test::Result();
+}
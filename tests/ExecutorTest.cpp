@@ -0,0 +1,55 @@
+#include "Audijo/Audijo.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+int main()
+{
+	// Asynchronous calls are made without waiting for the ones before, every one of them only
+	// succeeds when the executor runs them in the order they were made
+	constexpr int Streams = 2;
+	constexpr int Rounds = 25;
+
+	Stream<Null> _streams[Streams];
+	for (auto& _stream : _streams)
+		_stream.Callback([](Buffer<float>&, Buffer<float>& output, CallbackInfo) {
+			for (int c = 0; c < output.Channels(); c++)
+				std::fill_n(output.data()[c], output.Frames(), 0.f);
+		});
+
+	StreamParameters _parameters;
+	_parameters.input = NoDevice;
+	_parameters.output = NullApi::DuplexDevice;
+	_parameters.bufferSize = 64;
+	_parameters.sampleRate = 48000;
+
+	std::vector<std::future<Error>> _results[Streams];
+	for (int i = 0; i < Rounds; i++)
+		for (int s = 0; s < Streams; s++)
+		{
+			_results[s].push_back(_streams[s].OpenAsync(_parameters));
+			_results[s].push_back(_streams[s].StartAsync());
+			_results[s].push_back(_streams[s].StopAsync());
+			_results[s].push_back(_streams[s].CloseAsync());
+		}
+
+	// Calls made after the others wait for them
+	auto _open = _streams[0].OpenAsync(_parameters);
+	auto _start = _streams[0].StartAsync();
+
+	int _errors = 0;
+	for (auto& _stream : _results)
+		for (auto& _result : _stream)
+			_errors += _result.get() != NoError;
+
+	EXPECT(_open.get() == NoError);
+	EXPECT(_start.get() == NoError);
+	EXPECT(_streams[0].State() == Running);
+	EXPECT(_streams[1].State() == Closed);
+	EXPECT(_errors == 0);
+
+	// Synchronous calls keep working next to the executor
+	EXPECT(_streams[0].Close() == NoError);
+	EXPECT(_streams[0].CloseAsync().get() == NotOpen);
+	return Test::Result();
+}
@@ -0,0 +1,156 @@
+#include "Audijo/MessageQueue.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+// Destructions of probes, and the ones that happened on the audio thread
+static thread_local bool t_AudioThread = false;
+static std::atomic<int> s_Destroyed = 0;
+static std::atomic<int> s_AudioDestroyed = 0;
+
+struct Probe
+{
+	~Probe()
+	{
+		s_Destroyed++;
+		s_AudioDestroyed += t_AudioThread;
+	}
+};
+
+struct Message
+{
+	int value = 0;
+	std::unique_ptr<Probe> probe;
+};
+
+int main()
+{
+	// Producers and consumers go round a small queue many times
+	{
+		constexpr int Producers = 4;
+		constexpr int Consumers = 2;
+		constexpr int Messages = 50000;
+
+		MessageQueue<int> _queue{ 100 };
+		EXPECT(_queue.Capacity() == 128);
+
+		std::vector<std::atomic<int>> _received(Producers * Messages);
+		std::atomic<int> _consumed = 0;
+		std::atomic<int> _errors = 0;
+		std::vector<std::thread> _threads;
+		for (int p = 0; p < Producers; p++)
+			_threads.emplace_back([&, p]() {
+				for (int i = 0; i < Messages; i++)
+					while (!_queue.Push(p * Messages + i))
+						std::this_thread::yield();
+			});
+
+		for (int c = 0; c < Consumers; c++)
+			_threads.emplace_back([&]() {
+				// Every consumer sees the messages of a producer in the order they were pushed
+				int _last[Producers];
+				std::fill_n(_last, Producers, -1);
+				while (_consumed < Producers * Messages)
+				{
+					int _message;
+					if (!_queue.Pop(_message))
+					{
+						std::this_thread::yield();
+						continue;
+					}
+
+					int _producer = _message / Messages;
+					_errors += _message % Messages <= _last[_producer];
+					_last[_producer] = _message % Messages;
+					_received[_message]++;
+					_consumed++;
+				}
+			});
+
+		for (auto& _thread : _threads)
+			_thread.join();
+
+		int _missing = 0;
+		for (auto& _count : _received)
+			_missing += _count != 1;
+
+		std::printf("%d producers, %d consumers, %d messages through %zu cells\n", Producers, Consumers,
+			Producers * Messages, _queue.Capacity());
+		EXPECT(_errors == 0);
+		EXPECT(_missing == 0);
+
+		int _message;
+		EXPECT(!_queue.Pop(_message));
+	}
+
+	// A full queue refuses, and frees a cell for every message taken out, lap after lap
+	{
+		MessageQueue<int> _queue{ 4 };
+		int _errors = 0;
+		for (int _lap = 0; _lap < 10; _lap++)
+		{
+			for (int i = 0; i < 4; i++)
+				_errors += !_queue.Push(_lap * 4 + i);
+			_errors += _queue.Push(-1);
+
+			int _message;
+			for (int i = 0; i < 4; i++)
+				_errors += !_queue.Pop(_message) || _message != _lap * 4 + i;
+			_errors += _queue.Pop(_message);
+		}
+		EXPECT(_errors == 0);
+	}
+
+	// Messages still in the queue are destroyed with it
+	{
+		s_Destroyed = 0;
+		{
+			MessageQueue<Message> _queue{ 8 };
+			for (int i = 0; i < 3; i++)
+				_queue.Push(Message{ i, std::make_unique<Probe>() });
+		}
+		EXPECT(s_Destroyed == 3);
+	}
+
+	// Messages the audio thread handled are destroyed by the control thread
+	{
+		constexpr int Commands = 20000;
+
+		s_Destroyed = 0;
+		s_AudioDestroyed = 0;
+		int _handled = 0;
+		int _errors = 0;
+		auto _queue = std::make_unique<CommandQueue<Message>>(16, [&](Message& message) {
+			_errors += message.value != _handled || !message.probe;
+			_handled++;
+		});
+
+		std::atomic<bool> _done = false;
+		std::thread _audio{ [&]() {
+			t_AudioThread = true;
+			while (!_done)
+			{
+				_queue->Drain();
+				std::this_thread::yield();
+			}
+			_queue->Drain();
+		} };
+
+		// A full queue leaves the message with the sender
+		for (int i = 0; i < Commands; i++)
+			for (Message _message{ i, std::make_unique<Probe>() }; !_queue->Send(std::move(_message));)
+				std::this_thread::yield();
+
+		_done = true;
+		_audio.join();
+		_queue->Collect();
+
+		std::printf("%d commands handled, %d destroyed, %d on the audio thread\n", _handled, s_Destroyed.load(), s_AudioDestroyed.load());
+		EXPECT(_errors == 0);
+		EXPECT(_handled == Commands);
+		EXPECT(s_Destroyed == Commands);
+		EXPECT(s_AudioDestroyed == 0);
+	}
+
+	return Test::Result();
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "Audijo/ApiBase.hpp"
+
+namespace Audijo::Test
+{
+	/**
+	 * Stands in for the devices of a system. A test plugs, unplugs and changes devices, and
+	 * Enumerate lists them the way a backend's full rescan would, in the order they were plugged
+	 * in, ready for DeviceRegistry::Update. Safe to use from several threads.
+	 */
+	class MockEnumerator
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param probeDelay time it takes to probe the capabilities of a device, in seconds
+		 */
+		MockEnumerator(double probeDelay = 0)
+			: m_ProbeDelay(probeDelay)
+		{}
+
+		/**
+		 * Plug in a device, or replace the device with the same key.
+		 * @param key key of the device, like an endpoint id
+		 * @param name name of the device
+		 * @param inputs amount of input channels
+		 * @param outputs amount of output channels
+		 */
+		void Plug(const std::string& key, const std::string& name, int inputs, int outputs)
+		{
+			std::lock_guard _lock{ m_Mutex };
+			DeviceInfo<> _info{ NoDevice, name, inputs, outputs, { 44100, 48000 }, false, Unspecified };
+			if (auto _it = Find(key); _it != m_Devices.end())
+				_it->second = std::move(_info);
+			else
+				m_Devices.emplace_back(key, std::move(_info));
+		}
+
+		/**
+		 * Unplug a device.
+		 * @param key key of the device
+		 * @return false if no device with this key is plugged in
+		 */
+		bool Unplug(const std::string& key)
+		{
+			std::lock_guard _lock{ m_Mutex };
+			auto _it = Find(key);
+			if (_it == m_Devices.end())
+				return false;
+
+			m_Devices.erase(_it);
+			return true;
+		}
+
+		/**
+		 * Change the channels of a plugged in device.
+		 * @param key key of the device
+		 * @param inputs amount of input channels
+		 * @param outputs amount of output channels
+		 * @return false if no device with this key is plugged in
+		 */
+		bool Change(const std::string& key, int inputs, int outputs)
+		{
+			std::lock_guard _lock{ m_Mutex };
+			auto _it = Find(key);
+			if (_it == m_Devices.end())
+				return false;
+
+			_it->second.inputChannels = inputs;
+			_it->second.outputChannels = outputs;
+			return true;
+		}
+
+		/**
+		 * List every plugged in device.
+		 * @return key and information of every device
+		 */
+		std::vector<std::pair<std::string, DeviceInfo<>>> Enumerate() const
+		{
+			std::lock_guard _lock{ m_Mutex };
+			return m_Devices;
+		}
+
+		/**
+		 * List every plugged in device without its capabilities, like a backend that probes lazily.
+		 * @return key and information of every device, with probed set to false
+		 */
+		std::vector<std::pair<std::string, DeviceInfo<>>> List() const
+		{
+			auto _devices = Enumerate();
+			for (auto& [_key, _info] : _devices)
+				_info = DeviceInfo<>{ NoDevice, _info.name, 0, 0, {}, _info.defaultDevice, _info.api, false };
+			return _devices;
+		}
+
+		/**
+		 * Probe the capabilities of a device, takes the probe delay.
+		 * @param key key of the device
+		 * @param info device, its channels and sample rates are filled in
+		 * @return false if no device with this key is plugged in
+		 */
+		bool Probe(const std::string& key, DeviceInfo<>& info) const
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double>{ m_ProbeDelay });
+			std::lock_guard _lock{ m_Mutex };
+			auto _it = std::find_if(m_Devices.begin(), m_Devices.end(), [&](auto& d) { return d.first == key; });
+			if (_it == m_Devices.end())
+				return false;
+
+			info.inputChannels = _it->second.inputChannels;
+			info.outputChannels = _it->second.outputChannels;
+			info.sampleRates = _it->second.sampleRates;
+			info.probed = true;
+			return true;
+		}
+
+	private:
+		double m_ProbeDelay;
+		mutable std::mutex m_Mutex;
+		std::vector<std::pair<std::string, DeviceInfo<>>> m_Devices;
+
+		std::vector<std::pair<std::string, DeviceInfo<>>>::iterator Find(const std::string& key) { return std::find_if(m_Devices.begin(), m_Devices.end(), [&](auto& d) { return d.first == key; }); }
+	};
+}
@@ -0,0 +1,52 @@
+#include "Audijo/Audijo.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+int main()
+{
+	// The input and output device drift apart in opposite directions, the bridge between them follows
+	constexpr double SampleRate = 48000;
+	constexpr double Skew = 300;
+	constexpr int BufferSize = 1024;
+	constexpr double Duration = 3;
+
+	Stream<Null> _stream;
+	EXPECT(_stream.ClockSkew(NullApi::InputDevice, Skew) == NoError);
+	EXPECT(_stream.ClockSkew(NullApi::OutputDevice, -Skew) == NoError);
+
+	std::atomic<int> _periods = 0;
+	_stream.Callback([&](Buffer<float>& input, Buffer<float>& output, CallbackInfo) {
+		for (int c = 0; c < output.Channels(); c++)
+			std::copy_n(input.data()[c % input.Channels()], output.Frames(), output.data()[c]);
+		_periods++;
+	});
+
+	StreamParameters _parameters;
+	_parameters.input = NullApi::InputDevice;
+	_parameters.output = NullApi::OutputDevice;
+	_parameters.bufferSize = BufferSize;
+	_parameters.sampleRate = SampleRate;
+	if (!EXPECT(_stream.Open(_parameters) == NoError) || !EXPECT(_stream.Start() == NoError))
+		return Test::Result();
+
+	if (!EXPECT(_stream.Bridge() != nullptr))
+		return Test::Result();
+
+	std::this_thread::sleep_for(std::chrono::duration<double>{ Duration });
+	double _ratio = _stream.Bridge()->Ratio();
+	auto _statistics = _stream.Statistics();
+	_stream.Close();
+
+	auto _underruns = _statistics.xruns[InputUnderrun];
+	auto _overruns = _statistics.xruns[InputOverrun];
+	std::printf("%+.0f ppm against %+.0f ppm: ratio %.6f, %d periods, %llu underruns, %llu overruns\n", Skew, -Skew,
+		_ratio, _periods.load(), (unsigned long long)_underruns, (unsigned long long)_overruns);
+	EXPECT(_periods > (Duration - 0.5) * SampleRate / BufferSize);
+
+	// Still settling on the drift, but not held at the largest correction of the bridge
+	EXPECT(std::abs(_ratio - 1) < 0.0099);
+	EXPECT(_underruns == 0);
+	EXPECT(_overruns == 0);
+	return Test::Result();
+}
@@ -0,0 +1,86 @@
+#include "Audijo/Audijo.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+/**
+ * Time a control call.
+ * @param call call
+ * @param error error the call returned
+ * @return duration in seconds
+ */
+template<typename Call>
+static double Time(Call call, Error& error)
+{
+	auto _start = std::chrono::steady_clock::now();
+	error = call();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+
+int main()
+{
+	// Stop and Close never wait for the next period, even when a period lasts a second
+	constexpr double Bound = 0.1;
+	constexpr int Iterations = 200;
+	constexpr int BufferSizes[]{ 16, 64, 512, 4096, 8192 };
+	constexpr double SampleRates[]{ 8000, 48000, 192000 };
+
+	Stream<Null> _stream;
+	std::atomic<uint64_t> _periods = 0;
+	_stream.Callback([&](Buffer<float>&, Buffer<float>& output, CallbackInfo) {
+		for (auto& _frame : output)
+			for (auto& _channel : _frame)
+				_channel = 0;
+		_periods++;
+	});
+
+	double _maxStop = 0;
+	double _maxClose = 0;
+	int _errors = 0;
+	for (int i = 0; i < Iterations; i++)
+	{
+		StreamParameters _parameters;
+		_parameters.input = i % 3 == 0 ? NoDevice : (int)NullApi::DuplexDevice;
+		_parameters.output = NullApi::DuplexDevice;
+		_parameters.bufferSize = BufferSizes[i % std::size(BufferSizes)];
+		_parameters.sampleRate = SampleRates[i % std::size(SampleRates)];
+		if (_stream.Open(_parameters) != NoError || _stream.Start() != NoError)
+		{
+			_errors++;
+			continue;
+		}
+
+		// Stop somewhere within a period, sometimes right away
+		std::this_thread::sleep_for(std::chrono::microseconds(i % 7 * 500));
+
+		Error _error = NoError;
+		if (i % 2 == 0)
+		{
+			_maxStop = std::max(_maxStop, Time([&]() { return _stream.Stop(); }, _error));
+			_errors += _error != NoError;
+
+			// Closing a stopped stream, after starting it once more
+			if (i % 4 == 0)
+			{
+				_errors += _stream.Start() != NoError;
+				_maxStop = std::max(_maxStop, Time([&]() { return _stream.Stop(); }, _error));
+				_errors += _error != NoError;
+			}
+		}
+
+		// Closing a running stream stops it first, a second thread stopping at the same time changes nothing
+		std::thread _stopper{ [&]() { _stream.Stop(); } };
+		_maxClose = std::max(_maxClose, Time([&]() { return _stream.Close(); }, _error));
+		_stopper.join();
+		_errors += _error != NoError;
+		_errors += _stream.Information().state != Closed;
+	}
+
+	std::printf("%d iterations, %llu periods, longest Stop %.2f ms, longest Close %.2f ms\n", Iterations,
+		(unsigned long long)_periods.load(), _maxStop * 1000, _maxClose * 1000);
+	EXPECT(_errors == 0);
+	EXPECT(_periods > 0);
+	EXPECT(_maxStop < Bound);
+	EXPECT(_maxClose < Bound);
+	return Test::Result();
+}
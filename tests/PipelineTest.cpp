@@ -0,0 +1,81 @@
+#include "Audijo/Audijo.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+int main()
+{
+	// The worker and the audio thread both configure themselves on every start, while the control
+	// thread keeps reading the information, and the buffer size changes on the way
+	constexpr int Pipeline = 2;
+	constexpr int Restarts = 20;
+	constexpr int Sizes[]{ 256, 64, 512 };
+	constexpr double SampleRate = 48000;
+
+	Stream<Null> _stream;
+	std::atomic<int> _periods = 0;
+	std::atomic<int> _errors = 0;
+	std::atomic<int> _skipped = 0;
+	std::atomic<bool> _restarted = false;
+	uint64_t _nextPosition = 0;
+	_stream.Callback([&](Buffer<float>&, Buffer<float>& output, CallbackInfo info) {
+		// Periods reach the worker in order, also when the size changes. Periods that found the worker
+		// still busy with their slot are lost, the audio thread reports those.
+		if (!_restarted.exchange(false))
+		{
+			_errors += info.position < _nextPosition;
+			_skipped += info.position > _nextPosition;
+		}
+		_nextPosition = info.position + info.bufferSize;
+		_errors += output.Frames() != info.bufferSize;
+
+		for (int c = 0; c < output.Channels(); c++)
+			std::fill_n(output.data()[c], output.Frames(), 0.f);
+		_periods++;
+	});
+
+	StreamParameters _parameters;
+	_parameters.input = NullApi::DuplexDevice;
+	_parameters.output = NullApi::DuplexDevice;
+	_parameters.bufferSize = Sizes[0];
+	_parameters.maxBufferSize = 512;
+	_parameters.sampleRate = SampleRate;
+	_parameters.pipeline = Pipeline;
+	_parameters.thread.prefaultStack = 1 << 16;
+	if (!EXPECT(_stream.Open(_parameters) == NoError))
+		return Test::Result();
+
+	EXPECT(std::abs(_stream.Information().pipelineDelay - Pipeline * Sizes[0] / SampleRate) < 1e-9);
+
+	// Read the status of the audio thread for a while, it's published once the audio thread configured itself
+	int _applied = 0;
+	auto _poll = [&]() {
+		auto _until = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+		while (std::chrono::steady_clock::now() < _until)
+		{
+			auto _status = _stream.Information().threadStatus;
+			_errors += _status.prefaultStack != NotRequested && _status.prefaultStack != Applied;
+			_applied += _status.prefaultStack == Applied;
+		}
+	};
+
+	for (int i = 0; i < Restarts; i++)
+	{
+		_restarted = true;
+		_errors += _stream.Start() != NoError;
+		_poll();
+		_errors += _stream.SetBufferSize(Sizes[(i + 1) % std::size(Sizes)]) != NoError;
+		_poll();
+		_errors += _stream.Stop() != NoError;
+	}
+
+	auto _lost = _stream.Statistics().xruns[InputOverrun];
+	_stream.Close();
+
+	std::printf("%d restarts, %d periods, %llu lost\n", Restarts, _periods.load(), (unsigned long long)_lost);
+	EXPECT(_errors == 0);
+	EXPECT((uint64_t)_skipped <= _lost);
+	EXPECT(_applied > 0);
+	EXPECT(_periods > Restarts);
+	return Test::Result();
+}
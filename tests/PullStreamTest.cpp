@@ -0,0 +1,124 @@
+#include "Audijo/Audijo.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+/**
+ * Coroutine that runs by itself, the waker thread of the pull stream resumes it.
+ */
+struct Detached
+{
+	struct promise_type
+	{
+		Detached get_return_object() { return {}; }
+		std::suspend_never initial_suspend() { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+/**
+ * Read until a read fails.
+ * @param pull pull stream
+ * @param buffer buffer to read into
+ * @param reads counts the reads that succeeded
+ * @param result gets the error that ended it
+ */
+static Detached ReadUntilError(PullStream<float>& pull, Buffer<float>& buffer, std::atomic<int>& reads, std::promise<Error>& result)
+{
+	while (true)
+	{
+		Error _error = co_await pull.ReadAsync(buffer);
+		if (_error != NoError)
+		{
+			result.set_value(_error);
+			co_return;
+		}
+		reads++;
+	}
+}
+
+int main()
+{
+	// Reads of more than a period wait for the audio thread, until the stream stops under them
+	constexpr int BufferSize = 256;
+	constexpr int Frames = 3 * BufferSize / 2;
+	constexpr auto Timeout = std::chrono::seconds(5);
+
+	Stream<Null> _stream;
+	auto& _pull = _stream.Pull(4);
+
+	StreamParameters _parameters;
+	_parameters.input = NullApi::DuplexDevice;
+	_parameters.output = NullApi::DuplexDevice;
+	_parameters.bufferSize = BufferSize;
+	_parameters.sampleRate = 48000;
+	if (!EXPECT(_stream.Open(_parameters) == NoError))
+		return Test::Result();
+
+	int _channels = _stream.Information().inputChannels;
+	std::vector<std::vector<float>> _data(std::max(_channels, 1), std::vector<float>(Frames));
+	std::vector<float*> _pointers;
+	for (auto& _channel : _data)
+		_pointers.push_back(_channel.data());
+	Buffer<float> _buffer{ _pointers.data(), (int)_pointers.size(), Frames };
+
+	// Too large for the ring, and not running yet
+	std::vector<float> _large(4 * BufferSize + 1);
+	float* _largePointer = _large.data();
+	EXPECT(_pull.Read(&_largePointer, 1, (int)_large.size()) == InvalidBufferSize);
+	EXPECT(_pull.Read(_buffer) == NotRunning);
+
+	// Blocking, the reader is waiting when the stream stops
+	{
+		if (!EXPECT(_stream.Start() == NoError))
+			return Test::Result();
+
+		std::atomic<int> _reads = 0;
+		auto _result = std::async(std::launch::async, [&]() {
+			while (true)
+			{
+				Error _error = _pull.Read(_buffer);
+				if (_error != NoError)
+					return _error;
+				_reads++;
+			}
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		EXPECT(_stream.Stop() == NoError);
+		if (!EXPECT(_result.wait_for(Timeout) == std::future_status::ready))
+			return Test::Result();
+
+		std::printf("blocking: %d reads before stopping\n", _reads.load());
+		EXPECT(_reads > 0);
+		EXPECT(_result.get() == NotRunning);
+	}
+
+	// Awaited, the coroutine is suspended when the stream stops
+	{
+		if (!EXPECT(_stream.Start() == NoError))
+			return Test::Result();
+
+		std::atomic<int> _reads = 0;
+		std::promise<Error> _promise;
+		auto _result = _promise.get_future();
+		ReadUntilError(_pull, _buffer, _reads, _promise);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		EXPECT(_stream.Stop() == NoError);
+		if (!EXPECT(_result.wait_for(Timeout) == std::future_status::ready))
+			return Test::Result();
+
+		std::printf("awaited: %d reads before stopping\n", _reads.load());
+		EXPECT(_reads > 0);
+		EXPECT(_result.get() == NotRunning);
+	}
+
+	// Closing takes the rings away
+	EXPECT(_stream.Close() == NoError);
+	EXPECT(_pull.Read(_buffer) == NotOpen);
+
+	return Test::Result();
+}
@@ -0,0 +1,96 @@
+#include "Audijo/Resampler.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+constexpr double InRate = 44100;
+constexpr double OutRate = 48000;
+constexpr double Frequency = 997;
+
+/**
+ * Sine at the test frequency.
+ * @param time time in seconds
+ * @return sample
+ */
+static double Sine(double time)
+{
+	return 0.5 * std::sin(2 * std::numbers::pi * Frequency * time);
+}
+
+/**
+ * Signal to noise ratio of resampled output against the exact sine, skipping the start
+ * where the filter still runs into the silence before the input.
+ * @param output output at OutRate
+ * @param delay delay of the resampler in input samples
+ * @return ratio in dB
+ */
+static double SignalToNoise(const std::vector<float>& output, double delay)
+{
+	double _signal = 0, _noise = 0;
+	for (std::size_t i = 256; i < output.size(); i++)
+	{
+		double _expected = Sine(i / OutRate - delay / InRate);
+		_signal += _expected * _expected;
+		_noise += (output[i] - _expected) * (output[i] - _expected);
+	}
+	return 10 * std::log10(_signal / _noise);
+}
+
+int main()
+{
+	// A second of input comes out as exactly a second of output
+	constexpr int Frames = (int)InRate;
+	std::vector<float> _input(Frames);
+	for (int i = 0; i < Frames; i++)
+		_input[i] = (float)Sine(i / InRate);
+
+	if (!EXPECT(PolyphaseResampler::Supports(InRate, OutRate)))
+		return Test::Result();
+
+	// In blocks of changing size, the history carries over between calls
+	{
+		constexpr int MaxFrames = 512;
+		PolyphaseResampler _resampler{ 1, MaxFrames, InRate, OutRate };
+		std::vector<float> _output(_resampler.MaxOutput(MaxFrames));
+		std::vector<float> _result;
+		for (int _done = 0, _block = 0; _done < Frames; _block++)
+		{
+			int _frames = std::min(Frames - _done, 64 + _block * 97 % (MaxFrames - 64));
+			const float* _in = &_input[_done];
+			float* _out = _output.data();
+			int _produced = _resampler.Process(&_in, _frames, &_out, (int)_output.size());
+			_result.insert(_result.end(), _output.begin(), _output.begin() + _produced);
+			_done += _frames;
+		}
+
+		double _snr = SignalToNoise(_result, _resampler.Delay());
+		std::printf("polyphase: %zu frames, %.1f dB\n", _result.size(), _snr);
+		EXPECT(_result.size() == (std::size_t)OutRate);
+		EXPECT(_snr > 120);
+	}
+
+	// Device periods at the device rate become whole callback periods at the stream rate
+	{
+		constexpr int DevicePeriod = 441;
+		constexpr int Period = 480;
+		RateConverter _converter{ 1, 0, InRate, OutRate, Period, DevicePeriod };
+		std::vector<float> _result;
+		for (int _done = 0; _done < Frames; _done += DevicePeriod)
+		{
+			std::copy_n(&_input[_done], DevicePeriod, _converter.DeviceInputs()[0]);
+			_converter.Write(DevicePeriod);
+			while (_converter.Pending(DevicePeriod))
+			{
+				_converter.BeginPeriod();
+				_result.insert(_result.end(), _converter.Inputs()[0], _converter.Inputs()[0] + Period);
+			}
+		}
+
+		double _snr = SignalToNoise(_result, _converter.Delay() * InRate);
+		std::printf("converter: %zu periods, %.1f dB\n", _result.size() / Period, _snr);
+		EXPECT(_result.size() == (std::size_t)OutRate);
+		EXPECT(_snr > 120);
+	}
+
+	return Test::Result();
+}
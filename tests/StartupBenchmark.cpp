@@ -0,0 +1,95 @@
+#include "Audijo/DeviceRegistry.hpp"
+#include "MockEnumerator.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+using Registry = DeviceRegistry<DeviceInfo<>>;
+
+/**
+ * Seconds since a point in time.
+ * @param start point in time
+ * @return seconds
+ */
+static double Since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Whether every device of the system is in the registry with its capabilities.
+ * @param registry registry
+ * @param system system
+ * @return true if they're all probed
+ */
+static bool Complete(const Registry& registry, const Test::MockEnumerator& system)
+{
+	auto _devices = system.Enumerate();
+	auto _snapshot = registry.Read();
+	if (_snapshot->devices.size() != _devices.size())
+		return false;
+
+	for (auto& [_key, _info] : _devices)
+	{
+		auto _device = _snapshot->FindKey(_key);
+		if (!_device || !_device->probed || _device->inputChannels != _info.inputChannels
+			|| _device->outputChannels != _info.outputChannels || _device->sampleRates != _info.sampleRates)
+			return false;
+	}
+	return true;
+}
+
+int main()
+{
+	// Probing a device stands for activating an audio client or loading a driver
+	constexpr int Devices = 48;
+	constexpr double ProbeDelay = 0.002;
+	constexpr int Threads = 4;
+	constexpr int Rounds = 3;
+
+	Test::MockEnumerator _system{ ProbeDelay };
+	for (int i = 0; i < Devices; i++)
+		_system.Plug("{device " + std::to_string(i) + "}", "Device " + std::to_string(i), i % 3, 2 + i % 5);
+
+	// Fastest of a few rounds, every round starts from an empty registry like a new stream
+	double _synchronous = 1e9, _listed = 1e9, _probed = 1e9;
+	int _errors = 0;
+	for (int r = 0; r < Rounds; r++)
+	{
+		// Probe every device before the devices are listed
+		{
+			Registry _registry;
+			auto _start = std::chrono::steady_clock::now();
+			auto _devices = _system.List();
+			for (auto& [_key, _info] : _devices)
+				_system.Probe(_key, _info);
+			_registry.Update(std::move(_devices));
+			_synchronous = std::min(_synchronous, Since(_start));
+			_errors += !Complete(_registry, _system);
+		}
+
+		// List the devices right away and probe them on the pool
+		{
+			Registry _registry;
+			DeviceProber<DeviceInfo<>> _prober{ _registry, Threads };
+			auto _start = std::chrono::steady_clock::now();
+			for (auto& _change : _registry.Update(_system.List()))
+				_prober.Submit(_change.key, [&, _key = _change.key](DeviceInfo<>& info) { return _system.Probe(_key, info); });
+			_listed = std::min(_listed, Since(_start));
+			_errors += _registry.Read()->devices.size() != Devices;
+
+			_prober.Finished().wait();
+			_probed = std::min(_probed, Since(_start));
+			_errors += !Complete(_registry, _system);
+		}
+	}
+
+	std::printf("%d devices, %.1f ms probe each\n", Devices, ProbeDelay * 1000);
+	std::printf("  synchronous: devices listed after %.2f ms\n", _synchronous * 1000);
+	std::printf("  lazy:        devices listed after %.2f ms, probed after %.2f ms on %d threads\n", _listed * 1000, _probed * 1000, Threads);
+	EXPECT(_errors == 0);
+	EXPECT(_synchronous >= Devices * ProbeDelay);
+	EXPECT(_listed < _synchronous / 10);
+	EXPECT(_probed < _synchronous);
+	return Test::Result();
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+namespace Audijo::Test
+{
+	inline int& Failures() { static int _failures = 0; return _failures; }
+
+	/**
+	 * Report a failed check, the test keeps running so it reports every failure.
+	 * @param passed result of the check
+	 * @param expression text of the check
+	 * @param file source file
+	 * @param line source line
+	 * @return passed
+	 */
+	inline bool Expect(bool passed, const char* expression, const char* file, int line)
+	{
+		if (!passed)
+		{
+			std::fprintf(stderr, "%s:%d: failed: %s\n", file, line, expression);
+			Failures()++;
+		}
+		return passed;
+	}
+
+	/**
+	 * Exit code of the test.
+	 * @return 0 when every check passed
+	 */
+	inline int Result()
+	{
+		if (Failures())
+			std::fprintf(stderr, "%d checks failed\n", Failures());
+		return Failures() ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+}
+
+#define EXPECT(expression) ::Audijo::Test::Expect((expression), #expression, __FILE__, __LINE__)
@@ -0,0 +1,138 @@
+#include "Audijo/Audijo.hpp"
+#include "Test.hpp"
+
+using namespace Audijo;
+
+constexpr double SampleRate = 48000;
+
+/**
+ * Parameters of a duplex Null stream with a watchdog.
+ * @param policy watchdog policy
+ * @param bufferSize buffer size
+ * @return parameters
+ */
+static StreamParameters Parameters(WatchdogPolicy policy, int bufferSize)
+{
+	StreamParameters _parameters;
+	_parameters.input = NoDevice;
+	_parameters.output = NullApi::DuplexDevice;
+	_parameters.bufferSize = bufferSize;
+	_parameters.sampleRate = SampleRate;
+	_parameters.watchdog.policy = policy;
+	_parameters.watchdog.overruns = 2;
+	_parameters.watchdog.recovery = 10;
+	return _parameters;
+}
+
+/**
+ * Run a stream for a while.
+ * @param stream stream with its callback set
+ * @param parameters parameters to open it with
+ * @param seconds how long it runs
+ * @return statistics of the run, empty if it didn't open or start
+ */
+static StreamStatistics Run(Stream<Null>& stream, const StreamParameters& parameters, double seconds)
+{
+	if (!EXPECT(stream.Open(parameters) == NoError) || !EXPECT(stream.Start() == NoError))
+		return {};
+
+	std::this_thread::sleep_for(std::chrono::duration<double>{ seconds });
+	auto _statistics = stream.Statistics();
+	stream.Close();
+	return _statistics;
+}
+
+/**
+ * Callback that takes a while, and fills the output.
+ * @param output output buffer
+ * @param duration how long it takes
+ */
+static void Sleep(Buffer<float>& output, std::chrono::microseconds duration)
+{
+	std::this_thread::sleep_for(duration);
+	for (int c = 0; c < output.Channels(); c++)
+		std::fill_n(output.data()[c], output.Frames(), 0.5f);
+}
+
+int main()
+{
+	// Periods of 256 frames last 5.3ms, a callback sleeping 8ms goes over budget every period
+	constexpr int BufferSize = 256;
+	constexpr auto Slow = std::chrono::milliseconds(8);
+
+	// The callback switches to a cheap path while the flag is up, until it clears again
+	{
+		Stream<Null> _stream;
+		std::atomic<int> _flagged = 0;
+		_stream.Callback([&](Buffer<float>&, Buffer<float>& output, CallbackInfo info) {
+			_flagged += info.overload;
+			Sleep(output, info.overload ? std::chrono::microseconds(0) : Slow);
+		});
+
+		auto _statistics = Run(_stream, Parameters(FlagOverload, BufferSize), 1);
+		std::printf("flag: %llu over budget, %llu overloads, %d flagged periods\n", (unsigned long long)_statistics.overBudget,
+			(unsigned long long)_statistics.overloads, _flagged.load());
+		EXPECT(_statistics.overBudget >= 2);
+		EXPECT(_statistics.overloads >= 2);
+		EXPECT(_statistics.bypasses == 0);
+		EXPECT(_flagged >= 10);
+	}
+
+	// The callback is skipped for the recovery periods every time, and the output is silent meanwhile
+	{
+		Stream<Null> _stream;
+		std::atomic<int> _called = 0;
+		_stream.Callback([&](Buffer<float>&, Buffer<float>& output, CallbackInfo) {
+			_called++;
+			Sleep(output, Slow);
+		});
+
+		auto _statistics = Run(_stream, Parameters(BypassCallback, BufferSize), 1);
+		std::printf("bypass: %llu over budget, %llu bypasses, %llu bypassed periods, %d calls\n", (unsigned long long)_statistics.overBudget,
+			(unsigned long long)_statistics.bypasses, (unsigned long long)_statistics.bypassedPeriods, _called.load());
+		EXPECT(_statistics.bypasses >= 2);
+		EXPECT(_statistics.bypassedPeriods >= 10 * (_statistics.bypasses - 1));
+		EXPECT(_statistics.overloads == 0);
+		EXPECT(_called > 0);
+	}
+
+	// The buffer size doubles until the callback fits, 5ms is too long for up to 256 frames but fits in 512
+	{
+		Stream<Null> _stream;
+		std::atomic<int> _bufferSize = 0;
+		_stream.Callback([&](Buffer<float>&, Buffer<float>& output, CallbackInfo info) {
+			_bufferSize = info.bufferSize;
+			Sleep(output, std::chrono::milliseconds(5));
+		});
+
+		auto _parameters = Parameters(GrowBufferSize, 64);
+		_parameters.maxBufferSize = 1024;
+		auto _statistics = Run(_stream, _parameters, 2);
+		std::printf("grow: %llu over budget, %llu growths, ends at %d frames\n", (unsigned long long)_statistics.overBudget,
+			(unsigned long long)_statistics.bufferGrowths, _bufferSize.load());
+		EXPECT(_statistics.bufferGrowths >= 3);
+		EXPECT(_bufferSize >= 512);
+		EXPECT(_statistics.overloads == 0);
+		EXPECT(_statistics.bypasses == 0);
+	}
+
+	// Pipelined two periods deep the callback has two periods, longer periods here and there are within budget
+	{
+		Stream<Null> _stream;
+		std::atomic<int> _periods = 0;
+		_stream.Callback([&](Buffer<float>&, Buffer<float>& output, CallbackInfo) {
+			Sleep(output, _periods++ % 2 ? std::chrono::milliseconds(1) : std::chrono::milliseconds(6));
+		});
+
+		auto _parameters = Parameters(FlagOverload, BufferSize);
+		_parameters.pipeline = 2;
+		_parameters.watchdog.overruns = 1;
+		auto _statistics = Run(_stream, _parameters, 1);
+		std::printf("pipeline: %llu over budget in %d periods\n", (unsigned long long)_statistics.overBudget, _periods.load());
+		EXPECT(_periods > 0);
+		EXPECT(_statistics.overBudget * 10 < (uint64_t)_periods);
+		EXPECT(_statistics.overloads * 10 < (uint64_t)_periods);
+	}
+
+	return Test::Result();
+}